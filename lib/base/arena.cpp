@@ -0,0 +1,193 @@
+/******************************************************************************
+ * Icinga 2                                                                   *
+ * Copyright (C) 2012-2018 Icinga Development Team (https://www.icinga.com/)  *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or              *
+ * modify it under the terms of the GNU General Public License                *
+ * as published by the Free Software Foundation; either version 2             *
+ * of the License, or (at your option) any later version.                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software Foundation     *
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
+ ******************************************************************************/
+
+#include "base/arena.hpp"
+#include <boost/thread/tss.hpp>
+#include <atomic>
+#include <new>
+
+using namespace icinga;
+
+/**
+ * The beginning of a chunk. The reference count is biased while the chunk
+ * still belongs to an arena so that objects which are freed early can't
+ * drop it to zero; the arena removes the bias minus the number of objects
+ * it allocated from the chunk once it moves on to the next one.
+ */
+struct Arena::Chunk
+{
+	std::atomic<size_t> References;
+	size_t Objects;
+};
+
+/* Every object is preceded by a header which refers to the chunk it was
+ * allocated from, or nullptr for objects on the heap. The header's size
+ * keeps objects aligned for any of their members. */
+static const size_t l_HeaderSize = 16;
+
+/* Objects larger than this are always allocated on the heap. */
+static const size_t l_MaxObjectSize = Arena::ChunkSize / 4;
+
+static const size_t l_ChunkBias = static_cast<size_t>(-1) / 2;
+
+static void ReleaseCurrentArena(Arena *)
+{
+	/* The arena belongs to the ArenaScope's caller. */
+}
+
+static boost::thread_specific_ptr<Arena> l_CurrentArena(&ReleaseCurrentArena);
+
+/* The number of active ArenaScopes on all threads. */
+static std::atomic<int> l_ActiveScopes(0);
+
+static inline void *& GetOwner(void *header)
+{
+	return *static_cast<void **>(header);
+}
+
+Arena::~Arena()
+{
+	if (m_Chunk)
+		RetireChunk();
+}
+
+/**
+ * Allocates memory for an object from the arena. The memory has to be
+ * freed with FreeObject().
+ *
+ * @param size The object's size.
+ * @returns The memory.
+ */
+void *Arena::Allocate(size_t size)
+{
+	size_t total = (size + 2 * l_HeaderSize - 1) & ~(l_HeaderSize - 1);
+
+	m_Allocations++;
+	m_Bytes += total;
+
+	if (total > l_MaxObjectSize) {
+		void *header = ::operator new(size + l_HeaderSize);
+		GetOwner(header) = nullptr;
+		return static_cast<char *>(header) + l_HeaderSize;
+	}
+
+	if (!m_Chunk || m_Offset + total > ChunkSize) {
+		if (m_Chunk)
+			RetireChunk();
+
+		m_Chunk = new (::operator new(ChunkSize)) Chunk();
+		m_Chunk->References.store(l_ChunkBias, std::memory_order_relaxed);
+		m_Chunk->Objects = 0;
+		m_Offset = l_HeaderSize;
+		m_Chunks++;
+	}
+
+	char *header = reinterpret_cast<char *>(m_Chunk) + m_Offset;
+	GetOwner(header) = m_Chunk;
+
+	m_Chunk->Objects++;
+	m_Offset += total;
+
+	return header + l_HeaderSize;
+}
+
+/**
+ * Gives up the arena's claim on its current chunk. The chunk is freed once
+ * all of its objects have been freed.
+ */
+void Arena::RetireChunk()
+{
+	Chunk *chunk = m_Chunk;
+	size_t delta = l_ChunkBias - chunk->Objects;
+
+	m_Chunk = nullptr;
+
+	if (chunk->References.fetch_sub(delta, std::memory_order_acq_rel) == delta)
+		FreeChunk(chunk);
+}
+
+void Arena::FreeChunk(Chunk *chunk)
+{
+	chunk->~Chunk();
+	::operator delete(chunk);
+}
+
+size_t Arena::GetAllocations() const
+{
+	return m_Allocations;
+}
+
+size_t Arena::GetBytes() const
+{
+	return m_Bytes;
+}
+
+size_t Arena::GetChunks() const
+{
+	return m_Chunks;
+}
+
+/**
+ * Returns the current thread's arena.
+ *
+ * @returns The arena, or nullptr if there is no active ArenaScope.
+ */
+Arena *Arena::GetCurrent()
+{
+	if (l_ActiveScopes.load(std::memory_order_relaxed) == 0)
+		return nullptr;
+
+	return l_CurrentArena.get();
+}
+
+/**
+ * Frees memory which was allocated with Allocate().
+ * This may happen on any thread and after the arena has been destroyed.
+ *
+ * @param ptr The memory.
+ */
+void Arena::FreeObject(void *ptr)
+{
+	if (!ptr)
+		return;
+
+	void *header = static_cast<char *>(ptr) - l_HeaderSize;
+	auto *chunk = static_cast<Chunk *>(GetOwner(header));
+
+	if (!chunk) {
+		::operator delete(header);
+		return;
+	}
+
+	if (chunk->References.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		FreeChunk(chunk);
+}
+
+ArenaScope::ArenaScope(Arena& arena)
+	: m_Previous(l_CurrentArena.get())
+{
+	l_CurrentArena.reset(&arena);
+	l_ActiveScopes.fetch_add(1, std::memory_order_relaxed);
+}
+
+ArenaScope::~ArenaScope()
+{
+	l_ActiveScopes.fetch_sub(1, std::memory_order_relaxed);
+	l_CurrentArena.reset(m_Previous);
+}
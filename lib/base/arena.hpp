@@ -0,0 +1,150 @@
+/******************************************************************************
+ * Icinga 2                                                                   *
+ * Copyright (C) 2012-2018 Icinga Development Team (https://www.icinga.com/)  *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or              *
+ * modify it under the terms of the GNU General Public License                *
+ * as published by the Free Software Foundation; either version 2             *
+ * of the License, or (at your option) any later version.                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software Foundation     *
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
+ ******************************************************************************/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "base/i2-base.hpp"
+#include <cstddef>
+#include <utility>
+
+namespace icinga
+{
+
+/**
+ * A monotonic buffer for the objects which make up a short-lived value
+ * tree, e.g. a decoded cluster message.
+ *
+ * Objects are created in an arena with ArenaNew(). While an ArenaScope is
+ * active on the current thread they are carved out of the arena's chunks
+ * instead of being allocated individually; otherwise ArenaNew() is the
+ * same as operator new.
+ *
+ * Each chunk counts the objects which still live in it and is freed along
+ * with the last of them. Objects which outlive the arena (e.g. because they
+ * were stored somewhere) therefore stay valid and keep their chunk alive.
+ *
+ * @ingroup base
+ */
+class Arena
+{
+public:
+	/* Objects are allocated from chunks of this size. */
+	static const size_t ChunkSize = 8 * 1024;
+
+	Arena() = default;
+	~Arena();
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	void *Allocate(size_t size);
+
+	size_t GetAllocations() const;
+	size_t GetBytes() const;
+	size_t GetChunks() const;
+
+	static Arena *GetCurrent();
+
+	static void FreeObject(void *ptr);
+
+private:
+	struct Chunk;
+
+	Chunk *m_Chunk{nullptr};
+	size_t m_Offset{0};
+	size_t m_Allocations{0};
+	size_t m_Bytes{0};
+	size_t m_Chunks{0};
+
+	void RetireChunk();
+
+	static void FreeChunk(Chunk *chunk);
+};
+
+/**
+ * Makes an arena the current thread's arena for as long as the scope
+ * exists.
+ *
+ * @ingroup base
+ */
+class ArenaScope
+{
+public:
+	explicit ArenaScope(Arena& arena);
+	~ArenaScope();
+
+	ArenaScope(const ArenaScope&) = delete;
+	ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+	Arena *m_Previous;
+};
+
+/**
+ * An object which lives in an arena. Freeing it returns its memory to the
+ * arena's chunk.
+ *
+ * @ingroup base
+ */
+template<typename T>
+class ArenaObject final : public T
+{
+public:
+	template<typename... Args>
+	ArenaObject(Args&&... args)
+		: T(std::forward<Args>(args)...)
+	{ }
+
+	static void *operator new(size_t size, Arena& arena)
+	{
+		return arena.Allocate(size);
+	}
+
+	static void operator delete(void *ptr, Arena&)
+	{
+		Arena::FreeObject(ptr);
+	}
+
+	static void operator delete(void *ptr)
+	{
+		Arena::FreeObject(ptr);
+	}
+};
+
+/**
+ * Creates an object in the current thread's arena, or on the heap if there
+ * is none.
+ *
+ * @returns The object.
+ */
+template<typename T, typename... Args>
+T *ArenaNew(Args&&... args)
+{
+	Arena *arena = Arena::GetCurrent();
+
+	if (!arena)
+		return new T(std::forward<Args>(args)...);
+
+	return new (*arena) ArenaObject<T>(std::forward<Args>(args)...);
+}
+
+}
+
+#endif /* ARENA_H */
@@ -37,7 +37,7 @@ typedef std::vector<Value> ArrayData;
  *
  * @ingroup base
  */
-class Array final : public Object
+class Array : public Object
 {
 public:
 	DECLARE_OBJECT(Array);
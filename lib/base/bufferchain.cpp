@@ -0,0 +1,148 @@
+/******************************************************************************
+ * Icinga 2                                                                   *
+ * Copyright (C) 2012-2018 Icinga Development Team (https://www.icinga.com/)  *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or              *
+ * modify it under the terms of the GNU General Public License                *
+ * as published by the Free Software Foundation; either version 2             *
+ * of the License, or (at your option) any later version.                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software Foundation     *
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
+ ******************************************************************************/
+
+
+#include "base/bufferchain.hpp"
+#include "base/debug.hpp"
+#include <cstring>
+
+using namespace icinga;
+
+/**
+ * Copies data to the end of the chain.
+ *
+ * @param data The data.
+ * @param count The number of bytes.
+ */
+void BufferChain::Append(const void *data, size_t count)
+{
+	if (count == 0)
+		return;
+
+	if (m_Buffers.empty() || !m_TailCopied || m_Buffers.back().GetLength() >= CopyBufferSize) {
+		m_Buffers.emplace_back();
+		m_Buffers.back().GetData().reserve(std::max(count, CopyBufferSize));
+		m_TailCopied = true;
+	}
+
+	m_Buffers.back().GetData().append(static_cast<const char *>(data), count);
+	m_Size += count;
+}
+
+/**
+ * Adds a buffer to the end of the chain without copying it.
+ *
+ * @param buffer The buffer. Its contents are moved into the chain.
+ */
+void BufferChain::Append(String&& buffer)
+{
+	size_t count = buffer.GetLength();
+
+	if (count < MinBufferSize) {
+		Append(buffer.CStr(), count);
+		return;
+	}
+
+	m_Buffers.emplace_back(std::move(buffer));
+	m_Size += count;
+	m_TailCopied = false;
+}
+
+/**
+ * Copies data from the beginning of the chain without removing it.
+ *
+ * @param buffer The buffer where the data should be stored.
+ * @param count The maximum number of bytes to copy.
+ * @returns The number of bytes copied.
+ */
+size_t BufferChain::Peek(void *buffer, size_t count) const
+{
+	auto *dest = static_cast<char *>(buffer);
+	size_t offset = m_Offset;
+	size_t copied = 0;
+
+	for (const String& source : m_Buffers) {
+		if (copied == count)
+			break;
+
+		size_t length = std::min(source.GetLength() - offset, count - copied);
+		memcpy(dest + copied, source.CStr() + offset, length);
+
+		copied += length;
+		offset = 0;
+	}
+
+	return copied;
+}
+
+/**
+ * Retrieves pointers to the buffers at the beginning of the chain.
+ *
+ * @param segments The array where the segments should be stored.
+ * @param count The size of the array.
+ * @returns The number of segments.
+ */
+size_t BufferChain::GetSegments(BufferSegment *segments, size_t count) const
+{
+	size_t offset = m_Offset;
+	size_t i = 0;
+
+	for (auto it = m_Buffers.begin(); it != m_Buffers.end() && i < count; ++it, i++) {
+		segments[i].Data = it->CStr() + offset;
+		segments[i].Size = it->GetLength() - offset;
+		offset = 0;
+	}
+
+	return i;
+}
+
+/**
+ * Removes data from the beginning of the chain.
+ *
+ * @param count The number of bytes to remove.
+ */
+void BufferChain::Drop(size_t count)
+{
+	ASSERT(count <= m_Size);
+
+	m_Size -= count;
+
+	while (count > 0) {
+		size_t length = m_Buffers.front().GetLength() - m_Offset;
+
+		if (count < length) {
+			m_Offset += count;
+			return;
+		}
+
+		count -= length;
+		m_Buffers.pop_front();
+		m_Offset = 0;
+	}
+}
+
+size_t BufferChain::GetAvailableBytes() const
+{
+	return m_Size;
+}
+
+bool BufferChain::IsEmpty() const
+{
+	return m_Size == 0;
+}
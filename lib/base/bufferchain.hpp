@@ -0,0 +1,76 @@
+/******************************************************************************
+ * Icinga 2                                                                   *
+ * Copyright (C) 2012-2018 Icinga Development Team (https://www.icinga.com/)  *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or              *
+ * modify it under the terms of the GNU General Public License                *
+ * as published by the Free Software Foundation; either version 2             *
+ * of the License, or (at your option) any later version.                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software Foundation     *
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
+ ******************************************************************************/
+
+
+#ifndef BUFFERCHAIN_H
+#define BUFFERCHAIN_H
+
+#include "base/i2-base.hpp"
+#include "base/string.hpp"
+#include <deque>
+
+namespace icinga
+{
+
+/**
+ * A contiguous part of a buffer chain.
+ *
+ * @ingroup base
+ */
+struct BufferSegment
+{
+	const char *Data;
+	size_t Size;
+};
+
+/**
+ * A queue of buffers. Large buffers are referenced instead of being copied
+ * into a contiguous buffer, small ones are coalesced.
+ *
+ * @ingroup base
+ */
+class BufferChain
+{
+public:
+	/* Buffers smaller than this are copied rather than referenced. */
+	static const size_t MinBufferSize = 4096;
+
+	/* Copied data is coalesced into buffers of about this size. */
+	static const size_t CopyBufferSize = 16 * 1024;
+
+	void Append(const void *data, size_t count);
+	void Append(String&& buffer);
+
+	size_t Peek(void *buffer, size_t count) const;
+	size_t GetSegments(BufferSegment *segments, size_t count) const;
+	void Drop(size_t count);
+
+	size_t GetAvailableBytes() const;
+	bool IsEmpty() const;
+
+private:
+	std::deque<String> m_Buffers;
+	size_t m_Offset{0};
+	size_t m_Size{0};
+	bool m_TailCopied{false};
+};
+
+}
+
+#endif /* BUFFERCHAIN_H */
@@ -0,0 +1,187 @@
+/******************************************************************************
+ * Icinga 2                                                                   *
+ * Copyright (C) 2012-2018 Icinga Development Team (https://www.icinga.com/)  *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or              *
+ * modify it under the terms of the GNU General Public License                *
+ * as published by the Free Software Foundation; either version 2             *
+ * of the License, or (at your option) any later version.                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software Foundation     *
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
+ ******************************************************************************/
+
+#include "base/compression.hpp"
+#include "base/exception.hpp"
+#include <algorithm>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif /* HAVE_ZLIB */
+
+using namespace icinga;
+
+#ifdef HAVE_ZLIB
+static void ThrowZlibError(const char *function, int rc, const z_stream *stream)
+{
+	String message = String(function) + "() failed with error code " + std::to_string(rc);
+
+	if (stream && stream->msg)
+		message += ": " + String(stream->msg);
+
+	BOOST_THROW_EXCEPTION(std::runtime_error(message));
+}
+#endif /* HAVE_ZLIB */
+
+StreamCompressor::StreamCompressor()
+	: m_Stream(nullptr)
+{
+#ifdef HAVE_ZLIB
+	m_Stream = new z_stream();
+
+	int rc = deflateInit(m_Stream, Z_DEFAULT_COMPRESSION);
+
+	if (rc != Z_OK) {
+		delete m_Stream;
+		ThrowZlibError("deflateInit", rc, nullptr);
+	}
+#else /* HAVE_ZLIB */
+	BOOST_THROW_EXCEPTION(std::runtime_error("Icinga 2 was built without zlib support."));
+#endif /* HAVE_ZLIB */
+}
+
+StreamCompressor::~StreamCompressor()
+{
+#ifdef HAVE_ZLIB
+	deflateEnd(m_Stream);
+	delete m_Stream;
+#endif /* HAVE_ZLIB */
+}
+
+/**
+ * Compresses data and appends the compressed chunk to the output buffer.
+ *
+ * @param data The data.
+ * @param count The number of bytes.
+ * @param output The output buffer.
+ */
+void StreamCompressor::Compress(const char *data, size_t count, std::string& output)
+{
+#ifdef HAVE_ZLIB
+	m_Stream->next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+	m_Stream->avail_in = count;
+
+	size_t offset = output.size();
+
+	do {
+		/* Z_SYNC_FLUSH needs a few more bytes than deflateBound() accounts for. */
+		output.resize(offset + deflateBound(m_Stream, m_Stream->avail_in) + 16);
+
+		m_Stream->next_out = reinterpret_cast<Bytef *>(&output[offset]);
+		m_Stream->avail_out = output.size() - offset;
+
+		int rc = deflate(m_Stream, Z_SYNC_FLUSH);
+
+		if (rc != Z_OK && rc != Z_BUF_ERROR)
+			ThrowZlibError("deflate", rc, m_Stream);
+
+		offset = output.size() - m_Stream->avail_out;
+	} while (m_Stream->avail_out == 0);
+
+	output.resize(offset);
+#else /* HAVE_ZLIB */
+	VERIFY(!"Compression is not supported.");
+#endif /* HAVE_ZLIB */
+}
+
+/**
+ * Returns whether Icinga 2 was built with compression support.
+ */
+bool StreamCompressor::IsSupported()
+{
+#ifdef HAVE_ZLIB
+	return true;
+#else /* HAVE_ZLIB */
+	return false;
+#endif /* HAVE_ZLIB */
+}
+
+StreamDecompressor::StreamDecompressor()
+	: m_Stream(nullptr)
+{
+#ifdef HAVE_ZLIB
+	m_Stream = new z_stream();
+
+	int rc = inflateInit(m_Stream);
+
+	if (rc != Z_OK) {
+		delete m_Stream;
+		ThrowZlibError("inflateInit", rc, nullptr);
+	}
+#else /* HAVE_ZLIB */
+	BOOST_THROW_EXCEPTION(std::runtime_error("Icinga 2 was built without zlib support."));
+#endif /* HAVE_ZLIB */
+}
+
+StreamDecompressor::~StreamDecompressor()
+{
+#ifdef HAVE_ZLIB
+	inflateEnd(m_Stream);
+	delete m_Stream;
+#endif /* HAVE_ZLIB */
+}
+
+/**
+ * Decompresses a chunk and appends the data to the output buffer.
+ *
+ * @param data The compressed chunk.
+ * @param count The number of bytes.
+ * @param output The output buffer.
+ */
+void StreamDecompressor::Decompress(const char *data, size_t count, std::string& output)
+{
+#ifdef HAVE_ZLIB
+	m_Stream->next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+	m_Stream->avail_in = count;
+
+	size_t offset = output.size();
+
+	for (;;) {
+		output.resize(offset + std::max<size_t>(count * 4, 16 * 1024));
+
+		m_Stream->next_out = reinterpret_cast<Bytef *>(&output[offset]);
+		m_Stream->avail_out = output.size() - offset;
+
+		int rc = inflate(m_Stream, Z_SYNC_FLUSH);
+
+		offset = output.size() - m_Stream->avail_out;
+
+		if (rc == Z_STREAM_END) {
+			if (m_Stream->avail_in > 0)
+				BOOST_THROW_EXCEPTION(std::runtime_error("Unexpected data after the end of the compressed stream."));
+
+			break;
+		}
+
+		/* Z_BUF_ERROR means that no progress was possible, i.e. the chunk is done. */
+		if (rc == Z_BUF_ERROR)
+			break;
+
+		if (rc != Z_OK)
+			ThrowZlibError("inflate", rc, m_Stream);
+
+		/* zlib may still have buffered output if it filled the buffer. */
+		if (m_Stream->avail_in == 0 && m_Stream->avail_out > 0)
+			break;
+	}
+
+	output.resize(offset);
+#else /* HAVE_ZLIB */
+	VERIFY(!"Compression is not supported.");
+#endif /* HAVE_ZLIB */
+}
@@ -0,0 +1,77 @@
+/******************************************************************************
+ * Icinga 2                                                                   *
+ * Copyright (C) 2012-2018 Icinga Development Team (https://www.icinga.com/)  *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or              *
+ * modify it under the terms of the GNU General Public License                *
+ * as published by the Free Software Foundation; either version 2             *
+ * of the License, or (at your option) any later version.                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software Foundation     *
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
+ ******************************************************************************/
+
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include "base/i2-base.hpp"
+#include "base/string.hpp"
+
+struct z_stream_s;
+
+namespace icinga
+{
+
+/**
+ * Compresses a stream of data with zlib. Each call to Compress() returns a
+ * chunk which the receiver can decompress as soon as it arrives, while the
+ * compression state is kept across chunks.
+ *
+ * @ingroup base
+ */
+class StreamCompressor
+{
+public:
+	StreamCompressor();
+	~StreamCompressor();
+
+	StreamCompressor(const StreamCompressor&) = delete;
+	StreamCompressor& operator=(const StreamCompressor&) = delete;
+
+	void Compress(const char *data, size_t count, std::string& output);
+
+	static bool IsSupported();
+
+private:
+	z_stream_s *m_Stream;
+};
+
+/**
+ * Decompresses chunks which were created by a StreamCompressor.
+ *
+ * @ingroup base
+ */
+class StreamDecompressor
+{
+public:
+	StreamDecompressor();
+	~StreamDecompressor();
+
+	StreamDecompressor(const StreamDecompressor&) = delete;
+	StreamDecompressor& operator=(const StreamDecompressor&) = delete;
+
+	void Decompress(const char *data, size_t count, std::string& output);
+
+private:
+	z_stream_s *m_Stream;
+};
+
+}
+
+#endif /* COMPRESSION_H */
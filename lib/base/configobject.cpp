@@ -46,6 +46,10 @@ REGISTER_TYPE_WITH_PROTOTYPE(ConfigObject, ConfigObject::GetPrototype());
 
 boost::signals2::signal<void (const ConfigObject::Ptr&)> ConfigObject::OnStateChanged;
 
+static boost::mutex l_DumpStatsMutex;
+static double l_LastDumpDuration = 0;
+static size_t l_LastDumpObjectCount = 0;
+
 bool ConfigObject::IsActive() const
 {
 	return GetActive();
@@ -280,7 +284,7 @@ void ConfigObject::RestoreAttribute(const String& attr, bool updateVersion)
 			ObjectLock olock(original_attributes);
 			for (const auto& kv : original_attributes) {
 				std::vector<String> originalTokens;
-				boost::algorithm::split(originalTokens, kv.first, boost::is_any_of("."));
+				boost::algorithm::split(originalTokens, kv.first.GetString(), boost::is_any_of("."));
 
 				if (tokens.size() > originalTokens.size())
 					continue;
@@ -497,7 +501,9 @@ void ConfigObject::DumpObjects(const String& filename, int attributeTypes)
 	if (!fp)
 		BOOST_THROW_EXCEPTION(std::runtime_error("Could not open '" + tempFilename + "' file"));
 
-	StdioStream::Ptr sfp = new StdioStream(&fp, false);
+	double start = Utility::GetTime();
+
+	std::vector<std::pair<String, ConfigObject::Ptr> > objects;
 
 	for (const Type::Ptr& type : Type::GetAllTypes()) {
 		auto *dtype = dynamic_cast<ConfigType *>(type.get());
@@ -505,25 +511,114 @@ void ConfigObject::DumpObjects(const String& filename, int attributeTypes)
 		if (!dtype)
 			continue;
 
-		for (const ConfigObject::Ptr& object : dtype->GetObjects()) {
-			Dictionary::Ptr update = Serialize(object, attributeTypes);
+		for (const ConfigObject::Ptr& object : dtype->GetObjects())
+			objects.emplace_back(type->GetName(), object);
+	}
 
-			if (!update)
-				continue;
+	/* The objects are serialized in chunks by a work queue. The chunks are
+	 * written to the file in their original order as soon as they're done. */
+	const size_t chunkSize = 500;
+	size_t chunkCount = (objects.size() + chunkSize - 1) / chunkSize;
+
+	struct DumpChunk
+	{
+		std::string Data;
+		boost::exception_ptr Exception;
+		bool Done{false};
+	};
+
+	std::vector<DumpChunk> chunks(chunkCount);
+	boost::mutex mutex;
+	boost::condition_variable cv;
+
+	WorkQueue dumpq(0, Application::GetConcurrency());
+	dumpq.SetName("ConfigObject::DumpObjects");
 
-			Dictionary::Ptr persistentObject = new Dictionary({
-				{ "type", type->GetName() },
-				{ "name", object->GetName() },
-				{ "update", update }
-			});
+	auto serializeChunk = [&objects, &chunks, &mutex, &cv, chunkSize, attributeTypes](size_t index) {
+		std::string data;
+		boost::exception_ptr exception;
 
-			String json = JsonEncode(persistentObject);
+		try {
+			size_t end = std::min(objects.size(), (index + 1) * chunkSize);
+
+			for (size_t i = index * chunkSize; i < end; i++) {
+				const ConfigObject::Ptr& object = objects[i].second;
+				Dictionary::Ptr update = Serialize(object, attributeTypes);
+
+				if (!update)
+					continue;
 
-			NetString::WriteStringToStream(sfp, json);
+				Dictionary::Ptr persistentObject = new Dictionary({
+					{ "type", objects[i].first },
+					{ "name", object->GetName() },
+					{ "update", update }
+				});
+
+				String json = JsonEncode(persistentObject);
+
+				data += std::to_string(json.GetLength());
+				data += ':';
+				data += json.GetData();
+				data += ',';
+			}
+		} catch (...) {
+			exception = boost::current_exception();
 		}
+
+		boost::mutex::scoped_lock lock(mutex);
+		chunks[index].Data = std::move(data);
+		chunks[index].Exception = exception;
+		chunks[index].Done = true;
+		cv.notify_all();
+	};
+
+	/* Limit the number of chunks which are kept in memory. */
+	size_t window = 2 * Application::GetConcurrency();
+	size_t queued = 0;
+
+	for (; queued < chunkCount && queued < window; queued++)
+		dumpq.Enqueue(std::bind(serializeChunk, queued));
+
+	int lastProgress = 0;
+
+	try {
+		for (size_t i = 0; i < chunkCount; i++) {
+			std::string data;
+
+			{
+				boost::mutex::scoped_lock lock(mutex);
+
+				while (!chunks[i].Done)
+					cv.wait(lock);
+
+				if (chunks[i].Exception)
+					boost::rethrow_exception(chunks[i].Exception);
+
+				data.swap(chunks[i].Data);
+			}
+
+			if (queued < chunkCount) {
+				dumpq.Enqueue(std::bind(serializeChunk, queued));
+				queued++;
+			}
+
+			fp.write(data.c_str(), data.size());
+
+			int progress = (i + 1) * 10 / chunkCount;
+
+			if (progress > lastProgress && i + 1 < chunkCount) {
+				Log(LogNotice, "ConfigObject")
+					<< "Dumped " << std::min(objects.size(), (i + 1) * chunkSize) << " of " << objects.size() << " objects.";
+				lastProgress = progress;
+			}
+		}
+	} catch (...) {
+		/* The tasks reference local variables. */
+		dumpq.Join();
+		throw;
 	}
 
-	sfp->Close();
+	dumpq.Join();
 
 	fp.close();
 
@@ -537,6 +632,39 @@ void ConfigObject::DumpObjects(const String& filename, int attributeTypes)
 			<< boost::errinfo_errno(errno)
 			<< boost::errinfo_file_name(tempFilename));
 	}
+
+	double duration = Utility::GetTime() - start;
+
+	{
+		boost::mutex::scoped_lock lock(l_DumpStatsMutex);
+		l_LastDumpDuration = duration;
+		l_LastDumpObjectCount = objects.size();
+	}
+
+	Log(LogInformation, "ConfigObject")
+		<< "Dumped " << objects.size() << " objects in " << duration << " seconds.";
+}
+
+/**
+ * Returns how long the last call to DumpObjects() took.
+ *
+ * @returns The duration in seconds.
+ */
+double ConfigObject::GetLastDumpDuration()
+{
+	boost::mutex::scoped_lock lock(l_DumpStatsMutex);
+	return l_LastDumpDuration;
+}
+
+/**
+ * Returns how many objects were written by the last call to DumpObjects().
+ *
+ * @returns The number of objects.
+ */
+size_t ConfigObject::GetLastDumpObjectCount()
+{
+	boost::mutex::scoped_lock lock(l_DumpStatsMutex);
+	return l_LastDumpObjectCount;
 }
 
 void ConfigObject::RestoreObject(const String& message, int attributeTypes)
@@ -89,6 +89,8 @@ public:
 	static ConfigObject::Ptr GetObject(const String& type, const String& name);
 
 	static void DumpObjects(const String& filename, int attributeTypes = FAState);
+	static double GetLastDumpDuration();
+	static size_t GetLastDumpObjectCount();
 	static void RestoreObjects(const String& filename, int attributeTypes = FAState);
 	static void StopObjects();
 
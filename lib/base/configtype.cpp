@@ -60,6 +60,8 @@ void ConfigType::RegisterObject(const ConfigObject::Ptr& object)
 
 		m_ObjectMap[name] = object;
 		m_ObjectVector.push_back(object);
+
+		std::atomic_store(&m_Snapshot, std::shared_ptr<const Snapshot>());
 	}
 }
 
@@ -72,6 +74,8 @@ void ConfigType::UnregisterObject(const ConfigObject::Ptr& object)
 
 		m_ObjectMap.erase(name);
 		m_ObjectVector.erase(std::remove(m_ObjectVector.begin(), m_ObjectVector.end(), object), m_ObjectVector.end());
+
+		std::atomic_store(&m_Snapshot, std::shared_ptr<const Snapshot>());
 	}
 }
 
@@ -81,9 +85,29 @@ std::vector<ConfigObject::Ptr> ConfigType::GetObjects() const
 	return m_ObjectVector;
 }
 
-std::vector<ConfigObject::Ptr> ConfigType::GetObjectsHelper(Type *type)
+/**
+ * Publishes a new snapshot unless another thread has done so in the meantime.
+ *
+ * @param factory Creates the snapshot from the current objects.
+ * @returns The current snapshot.
+ */
+std::shared_ptr<const ConfigType::Snapshot> ConfigType::PublishSnapshot(SnapshotFactory factory)
+{
+	boost::mutex::scoped_lock lock(m_Mutex);
+
+	std::shared_ptr<const Snapshot> snapshot = std::atomic_load(&m_Snapshot);
+
+	if (!snapshot) {
+		snapshot = factory(m_ObjectVector);
+		std::atomic_store(&m_Snapshot, snapshot);
+	}
+
+	return snapshot;
+}
+
+ConfigType *ConfigType::GetConfigType(Type *type)
 {
-	return static_cast<TypeImpl<ConfigObject> *>(type)->GetObjects();
+	return static_cast<TypeImpl<ConfigObject> *>(type);
 }
 
 int ConfigType::GetObjectCount() const
@@ -24,12 +24,55 @@
 #include "base/object.hpp"
 #include "base/type.hpp"
 #include "base/dictionary.hpp"
+#include <memory>
 
 namespace icinga
 {
 
 class ConfigObject;
 
+/**
+ * A snapshot of the objects of a config type. Snapshots are immutable and
+ * shared by all readers until the type's objects change, so iterating over
+ * one doesn't need any locks and doesn't copy or reference-count the objects.
+ *
+ * @ingroup base
+ */
+template<typename T>
+class ConfigObjectsSnapshot
+{
+public:
+	typedef std::vector<intrusive_ptr<T> > Vector;
+	typedef typename Vector::const_iterator Iterator;
+
+	explicit ConfigObjectsSnapshot(std::shared_ptr<const Vector> objects)
+		: m_Objects(std::move(objects))
+	{ }
+
+	Iterator begin() const
+	{
+		return m_Objects->begin();
+	}
+
+	Iterator end() const
+	{
+		return m_Objects->end();
+	}
+
+	size_t size() const
+	{
+		return m_Objects->size();
+	}
+
+	bool empty() const
+	{
+		return m_Objects->empty();
+	}
+
+private:
+	std::shared_ptr<const Vector> m_Objects;
+};
+
 class ConfigType
 {
 public:
@@ -50,15 +93,23 @@ public:
 	}
 
 	template<typename T>
-	static std::vector<intrusive_ptr<T> > GetObjectsByType()
+	static ConfigObjectsSnapshot<T> GetObjectsByType()
 	{
-		std::vector<intrusive_ptr<ConfigObject> > objects = GetObjectsHelper(T::TypeInstance.get());
-		std::vector<intrusive_ptr<T> > result;
-		result.reserve(objects.size());
-for (const auto& object : objects) {
-			result.push_back(static_pointer_cast<T>(object));
+		ConfigType *ctype = GetConfigType(T::TypeInstance.get());
+		std::shared_ptr<const Snapshot> snapshot = std::atomic_load(&ctype->m_Snapshot);
+
+		if (!snapshot)
+			snapshot = ctype->PublishSnapshot(&TypedSnapshot<T>::Create);
+
+		auto typedSnapshot = std::dynamic_pointer_cast<const TypedSnapshot<T> >(snapshot);
+
+		/* Another type which shares the same TypeInstance has published its snapshot. */
+		if (!typedSnapshot) {
+			boost::mutex::scoped_lock lock(ctype->m_Mutex);
+			typedSnapshot = TypedSnapshot<T>::CreateTyped(ctype->m_ObjectVector);
 		}
-		return result;
+
+		return ConfigObjectsSnapshot<T>(std::shared_ptr<const std::vector<intrusive_ptr<T> > >(typedSnapshot, &typedSnapshot->Objects));
 	}
 
 	int GetObjectCount() const;
@@ -67,11 +118,45 @@ private:
 	typedef std::map<String, intrusive_ptr<ConfigObject> > ObjectMap;
 	typedef std::vector<intrusive_ptr<ConfigObject> > ObjectVector;
 
+	struct Snapshot
+	{
+		virtual ~Snapshot() = default;
+	};
+
+	template<typename T>
+	struct TypedSnapshot final : Snapshot
+	{
+		std::vector<intrusive_ptr<T> > Objects;
+
+		static std::shared_ptr<const TypedSnapshot<T> > CreateTyped(const ObjectVector& objects)
+		{
+			auto snapshot = std::make_shared<TypedSnapshot<T> >();
+			snapshot->Objects.reserve(objects.size());
+
+			for (const auto& object : objects)
+				snapshot->Objects.push_back(static_pointer_cast<T>(object));
+
+			return snapshot;
+		}
+
+		static std::shared_ptr<const Snapshot> Create(const ObjectVector& objects)
+		{
+			return CreateTyped(objects);
+		}
+	};
+
+	typedef std::shared_ptr<const Snapshot> (*SnapshotFactory)(const ObjectVector& objects);
+
 	mutable boost::mutex m_Mutex;
 	ObjectMap m_ObjectMap;
 	ObjectVector m_ObjectVector;
 
-	static std::vector<intrusive_ptr<ConfigObject> > GetObjectsHelper(Type *type);
+	/* Published with std::atomic_store(), reset whenever the objects change. */
+	std::shared_ptr<const Snapshot> m_Snapshot;
+
+	std::shared_ptr<const Snapshot> PublishSnapshot(SnapshotFactory factory);
+
+	static ConfigType *GetConfigType(Type *type);
 };
 
 }
@@ -96,7 +96,7 @@ void ConfigWriter::EmitScope(std::ostream& fp, int indentLevel, const Dictionary
 
 			if (splitDot) {
 				std::vector<String> tokens;
-				boost::algorithm::split(tokens, kv.first, boost::is_any_of("."));
+				boost::algorithm::split(tokens, kv.first.GetString(), boost::is_any_of("."));
 
 				EmitIdentifier(fp, tokens[0], true);
 
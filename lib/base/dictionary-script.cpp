@@ -74,7 +74,7 @@ static Array::Ptr DictionaryKeys()
 	ArrayData keys;
 	ObjectLock olock(self);
 	for (const Dictionary::Pair& kv : self) {
-		keys.push_back(kv.first);
+		keys.push_back(kv.first.GetString());
 	}
 	return new Array(std::move(keys));
 }
@@ -17,33 +17,78 @@
  * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
  ******************************************************************************/
 
+
 #include "base/dictionary.hpp"
 #include "base/objectlock.hpp"
 #include "base/debug.hpp"
 #include "base/primitivetype.hpp"
 #include "base/configwriter.hpp"
+#include <algorithm>
 
 using namespace icinga;
 
-template class std::map<String, Value>;
+template class std::vector<Dictionary::Pair>;
 
 REGISTER_PRIMITIVE_TYPE(Dictionary, Object, Dictionary::GetPrototype());
 
+/* Dictionaries with at least this many items use a hash table for lookups. */
+static const Dictionary::SizeType l_DictionaryHashThreshold = 16;
+
+static bool DictionaryKeyLessThan(const Dictionary::Pair& lhs, const Dictionary::Pair& rhs)
+{
+	return lhs.first < rhs.first;
+}
+
+static bool DictionaryKeyLessThanKey(const Dictionary::Pair& lhs, const InternedString& rhs)
+{
+	return lhs.first < rhs;
+}
+
 Dictionary::Dictionary(const DictionaryData& other)
 {
+	m_Data.reserve(other.size());
+
 	for (const auto& kv : other)
-		m_Data.insert(kv);
+		m_Data.emplace_back(InternedString(kv.first), kv.second);
+
+	Initialize();
 }
 
 Dictionary::Dictionary(DictionaryData&& other)
 {
+	m_Data.reserve(other.size());
+
 	for (auto& kv : other)
-		m_Data.insert(std::move(kv));
+		m_Data.emplace_back(InternedString(kv.first), std::move(kv.second));
+
+	Initialize();
 }
 
-Dictionary::Dictionary(std::initializer_list<Dictionary::Pair> init)
-	: m_Data(init)
-{ }
+Dictionary::Dictionary(std::initializer_list<DictionaryData::value_type> init)
+{
+	m_Data.reserve(init.size());
+
+	for (const auto& kv : init)
+		m_Data.emplace_back(InternedString(kv.first), kv.second);
+
+	Initialize();
+}
+
+/**
+ * Sorts the items which were passed to one of the constructors. The first
+ * item wins if there are duplicate keys.
+ */
+void Dictionary::Initialize()
+{
+	std::stable_sort(m_Data.begin(), m_Data.end(), DictionaryKeyLessThan);
+
+	m_Data.erase(std::unique(m_Data.begin(), m_Data.end(), [](const Pair& lhs, const Pair& rhs) {
+		return lhs.first == rhs.first;
+	}), m_Data.end());
+
+	if (m_Data.size() >= l_DictionaryHashThreshold)
+		RebuildIndex();
+}
 
 /**
  * Retrieves a value from a dictionary.
@@ -55,7 +100,7 @@ Value Dictionary::Get(const String& key) const
 {
 	ObjectLock olock(this);
 
-	auto it = m_Data.find(key);
+	auto it = Find(InternedString::Borrow(key));
 
 	if (it == m_Data.end())
 		return Empty;
@@ -74,7 +119,7 @@ bool Dictionary::Get(const String& key, Value *result) const
 {
 	ObjectLock olock(this);
 
-	auto it = m_Data.find(key);
+	auto it = Find(InternedString::Borrow(key));
 
 	if (it == m_Data.end())
 		return false;
@@ -93,7 +138,21 @@ void Dictionary::Set(const String& key, Value value)
 {
 	ObjectLock olock(this);
 
-	m_Data[key] = std::move(value);
+	SetInternal(InternedString::Borrow(key), true, std::move(value));
+}
+
+/**
+ * Sets a value in the dictionary. Unlike the overload for plain strings
+ * this does not need to look up the key in the string table.
+ *
+ * @param key The key.
+ * @param value The value.
+ */
+void Dictionary::Set(const InternedString& key, Value value)
+{
+	ObjectLock olock(this);
+
+	SetInternal(key, false, std::move(value));
 }
 
 /**
@@ -118,7 +177,7 @@ bool Dictionary::Contains(const String& key) const
 {
 	ObjectLock olock(this);
 
-	return (m_Data.find(key) != m_Data.end());
+	return (Find(InternedString::Borrow(key)) != m_Data.end());
 }
 
 /**
@@ -132,6 +191,8 @@ Dictionary::Iterator Dictionary::Begin()
 {
 	ASSERT(OwnsLock());
 
+	Sort();
+
 	return m_Data.begin();
 }
 
@@ -158,7 +219,7 @@ void Dictionary::Remove(Dictionary::Iterator it)
 {
 	ASSERT(OwnsLock());
 
-	m_Data.erase(it);
+	RemoveAt(it - m_Data.begin());
 }
 
 /**
@@ -170,13 +231,12 @@ void Dictionary::Remove(const String& key)
 {
 	ObjectLock olock(this);
 
-	Dictionary::Iterator it;
-	it = m_Data.find(key);
+	auto it = Find(InternedString::Borrow(key));
 
 	if (it == m_Data.end())
 		return;
 
-	m_Data.erase(it);
+	RemoveAt(it - m_Data.begin());
 }
 
 /**
@@ -187,14 +247,25 @@ void Dictionary::Clear()
 	ObjectLock olock(this);
 
 	m_Data.clear();
+	m_Index.clear();
+	m_Sorted = true;
 }
 
 void Dictionary::CopyTo(const Dictionary::Ptr& dest) const
 {
 	ObjectLock olock(this);
+	ObjectLock dlock(dest);
+
+	Sort();
+
+	if (dest->m_Data.empty()) {
+		dest->m_Data = m_Data;
+		dest->m_Index = m_Index;
+		return;
+	}
 
 	for (const Dictionary::Pair& kv : m_Data) {
-		dest->Set(kv.first, kv.second);
+		dest->SetInternal(kv.first, false, Value(kv.second));
 	}
 }
 
@@ -218,19 +289,21 @@ Dictionary::Ptr Dictionary::ShallowClone() const
  */
 Object::Ptr Dictionary::Clone() const
 {
-	DictionaryData dict;
+	Dictionary::Ptr clone = new Dictionary();
+
+	ObjectLock olock(this);
 
-	{
-		ObjectLock olock(this);
+	Sort();
 
-		dict.reserve(GetLength());
+	clone->m_Data.reserve(m_Data.size());
 
-		for (const Dictionary::Pair& kv : m_Data) {
-			dict.emplace_back(kv.first, kv.second.Clone());
-		}
+	for (const Dictionary::Pair& kv : m_Data) {
+		clone->m_Data.emplace_back(kv.first, kv.second.Clone());
 	}
 
-	return new Dictionary(std::move(dict));
+	clone->m_Index = m_Index;
+
+	return clone;
 }
 
 /**
@@ -243,6 +316,8 @@ std::vector<String> Dictionary::GetKeys() const
 {
 	ObjectLock olock(this);
 
+	Sort();
+
 	std::vector<String> keys;
 
 	for (const Dictionary::Pair& kv : m_Data) {
@@ -284,6 +359,177 @@ bool Dictionary::GetOwnField(const String& field, Value *result) const
 	return Get(field, result);
 }
 
+/**
+ * Looks up an item. The caller must hold the object lock.
+ *
+ * @param key The key.
+ * @returns An iterator for the item or End() if there is no such item.
+ */
+Dictionary::Iterator Dictionary::Find(const InternedString& key) const
+{
+	if (m_Index.empty()) {
+		auto it = std::lower_bound(m_Data.begin(), m_Data.end(), key, DictionaryKeyLessThanKey);
+
+		if (it != m_Data.end() && it->first == key)
+			return it;
+
+		return m_Data.end();
+	}
+
+	size_t hash = key.GetHash();
+	size_t mask = m_Index.size() - 1;
+
+	for (size_t slot = hash & mask; m_Index[slot] != 0; slot = (slot + 1) & mask) {
+		auto it = m_Data.begin() + (m_Index[slot] - 1);
+
+		if (it->first.GetHash() == hash && it->first == key)
+			return it;
+	}
+
+	return m_Data.end();
+}
+
+/**
+ * Sets a value. The caller must hold the object lock.
+ *
+ * @param key The key.
+ * @param intern Whether the key has to be added to the string table
+ *               before storing it, i.e. whether it was borrowed.
+ * @param value The value.
+ */
+void Dictionary::SetInternal(const InternedString& key, bool intern, Value&& value)
+{
+	if (m_Index.empty()) {
+		auto it = std::lower_bound(m_Data.begin(), m_Data.end(), key, DictionaryKeyLessThanKey);
+
+		if (it != m_Data.end() && it->first == key) {
+			it->second = std::move(value);
+			return;
+		}
+
+		m_Data.emplace(it, intern ? InternedString(key.GetString()) : key, std::move(value));
+
+		if (m_Data.size() >= l_DictionaryHashThreshold)
+			RebuildIndex();
+
+		return;
+	}
+
+	auto it = Find(key);
+
+	if (it != m_Data.end()) {
+		it->second = std::move(value);
+		return;
+	}
+
+	/* Keys which are added in order (e.g. when copying a dictionary) keep the dictionary sorted. */
+	if (m_Sorted && !m_Data.empty() && key < m_Data.back().first)
+		m_Sorted = false;
+
+	m_Data.emplace_back(intern ? InternedString(key.GetString()) : key, std::move(value));
+
+	if (m_Data.size() * 2 > m_Index.size())
+		RebuildIndex();
+	else
+		AddToIndex(m_Data.size() - 1);
+}
+
+/**
+ * Removes an item. The caller must hold the object lock.
+ *
+ * Large dictionaries move their last item into the gap, which means
+ * they have to be sorted again before iterating over them.
+ *
+ * @param pos The item's position.
+ */
+void Dictionary::RemoveAt(Dictionary::SizeType pos)
+{
+	if (m_Index.empty()) {
+		m_Data.erase(m_Data.begin() + pos);
+		return;
+	}
+
+	size_t mask = m_Index.size() - 1;
+	size_t hole = FindIndexSlot(pos);
+
+	/* Move items which would otherwise become unreachable into the gap in the hash table. */
+	for (size_t slot = (hole + 1) & mask; m_Index[slot] != 0; slot = (slot + 1) & mask) {
+		size_t home = m_Data[m_Index[slot] - 1].first.GetHash() & mask;
+
+		if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+			m_Index[hole] = m_Index[slot];
+			hole = slot;
+		}
+	}
+
+	m_Index[hole] = 0;
+
+	SizeType last = m_Data.size() - 1;
+
+	if (pos != last) {
+		m_Index[FindIndexSlot(last)] = pos + 1;
+		m_Data[pos] = std::move(m_Data[last]);
+		m_Sorted = false;
+	}
+
+	m_Data.pop_back();
+}
+
+/**
+ * Sorts the items by key. The caller must hold the object lock.
+ */
+void Dictionary::Sort() const
+{
+	if (m_Sorted)
+		return;
+
+	std::sort(m_Data.begin(), m_Data.end(), DictionaryKeyLessThan);
+	RebuildIndex();
+
+	m_Sorted = true;
+}
+
+void Dictionary::RebuildIndex() const
+{
+	size_t size = l_DictionaryHashThreshold * 2;
+
+	while (size < m_Data.size() * 2)
+		size *= 2;
+
+	m_Index.assign(size, 0);
+
+	for (SizeType pos = 0; pos < m_Data.size(); pos++)
+		AddToIndex(pos);
+}
+
+void Dictionary::AddToIndex(Dictionary::SizeType pos) const
+{
+	size_t mask = m_Index.size() - 1;
+	size_t slot = m_Data[pos].first.GetHash() & mask;
+
+	while (m_Index[slot] != 0)
+		slot = (slot + 1) & mask;
+
+	m_Index[slot] = pos + 1;
+}
+
+/**
+ * Returns the hash table slot which refers to the specified item.
+ *
+ * @param pos The item's position.
+ * @returns The slot.
+ */
+Dictionary::SizeType Dictionary::FindIndexSlot(Dictionary::SizeType pos) const
+{
+	size_t mask = m_Index.size() - 1;
+	size_t slot = m_Data[pos].first.GetHash() & mask;
+
+	while (m_Index[slot] != pos + 1)
+		slot = (slot + 1) & mask;
+
+	return slot;
+}
+
 Dictionary::Iterator icinga::begin(const Dictionary::Ptr& x)
 {
 	return x->Begin();
@@ -293,4 +539,3 @@ Dictionary::Iterator icinga::end(const Dictionary::Ptr& x)
 {
 	return x->End();
 }
-
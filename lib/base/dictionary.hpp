@@ -23,8 +23,9 @@
 #include "base/i2-base.hpp"
 #include "base/object.hpp"
 #include "base/value.hpp"
+#include "base/internedstring.hpp"
 #include <boost/range/iterator.hpp>
-#include <map>
+#include <cstdint>
 #include <vector>
 
 namespace icinga
@@ -33,11 +34,16 @@ namespace icinga
 typedef std::vector<std::pair<String, Value> > DictionaryData;
 
 /**
- * A container that holds key-value pairs.
+ * A container that holds key-value pairs. Keys are stored in the global
+ * string table.
+ *
+ * Items are stored in a vector which is sorted by key. Large dictionaries
+ * additionally use a hash table for lookups and are only sorted when
+ * iterating over them.
  *
  * @ingroup base
  */
-class Dictionary final : public Object
+class Dictionary : public Object
 {
 public:
 	DECLARE_OBJECT(Dictionary);
@@ -45,20 +51,21 @@ public:
 	/**
 	 * An iterator that can be used to iterate over dictionary elements.
 	 */
-	typedef std::map<String, Value>::iterator Iterator;
+	typedef std::vector<std::pair<InternedString, Value> >::iterator Iterator;
 
-	typedef std::map<String, Value>::size_type SizeType;
+	typedef std::vector<std::pair<InternedString, Value> >::size_type SizeType;
 
-	typedef std::map<String, Value>::value_type Pair;
+	typedef std::pair<InternedString, Value> Pair;
 
 	Dictionary() = default;
 	Dictionary(const DictionaryData& other);
 	Dictionary(DictionaryData&& other);
-	Dictionary(std::initializer_list<Pair> init);
+	Dictionary(std::initializer_list<DictionaryData::value_type> init);
 
 	Value Get(const String& key) const;
 	bool Get(const String& key, Value *result) const;
 	void Set(const String& key, Value value);
+	void Set(const InternedString& key, Value value);
 	bool Contains(const String& key) const;
 
 	Iterator Begin();
@@ -89,7 +96,18 @@ public:
 	bool GetOwnField(const String& field, Value *result) const override;
 
 private:
-	std::map<String, Value> m_Data; /**< The data for the dictionary. */
+	mutable std::vector<Pair> m_Data; /**< The data for the dictionary. */
+	mutable std::vector<uint32_t> m_Index; /**< Positions in m_Data by hash, empty for small dictionaries. */
+	mutable bool m_Sorted{true};
+
+	void Initialize();
+	Iterator Find(const InternedString& key) const;
+	void SetInternal(const InternedString& key, bool intern, Value&& value);
+	void RemoveAt(SizeType pos);
+	void Sort() const;
+	void RebuildIndex() const;
+	void AddToIndex(SizeType pos) const;
+	SizeType FindIndexSlot(SizeType pos) const;
 };
 
 Dictionary::Iterator begin(const Dictionary::Ptr& x);
@@ -97,6 +115,6 @@ Dictionary::Iterator end(const Dictionary::Ptr& x);
 
 }
 
-extern template class std::map<icinga::String, icinga::Value>;
+extern template class std::vector<std::pair<icinga::InternedString, icinga::Value> >;
 
 #endif /* DICTIONARY_H */
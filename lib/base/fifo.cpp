@@ -18,57 +18,105 @@
  ******************************************************************************/
 
 #include "base/fifo.hpp"
+#include <boost/thread/tss.hpp>
+#include <atomic>
 
 using namespace icinga;
 
-/**
- * Destructor for the FIFO class.
- */
-FIFO::~FIFO()
+struct FIFO::Block
 {
-	free(m_Buffer);
-}
+	Block *Next;
+	char Data[FIFO::BlockSize];
+};
 
 /**
- * Resizes the FIFO's buffer so that it is at least newSize bytes long.
- *
- * @param newSize The minimum new size of the FIFO buffer.
+ * Free blocks which are kept around for the next FIFO::Write() on this thread.
  */
-void FIFO::ResizeBuffer(size_t newSize, bool decrease)
+struct FIFO::BlockCache
 {
-	if (m_AllocSize >= newSize && !decrease)
-		return;
+	Block *Head{nullptr};
+	size_t Count{0};
 
-	newSize = (newSize / FIFO::BlockSize + 1) * FIFO::BlockSize;
+	~BlockCache();
+};
 
-	if (newSize == m_AllocSize)
-		return;
+/* The maximum number of free blocks per thread. */
+static const size_t l_MaxCachedBlocks = 64;
+
+static std::atomic<size_t> l_BlocksInUse(0);
+static std::atomic<size_t> l_BlocksCached(0);
 
-	auto *newBuffer = static_cast<char *>(realloc(m_Buffer, newSize));
+FIFO::BlockCache::~BlockCache()
+{
+	while (Head) {
+		Block *block = Head;
+		Head = block->Next;
+		delete block;
+		l_BlocksCached--;
+	}
+}
+
+FIFO::BlockCache *FIFO::GetBlockCache()
+{
+	/* Intentionally leaked, FIFOs might be destroyed during static destruction. */
+	static auto *caches = new boost::thread_specific_ptr<BlockCache>();
 
-	if (!newBuffer)
-		BOOST_THROW_EXCEPTION(std::bad_alloc());
+	BlockCache *cache = caches->get();
 
-	m_Buffer = newBuffer;
+	if (!cache) {
+		cache = new BlockCache();
+		caches->reset(cache);
+	}
 
-	m_AllocSize = newSize;
+	return cache;
 }
 
 /**
- * Optimizes memory usage of the FIFO buffer by reallocating
- * and moving the buffer.
+ * Destructor for the FIFO class.
  */
-void FIFO::Optimize()
+FIFO::~FIFO()
+{
+	while (m_Head) {
+		Block *block = m_Head;
+		m_Head = block->Next;
+		FreeBlock(block);
+	}
+}
+
+FIFO::Block *FIFO::AllocateBlock()
 {
-	if (m_Offset > m_DataSize / 10 && m_Offset - m_DataSize > 1024) {
-		std::memmove(m_Buffer, m_Buffer + m_Offset, m_DataSize);
-		m_Offset = 0;
+	BlockCache *cache = GetBlockCache();
+	Block *block;
 
-		if (m_DataSize > 0)
-			ResizeBuffer(m_DataSize, true);
+	if (cache->Head) {
+		block = cache->Head;
+		cache->Head = block->Next;
+		cache->Count--;
+		l_BlocksCached--;
+	} else
+		block = new Block;
 
+	block->Next = nullptr;
+	l_BlocksInUse++;
+
+	return block;
+}
+
+void FIFO::FreeBlock(Block *block)
+{
+	l_BlocksInUse--;
+
+	BlockCache *cache = GetBlockCache();
+
+	if (cache->Count >= l_MaxCachedBlocks) {
+		delete block;
 		return;
 	}
+
+	block->Next = cache->Head;
+	cache->Head = block;
+	cache->Count++;
+	l_BlocksCached++;
 }
 
 size_t FIFO::Peek(void *buffer, size_t count, bool allow_partial)
@@ -78,8 +126,17 @@ size_t FIFO::Peek(void *buffer, size_t count, bool allow_partial)
 	if (count > m_DataSize)
 		count = m_DataSize;
 
-	if (buffer)
-		std::memcpy(buffer, m_Buffer + m_Offset, count);
+	if (buffer) {
+		size_t offset = m_HeadOffset;
+		size_t copied = 0;
+
+		for (Block *block = m_Head; copied < count; block = block->Next) {
+			size_t length = std::min(BlockSize - offset, count - copied);
+			std::memcpy(static_cast<char *>(buffer) + copied, block->Data + offset, length);
+			copied += length;
+			offset = 0;
+		}
+	}
 
 	return count;
 }
@@ -94,13 +151,38 @@ size_t FIFO::Read(void *buffer, size_t count, bool allow_partial)
 	if (count > m_DataSize)
 		count = m_DataSize;
 
-	if (buffer)
-		std::memcpy(buffer, m_Buffer + m_Offset, count);
+	size_t copied = 0;
+
+	while (copied < count) {
+		size_t length = std::min(BlockSize - m_HeadOffset, count - copied);
+
+		if (buffer)
+			std::memcpy(static_cast<char *>(buffer) + copied, m_Head->Data + m_HeadOffset, length);
+
+		copied += length;
+		m_HeadOffset += length;
+
+		if (m_HeadOffset == BlockSize) {
+			Block *block = m_Head;
+			m_Head = block->Next;
+			m_HeadOffset = 0;
+			FreeBlock(block);
+
+			if (!m_Head) {
+				m_Tail = nullptr;
+				m_TailSize = 0;
+			}
+		}
+	}
 
 	m_DataSize -= count;
-	m_Offset += count;
 
-	Optimize();
+	/* Start over at the beginning of the block once it's empty. */
+	if (m_DataSize == 0 && m_Head) {
+		FreeBlock(m_Head);
+		m_Head = m_Tail = nullptr;
+		m_HeadOffset = m_TailSize = 0;
+	}
 
 	return count;
 }
@@ -110,8 +192,27 @@ size_t FIFO::Read(void *buffer, size_t count, bool allow_partial)
  */
 void FIFO::Write(const void *buffer, size_t count)
 {
-	ResizeBuffer(m_Offset + m_DataSize + count, false);
-	std::memcpy(m_Buffer + m_Offset + m_DataSize, buffer, count);
+	size_t copied = 0;
+
+	while (copied < count) {
+		if (!m_Tail || m_TailSize == BlockSize) {
+			Block *block = AllocateBlock();
+
+			if (m_Tail)
+				m_Tail->Next = block;
+			else
+				m_Head = block;
+
+			m_Tail = block;
+			m_TailSize = 0;
+		}
+
+		size_t length = std::min(BlockSize - m_TailSize, count - copied);
+		std::memcpy(m_Tail->Data + m_TailSize, static_cast<const char *>(buffer) + copied, length);
+		m_TailSize += length;
+		copied += length;
+	}
+
 	m_DataSize += count;
 
 	SignalDataAvailable();
@@ -139,3 +240,23 @@ bool FIFO::IsDataAvailable() const
 {
 	return m_DataSize > 0;
 }
+
+/**
+ * Returns the amount of memory which is used by the data in all FIFOs.
+ *
+ * @returns The number of bytes.
+ */
+size_t FIFO::GetBufferMemory()
+{
+	return l_BlocksInUse * BlockSize;
+}
+
+/**
+ * Returns the amount of memory which is held in the per-thread free lists.
+ *
+ * @returns The number of bytes.
+ */
+size_t FIFO::GetPooledMemory()
+{
+	return l_BlocksCached * BlockSize;
+}
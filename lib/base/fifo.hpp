@@ -27,7 +27,8 @@ namespace icinga
 {
 
 /**
- * A byte-based FIFO buffer.
+ * A byte-based FIFO buffer. Data is stored in a list of fixed-size blocks
+ * which are recycled through per-thread free lists.
  *
  * @ingroup base
  */
@@ -36,7 +37,7 @@ class FIFO final : public Stream
 public:
 	DECLARE_PTR_TYPEDEFS(FIFO);
 
-	static const size_t BlockSize = 512;
+	static const size_t BlockSize = 16 * 1024;
 
 	~FIFO() override;
 
@@ -50,14 +51,22 @@ public:
 
 	size_t GetAvailableBytes() const;
 
+	static size_t GetBufferMemory();
+	static size_t GetPooledMemory();
+
 private:
-	char *m_Buffer{nullptr};
+	struct Block;
+	struct BlockCache;
+
+	Block *m_Head{nullptr};
+	Block *m_Tail{nullptr};
+	size_t m_HeadOffset{0};
+	size_t m_TailSize{0};
 	size_t m_DataSize{0};
-	size_t m_AllocSize{0};
-	size_t m_Offset{0};
 
-	void ResizeBuffer(size_t newSize, bool decrease);
-	void Optimize();
+	static BlockCache *GetBlockCache();
+	static Block *AllocateBlock();
+	static void FreeBlock(Block *block);
 };
 
 }
@@ -0,0 +1,349 @@
+/******************************************************************************
+ * Icinga 2                                                                   *
+ * Copyright (C) 2012-2018 Icinga Development Team (https://www.icinga.com/)  *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or              *
+ * modify it under the terms of the GNU General Public License                *
+ * as published by the Free Software Foundation; either version 2             *
+ * of the License, or (at your option) any later version.                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software Foundation     *
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
+ ******************************************************************************/
+
+
+#include "base/internedstring.hpp"
+#include <boost/thread/mutex.hpp>
+#include <algorithm>
+#include <ostream>
+#include <vector>
+
+using namespace icinga;
+
+/* Unused strings are removed once a shard has grown to this number of strings. */
+static const size_t l_InternedStringMinSweep = 256;
+
+namespace
+{
+
+struct InternedStringShard
+{
+	boost::mutex Mutex;
+	std::vector<InternedStringEntry *> Slots;
+	size_t Count{0};
+	size_t Memory{0};
+	size_t SweepThreshold{l_InternedStringMinSweep};
+};
+
+}
+
+static const size_t l_InternedStringShardCount = 32;
+
+static InternedStringShard *GetInternedStringShards()
+{
+	static InternedStringShard shards[l_InternedStringShardCount];
+	return shards;
+}
+
+static size_t GetInternedStringEntrySize(const InternedStringEntry *entry)
+{
+	size_t size = sizeof(InternedStringEntry) + sizeof(InternedStringEntry *);
+
+	if (entry->Str.GetData().capacity() >= sizeof(std::string))
+		size += entry->Str.GetData().capacity() + 1;
+
+	return size;
+}
+
+static void InsertInternedStringSlot(std::vector<InternedStringEntry *>& slots, InternedStringEntry *entry)
+{
+	size_t mask = slots.size() - 1;
+	size_t index = entry->Hash & mask;
+
+	while (slots[index])
+		index = (index + 1) & mask;
+
+	slots[index] = entry;
+}
+
+/**
+ * Removes all strings which are neither permanent nor referenced anymore
+ * and resizes the shard's hash table. The caller must hold the shard's mutex.
+ *
+ * New references to unreferenced strings can only be obtained through
+ * Intern(), so we don't have to worry about concurrent AddReference() calls.
+ */
+static void RebuildInternedStringShard(InternedStringShard& shard, bool sweep)
+{
+	std::vector<InternedStringEntry *> entries;
+	entries.reserve(shard.Count);
+
+	for (InternedStringEntry *entry : shard.Slots) {
+		if (!entry)
+			continue;
+
+		if (sweep && !entry->Permanent.load(std::memory_order_relaxed) &&
+		    entry->References.load(std::memory_order_acquire) == 0) {
+			shard.Memory -= GetInternedStringEntrySize(entry);
+			delete entry;
+			continue;
+		}
+
+		entries.push_back(entry);
+	}
+
+	shard.Count = entries.size();
+
+	if (sweep)
+		shard.SweepThreshold = std::max(l_InternedStringMinSweep, shard.Count * 2);
+
+	size_t size = 16;
+
+	while (size < (shard.Count + 1) * 2)
+		size *= 2;
+
+	shard.Slots.assign(size, nullptr);
+
+	for (InternedStringEntry *entry : entries)
+		InsertInternedStringSlot(shard.Slots, entry);
+}
+
+InternedStringEntry::InternedStringEntry(const char *data, size_t length, size_t hash)
+	: Str(data, data + length), Hash(hash), References(0), Permanent(false)
+{ }
+
+InternedString::InternedString()
+	: m_Data(reinterpret_cast<uintptr_t>(GetEmptyEntry()))
+{ }
+
+InternedString::InternedString(const String& str, bool permanent)
+	: m_Data(reinterpret_cast<uintptr_t>(Intern(str.CStr(), str.GetLength(), permanent)))
+{ }
+
+InternedString::InternedString(const char *str, bool permanent)
+	: m_Data(reinterpret_cast<uintptr_t>(Intern(str, strlen(str), permanent)))
+{ }
+
+InternedString::InternedString(uintptr_t data)
+	: m_Data(data)
+{ }
+
+InternedString::InternedString(const InternedString& other)
+	: m_Data(other.m_Data)
+{
+	AddReference();
+}
+
+InternedString::InternedString(InternedString&& other)
+	: m_Data(other.m_Data)
+{
+	other.m_Data = reinterpret_cast<uintptr_t>(GetEmptyEntry());
+}
+
+InternedString::~InternedString()
+{
+	RemoveReference();
+}
+
+InternedString& InternedString::operator=(const InternedString& rhs)
+{
+	rhs.AddReference();
+	RemoveReference();
+	m_Data = rhs.m_Data;
+	return *this;
+}
+
+InternedString& InternedString::operator=(InternedString&& rhs)
+{
+	std::swap(m_Data, rhs.m_Data);
+	return *this;
+}
+
+/**
+ * Returns a key which refers to the specified string without interning it.
+ * The key must not outlive the string and is only meant for lookups.
+ *
+ * @param str The string.
+ * @returns The key.
+ */
+InternedStringEntry *InternedString::GetEmptyEntry()
+{
+	static InternedStringEntry *entry = Intern("", 0, true);
+	return entry;
+}
+
+InternedString InternedString::Borrow(const String& str)
+{
+	return InternedString(reinterpret_cast<uintptr_t>(&str) | BorrowedTag);
+}
+
+size_t InternedString::GetHash() const
+{
+	if (m_Data & BorrowedTag)
+		return HashString(CStr(), GetLength());
+	else
+		return GetEntry()->Hash;
+}
+
+/**
+ * Calculates the FNV-1a hash for the specified data.
+ *
+ * @param data The data.
+ * @param length The length of the data.
+ * @returns The hash.
+ */
+size_t InternedString::HashString(const char *data, size_t length)
+{
+	uint64_t hash = 14695981039346656037ULL;
+
+	for (size_t i = 0; i < length; i++) {
+		hash ^= static_cast<unsigned char>(data[i]);
+		hash *= 1099511628211ULL;
+	}
+
+	return static_cast<size_t>(hash);
+}
+
+/**
+ * Looks up a string in the string table and adds it if necessary.
+ *
+ * @param data The string.
+ * @param length The length of the string.
+ * @param permanent Whether the string should never be removed from the table.
+ * @returns The table entry, which holds a reference for the caller.
+ */
+InternedStringEntry *InternedString::Intern(const char *data, size_t length, bool permanent)
+{
+	size_t hash = HashString(data, length);
+	InternedStringShard& shard = GetInternedStringShards()[(hash >> 24) % l_InternedStringShardCount];
+
+	boost::mutex::scoped_lock lock(shard.Mutex);
+
+	if (!shard.Slots.empty()) {
+		size_t mask = shard.Slots.size() - 1;
+
+		for (size_t index = hash & mask; shard.Slots[index]; index = (index + 1) & mask) {
+			InternedStringEntry *entry = shard.Slots[index];
+
+			if (entry->Hash != hash || entry->Str.GetLength() != length || memcmp(entry->Str.CStr(), data, length) != 0)
+				continue;
+
+			if (permanent)
+				entry->Permanent.store(true, std::memory_order_relaxed);
+			else if (!entry->Permanent.load(std::memory_order_relaxed))
+				entry->References.fetch_add(1, std::memory_order_relaxed);
+
+			return entry;
+		}
+	}
+
+	if (shard.Count + 1 > shard.SweepThreshold)
+		RebuildInternedStringShard(shard, true);
+	else if ((shard.Count + 1) * 2 > shard.Slots.size())
+		RebuildInternedStringShard(shard, false);
+
+	auto *entry = new InternedStringEntry(data, length, hash);
+
+	if (permanent)
+		entry->Permanent.store(true, std::memory_order_relaxed);
+	else
+		entry->References.store(1, std::memory_order_relaxed);
+
+	InsertInternedStringSlot(shard.Slots, entry);
+	shard.Count++;
+	shard.Memory += GetInternedStringEntrySize(entry);
+
+	return entry;
+}
+
+void InternedString::AddReference() const
+{
+	if (m_Data & BorrowedTag)
+		return;
+
+	InternedStringEntry *entry = GetEntry();
+
+	if (!entry->Permanent.load(std::memory_order_relaxed))
+		entry->References.fetch_add(1, std::memory_order_relaxed);
+}
+
+void InternedString::RemoveReference() const
+{
+	if (m_Data & BorrowedTag)
+		return;
+
+	InternedStringEntry *entry = GetEntry();
+
+	if (!entry->Permanent.load(std::memory_order_relaxed))
+		entry->References.fetch_sub(1, std::memory_order_release);
+}
+
+/**
+ * Returns the number of strings in the string table.
+ *
+ * @returns The number of strings.
+ */
+size_t InternedString::GetCount()
+{
+	size_t count = 0;
+
+	for (size_t i = 0; i < l_InternedStringShardCount; i++) {
+		InternedStringShard& shard = GetInternedStringShards()[i];
+		boost::mutex::scoped_lock lock(shard.Mutex);
+		count += shard.Count;
+	}
+
+	return count;
+}
+
+/**
+ * Returns the approximate amount of memory used by the string table.
+ *
+ * @returns The memory usage in bytes.
+ */
+size_t InternedString::GetMemoryUsage()
+{
+	size_t memory = 0;
+
+	for (size_t i = 0; i < l_InternedStringShardCount; i++) {
+		InternedStringShard& shard = GetInternedStringShards()[i];
+		boost::mutex::scoped_lock lock(shard.Mutex);
+		memory += shard.Memory + (shard.Slots.size() - shard.Count) * sizeof(InternedStringEntry *);
+	}
+
+	return memory;
+}
+
+bool icinga::operator==(const InternedString& lhs, const InternedString& rhs)
+{
+	if (lhs.m_Data == rhs.m_Data)
+		return true;
+
+	/* Two strings from the string table are only equal if they're the same entry. */
+	if (!((lhs.m_Data | rhs.m_Data) & InternedString::BorrowedTag))
+		return false;
+
+	return lhs.GetString() == rhs.GetString();
+}
+
+bool icinga::operator!=(const InternedString& lhs, const InternedString& rhs)
+{
+	return !(lhs == rhs);
+}
+
+bool icinga::operator<(const InternedString& lhs, const InternedString& rhs)
+{
+	return lhs.m_Data != rhs.m_Data && lhs.GetString() < rhs.GetString();
+}
+
+std::ostream& icinga::operator<<(std::ostream& stream, const InternedString& str)
+{
+	stream << str.GetString();
+	return stream;
+}
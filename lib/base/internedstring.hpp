@@ -0,0 +1,141 @@
+/******************************************************************************
+ * Icinga 2                                                                   *
+ * Copyright (C) 2012-2018 Icinga Development Team (https://www.icinga.com/)  *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or              *
+ * modify it under the terms of the GNU General Public License                *
+ * as published by the Free Software Foundation; either version 2             *
+ * of the License, or (at your option) any later version.                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software Foundation     *
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
+ ******************************************************************************/
+
+
+#ifndef INTERNEDSTRING_H
+#define INTERNEDSTRING_H
+
+#include "base/i2-base.hpp"
+#include "base/string.hpp"
+#include <atomic>
+#include <iosfwd>
+
+namespace icinga
+{
+
+class Dictionary;
+
+/**
+ * An entry in the global string table.
+ *
+ * @ingroup base
+ */
+struct InternedStringEntry
+{
+	String Str;
+	size_t Hash;
+	std::atomic<size_t> References;
+	std::atomic<bool> Permanent;
+
+	InternedStringEntry(const char *data, size_t length, size_t hash);
+};
+
+/**
+ * A string which is stored in a global string table. All instances of the
+ * same string share one copy, which makes copies cheap and allows comparing
+ * them by pointer. The string's hash is computed only once.
+ *
+ * Strings which are no longer in use are removed from the table
+ * eventually, unless they were interned as permanent strings.
+ *
+ * @ingroup base
+ */
+class InternedString
+{
+public:
+	InternedString();
+	explicit InternedString(const String& str, bool permanent = false);
+	explicit InternedString(const char *str, bool permanent = false);
+	InternedString(const InternedString& other);
+	InternedString(InternedString&& other);
+	~InternedString();
+
+	InternedString& operator=(const InternedString& rhs);
+	InternedString& operator=(InternedString&& rhs);
+
+	inline const String& GetString() const
+	{
+		if (m_Data & BorrowedTag)
+			return *reinterpret_cast<const String *>(m_Data & ~BorrowedTag);
+		else
+			return reinterpret_cast<const InternedStringEntry *>(m_Data)->Str;
+	}
+
+	inline operator const String&() const
+	{
+		return GetString();
+	}
+
+	inline const char *CStr() const
+	{
+		return GetString().CStr();
+	}
+
+	inline String::SizeType GetLength() const
+	{
+		return GetString().GetLength();
+	}
+
+	inline bool IsEmpty() const
+	{
+		return GetString().IsEmpty();
+	}
+
+	size_t GetHash() const;
+
+	static size_t HashString(const char *data, size_t length);
+
+	static size_t GetCount();
+	static size_t GetMemoryUsage();
+
+private:
+	/* Set on keys which merely refer to a String, see Borrow(). */
+	static const uintptr_t BorrowedTag = 1;
+
+	uintptr_t m_Data;
+
+	explicit InternedString(uintptr_t data);
+
+	static InternedString Borrow(const String& str);
+
+	static InternedStringEntry *Intern(const char *data, size_t length, bool permanent);
+	static InternedStringEntry *GetEmptyEntry();
+
+	inline InternedStringEntry *GetEntry() const
+	{
+		return reinterpret_cast<InternedStringEntry *>(m_Data);
+	}
+
+	void AddReference() const;
+	void RemoveReference() const;
+
+	friend bool operator==(const InternedString& lhs, const InternedString& rhs);
+	friend bool operator<(const InternedString& lhs, const InternedString& rhs);
+	friend class Dictionary;
+};
+
+bool operator==(const InternedString& lhs, const InternedString& rhs);
+bool operator!=(const InternedString& lhs, const InternedString& rhs);
+bool operator<(const InternedString& lhs, const InternedString& rhs);
+
+std::ostream& operator<<(std::ostream& stream, const InternedString& str);
+
+}
+
+#endif /* INTERNEDSTRING_H */
@@ -23,6 +23,8 @@
 #include "base/array.hpp"
 #include "base/objectlock.hpp"
 #include "base/convert.hpp"
+#include "base/stream.hpp"
+#include "base/arena.hpp"
 #include <boost/exception_ptr.hpp>
 #include <yajl/yajl_version.h>
 #include <yajl/yajl_gen.h>
@@ -135,6 +137,100 @@ String icinga::JsonEncode(const Value& value, bool pretty_print)
 	return result;
 }
 
+/**
+ * Collects the output of yajl into a fixed-size buffer which is handed
+ * to the writer whenever it is full.
+ */
+struct JsonEncodeContext
+{
+	static const size_t BufferSize = 64 * 1024;
+
+	JsonEncodeContext(const JsonWriter& writer)
+		: Writer(writer)
+	{
+		Buffer.reserve(BufferSize);
+	}
+
+	void Flush()
+	{
+		if (Buffer.empty() || Exception)
+			return;
+
+		try {
+			Writer(Buffer.c_str(), Buffer.size());
+		} catch (...) {
+			/* Exceptions must not be thrown through yajl. */
+			Exception = boost::current_exception();
+		}
+
+		Buffer.clear();
+	}
+
+	const JsonWriter& Writer;
+	std::string Buffer;
+	boost::exception_ptr Exception;
+};
+
+static void EncodePrintCallback(void *ctx, const char *str, yajl_size len)
+{
+	auto *context = static_cast<JsonEncodeContext *>(ctx);
+
+	if (context->Buffer.size() + len > JsonEncodeContext::BufferSize)
+		context->Flush();
+
+	context->Buffer.append(str, len);
+}
+
+/**
+ * Encodes a value and hands the output to the specified writer in chunks of
+ * at most 64 KiB (unless a single string is larger than that) rather than
+ * building the whole document in memory.
+ *
+ * @param value The value.
+ * @param writer The function which is called for each chunk. It must not be called with a length of zero.
+ * @param pretty_print Whether to pretty-print the output.
+ */
+void icinga::JsonEncode(const Value& value, const JsonWriter& writer, bool pretty_print)
+{
+	JsonEncodeContext context(writer);
+
+#if YAJL_MAJOR < 2
+	yajl_gen_config conf = { pretty_print, "" };
+	yajl_gen handle = yajl_gen_alloc2(&EncodePrintCallback, &conf, nullptr, &context);
+#else /* YAJL_MAJOR */
+	yajl_gen handle = yajl_gen_alloc(nullptr);
+	yajl_gen_config(handle, yajl_gen_print_callback, &EncodePrintCallback, &context);
+	if (pretty_print)
+		yajl_gen_config(handle, yajl_gen_beautify, 1);
+#endif /* YAJL_MAJOR */
+
+	try {
+		Encode(handle, value);
+	} catch (...) {
+		yajl_gen_free(handle);
+		throw;
+	}
+
+	yajl_gen_free(handle);
+
+	context.Flush();
+
+	if (context.Exception)
+		boost::rethrow_exception(context.Exception);
+}
+
+/**
+ * Encodes a value and writes it into the specified stream.
+ *
+ * @param value The value.
+ * @param stream The stream.
+ * @param pretty_print Whether to pretty-print the output.
+ */
+void icinga::JsonEncode(const Value& value, const Stream::Ptr& stream, bool pretty_print)
+{
+	JsonEncode(value, [&stream](const char *data, size_t count) { stream->Write(data, count); }, pretty_print);
+}
+
 struct JsonElement
 {
 	String Key;
@@ -273,7 +369,7 @@ static int DecodeStartMap(void *ctx)
 	auto *context = static_cast<JsonContext *>(ctx);
 
 	try {
-		context->Push(new Dictionary());
+		context->Push(ArenaNew<Dictionary>());
 	} catch (...) {
 		context->SaveException();
 		return 0;
@@ -301,7 +397,7 @@ static int DecodeStartArray(void *ctx)
 	auto *context = static_cast<JsonContext *>(ctx);
 
 	try {
-		context->Push(new Array());
+		context->Push(ArenaNew<Array>());
 	} catch (...) {
 		context->SaveException();
 		return 0;
@@ -310,8 +406,439 @@ static int DecodeStartArray(void *ctx)
 	return 1;
 }
 
+/**
+ * A recursive descent JSON parser which builds Dictionary and Array objects
+ * directly instead of going through yajl's callbacks and a context stack.
+ *
+ * It only accepts the documents which it can decode exactly like the yajl
+ * parser does. For everything else (comments, invalid input, \u escapes
+ * for surrogates, ...) Parse() returns false and JsonDecode() falls back to
+ * yajl, which also takes care of producing error messages.
+ */
+class JsonFastParser
+{
+public:
+	JsonFastParser(const char *begin, const char *end)
+		: m_Pos(begin), m_End(end)
+	{ }
+
+	bool Parse(Value& result)
+	{
+		SkipWhitespace();
+
+		if (m_Pos == m_End || !ParseValue(result))
+			return false;
+
+		SkipWhitespace();
+
+		return m_Pos == m_End;
+	}
+
+private:
+	const char *m_Pos;
+	const char *m_End;
+	int m_Depth{0};
+
+	static const int MaxDepth = 512;
+
+	void SkipWhitespace()
+	{
+		while (m_Pos < m_End) {
+			switch (*m_Pos) {
+				case ' ':
+				case '\t':
+				case '\n':
+				case '\r':
+				case '\f':
+				case '\v':
+					m_Pos++;
+					break;
+				default:
+					return;
+			}
+		}
+	}
+
+	bool ParseLiteral(const char *literal, size_t length)
+	{
+		if (static_cast<size_t>(m_End - m_Pos) < length || memcmp(m_Pos, literal, length) != 0)
+			return false;
+
+		m_Pos += length;
+		return true;
+	}
+
+	bool ParseValue(Value& value)
+	{
+		switch (*m_Pos) {
+			case '{':
+				return ParseObject(value);
+			case '[':
+				return ParseArray(value);
+			case '"':
+				{
+					String str;
+
+					if (!ParseString(str))
+						return false;
+
+					value = std::move(str);
+					return true;
+				}
+			case 't':
+				value = true;
+				return ParseLiteral("true", 4);
+			case 'f':
+				value = false;
+				return ParseLiteral("false", 5);
+			case 'n':
+				value = Empty;
+				return ParseLiteral("null", 4);
+			default:
+				return ParseNumber(value);
+		}
+	}
+
+	bool ParseObject(Value& value)
+	{
+		if (++m_Depth > MaxDepth)
+			return false;
+
+		m_Pos++; /* '{' */
+
+		Dictionary::Ptr dict = ArenaNew<Dictionary>();
+
+		SkipWhitespace();
+
+		if (m_Pos < m_End && *m_Pos == '}') {
+			m_Pos++;
+		} else {
+			for (;;) {
+				String key;
+				Value item;
+
+				if (m_Pos == m_End || *m_Pos != '"' || !ParseString(key))
+					return false;
+
+				SkipWhitespace();
+
+				if (m_Pos == m_End || *m_Pos != ':')
+					return false;
+
+				m_Pos++;
+				SkipWhitespace();
+
+				if (m_Pos == m_End || !ParseValue(item))
+					return false;
+
+				dict->Set(key, std::move(item));
+
+				SkipWhitespace();
+
+				if (m_Pos == m_End)
+					return false;
+
+				if (*m_Pos == '}') {
+					m_Pos++;
+					break;
+				}
+
+				if (*m_Pos != ',')
+					return false;
+
+				m_Pos++;
+				SkipWhitespace();
+			}
+		}
+
+		m_Depth--;
+		value = dict;
+		return true;
+	}
+
+	bool ParseArray(Value& value)
+	{
+		if (++m_Depth > MaxDepth)
+			return false;
+
+		m_Pos++; /* '[' */
+
+		ArrayData items;
+
+		SkipWhitespace();
+
+		if (m_Pos < m_End && *m_Pos == ']') {
+			m_Pos++;
+		} else {
+			for (;;) {
+				Value item;
+
+				if (m_Pos == m_End || !ParseValue(item))
+					return false;
+
+				items.emplace_back(std::move(item));
+
+				SkipWhitespace();
+
+				if (m_Pos == m_End)
+					return false;
+
+				if (*m_Pos == ']') {
+					m_Pos++;
+					break;
+				}
+
+				if (*m_Pos != ',')
+					return false;
+
+				m_Pos++;
+				SkipWhitespace();
+			}
+		}
+
+		m_Depth--;
+		value = ArenaNew<Array>(std::move(items));
+		return true;
+	}
+
+	/* Returns whether any of the 8 bytes is a quote, a backslash or a control character. */
+	static bool HasSpecialByte(uint64_t word)
+	{
+		const uint64_t ones = 0x0101010101010101ULL;
+		const uint64_t highs = 0x8080808080808080ULL;
+
+		uint64_t quote = word ^ (ones * '"');
+		uint64_t backslash = word ^ (ones * '\\');
+
+		return (((quote - ones) & ~quote) | ((backslash - ones) & ~backslash) | ((word - ones * 0x20) & ~word)) & highs;
+	}
+
+	bool ParseString(String& str)
+	{
+		const char *start = ++m_Pos; /* '"' */
+
+		/* Skip over plain characters eight bytes at a time. */
+		while (m_End - m_Pos >= 8) {
+			uint64_t word;
+			memcpy(&word, m_Pos, sizeof(word));
+
+			if (HasSpecialByte(word))
+				break;
+
+			m_Pos += 8;
+		}
+
+		while (m_Pos < m_End) {
+			unsigned char ch = *m_Pos;
+
+			if (ch == '"') {
+				str = String(start, m_Pos);
+				m_Pos++;
+				return true;
+			}
+
+			if (ch == '\\')
+				return ParseEscapedString(start, str);
+
+			if (ch < 0x20)
+				return false;
+
+			m_Pos++;
+		}
+
+		return false;
+	}
+
+	bool ParseEscapedString(const char *start, String& str)
+	{
+		std::string result(start, m_Pos);
+
+		while (m_Pos < m_End) {
+			unsigned char ch = *m_Pos++;
+
+			if (ch == '"') {
+				str = std::move(result);
+				return true;
+			}
+
+			if (ch < 0x20)
+				return false;
+
+			if (ch != '\\') {
+				result += ch;
+				continue;
+			}
+
+			if (m_Pos == m_End)
+				return false;
+
+			switch (*m_Pos++) {
+				case '"':
+					result += '"';
+					break;
+				case '\\':
+					result += '\\';
+					break;
+				case '/':
+					result += '/';
+					break;
+				case 'b':
+					result += '\b';
+					break;
+				case 'f':
+					result += '\f';
+					break;
+				case 'n':
+					result += '\n';
+					break;
+				case 'r':
+					result += '\r';
+					break;
+				case 't':
+					result += '\t';
+					break;
+				case 'u':
+					{
+						if (m_End - m_Pos < 4)
+							return false;
+
+						unsigned int codepoint = 0;
+
+						for (int i = 0; i < 4; i++) {
+							char hex = *m_Pos++;
+
+							codepoint <<= 4;
+
+							if (hex >= '0' && hex <= '9')
+								codepoint |= hex - '0';
+							else if (hex >= 'a' && hex <= 'f')
+								codepoint |= hex - 'a' + 10;
+							else if (hex >= 'A' && hex <= 'F')
+								codepoint |= hex - 'A' + 10;
+							else
+								return false;
+						}
+
+						/* yajl has its own rules for surrogates. */
+						if (codepoint >= 0xD800 && codepoint <= 0xDFFF)
+							return false;
+
+						if (codepoint < 0x80) {
+							result += static_cast<char>(codepoint);
+						} else if (codepoint < 0x800) {
+							result += static_cast<char>(0xC0 | (codepoint >> 6));
+							result += static_cast<char>(0x80 | (codepoint & 0x3F));
+						} else {
+							result += static_cast<char>(0xE0 | (codepoint >> 12));
+							result += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+							result += static_cast<char>(0x80 | (codepoint & 0x3F));
+						}
+					}
+
+					break;
+				default:
+					return false;
+			}
+		}
+
+		return false;
+	}
+
+	bool ParseNumber(Value& value)
+	{
+		const char *start = m_Pos;
+		bool negative = false;
+
+		if (*m_Pos == '-') {
+			negative = true;
+			m_Pos++;
+		}
+
+		if (m_Pos == m_End || !isdigit(static_cast<unsigned char>(*m_Pos)))
+			return false;
+
+		unsigned long long integer = 0;
+		int digits = 0;
+
+		if (*m_Pos == '0') {
+			m_Pos++;
+			digits = 1;
+
+			/* yajl rejects leading zeros. */
+			if (m_Pos < m_End && isdigit(static_cast<unsigned char>(*m_Pos)))
+				return false;
+		} else {
+			while (m_Pos < m_End && isdigit(static_cast<unsigned char>(*m_Pos))) {
+				integer = integer * 10 + (*m_Pos - '0');
+				digits++;
+				m_Pos++;
+
+				if (digits > 15)
+					break;
+			}
+		}
+
+		bool simple = (digits <= 15);
+
+		while (m_Pos < m_End && isdigit(static_cast<unsigned char>(*m_Pos)))
+			m_Pos++;
+
+		if (m_Pos < m_End && *m_Pos == '.') {
+			m_Pos++;
+			simple = false;
+
+			if (m_Pos == m_End || !isdigit(static_cast<unsigned char>(*m_Pos)))
+				return false;
+
+			while (m_Pos < m_End && isdigit(static_cast<unsigned char>(*m_Pos)))
+				m_Pos++;
+		}
+
+		if (m_Pos < m_End && (*m_Pos == 'e' || *m_Pos == 'E')) {
+			m_Pos++;
+			simple = false;
+
+			if (m_Pos < m_End && (*m_Pos == '+' || *m_Pos == '-'))
+				m_Pos++;
+
+			if (m_Pos == m_End || !isdigit(static_cast<unsigned char>(*m_Pos)))
+				return false;
+
+			while (m_Pos < m_End && isdigit(static_cast<unsigned char>(*m_Pos)))
+				m_Pos++;
+		}
+
+		/* Integers with up to 15 digits are exactly representable as doubles. */
+		if (simple) {
+			double result = static_cast<double>(integer);
+			value = negative ? -result : result;
+			return true;
+		}
+
+		/* The input is NUL-terminated and the number was already validated,
+		 * so strtod() stops at m_Pos - unless the locale disagrees. */
+		char *end;
+		double result = strtod(start, &end);
+
+		if (end == m_Pos)
+			value = result;
+		else
+			value = Convert::ToDouble(String(start, m_Pos));
+
+		return true;
+	}
+};
+
 Value icinga::JsonDecode(const String& data)
 {
+	{
+		Value result;
+		JsonFastParser parser(data.CStr(), data.CStr() + data.GetLength());
+
+		if (parser.Parse(result))
+			return result;
+	}
+
 	static const yajl_callbacks callbacks = {
 		DecodeNull,
 		DecodeBoolean,
@@ -21,14 +21,21 @@
 #define JSON_H
 
 #include "base/i2-base.hpp"
+#include "base/object.hpp"
+#include <functional>
 
 namespace icinga
 {
 
 class String;
 class Value;
+class Stream;
+
+typedef std::function<void (const char *, size_t)> JsonWriter;
 
 String JsonEncode(const Value& value, bool pretty_print = false);
+void JsonEncode(const Value& value, const JsonWriter& writer, bool pretty_print = false);
+void JsonEncode(const Value& value, const intrusive_ptr<Stream>& stream, bool pretty_print = false);
 Value JsonDecode(const String& data);
 
 }
@@ -0,0 +1,154 @@
+/******************************************************************************
+ * Icinga 2                                                                   *
+ * Copyright (C) 2012-2018 Icinga Development Team (https://www.icinga.com/)  *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or              *
+ * modify it under the terms of the GNU General Public License                *
+ * as published by the Free Software Foundation; either version 2             *
+ * of the License, or (at your option) any later version.                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software Foundation     *
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
+ ******************************************************************************/
+
+
+#ifndef MPMCRING_H
+#define MPMCRING_H
+
+#include "base/i2-base.hpp"
+#include <atomic>
+#include <memory>
+#include <new>
+
+namespace icinga
+{
+
+/**
+ * A bounded lock-free FIFO queue which supports any number of producers
+ * and consumers. The capacity is rounded up to the next power of two.
+ *
+ * @ingroup base
+ */
+template<typename T>
+class MpmcRing
+{
+public:
+	MpmcRing(size_t capacity)
+	{
+		m_Capacity = 2;
+
+		while (m_Capacity < capacity)
+			m_Capacity *= 2;
+
+		m_Cells.reset(new Cell[m_Capacity]);
+
+		for (size_t i = 0; i < m_Capacity; i++)
+			m_Cells[i].Sequence.store(i, std::memory_order_relaxed);
+	}
+
+	MpmcRing(const MpmcRing&) = delete;
+	MpmcRing& operator=(const MpmcRing&) = delete;
+
+	~MpmcRing()
+	{
+		T item;
+
+		while (TryPop(item))
+			; /* empty loop */
+	}
+
+	/**
+	 * Adds an item to the queue.
+	 *
+	 * @param item The item. It is only moved from if the call succeeds.
+	 * @returns false if the queue is full, true otherwise.
+	 */
+	bool TryPush(T& item)
+	{
+		size_t pos = m_Tail.load(std::memory_order_relaxed);
+		Cell *cell;
+
+		for (;;) {
+			cell = &m_Cells[pos & (m_Capacity - 1)];
+			size_t seq = cell->Sequence.load(std::memory_order_acquire);
+			intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+			if (diff == 0) {
+				if (m_Tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			} else if (diff < 0)
+				return false;
+			else
+				pos = m_Tail.load(std::memory_order_relaxed);
+		}
+
+		new (&cell->Storage) T(std::move(item));
+		cell->Sequence.store(pos + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	/**
+	 * Removes the oldest item from the queue.
+	 *
+	 * @param[out] item The item.
+	 * @returns false if the queue is empty, true otherwise.
+	 */
+	bool TryPop(T& item)
+	{
+		size_t pos = m_Head.load(std::memory_order_relaxed);
+		Cell *cell;
+
+		for (;;) {
+			cell = &m_Cells[pos & (m_Capacity - 1)];
+			size_t seq = cell->Sequence.load(std::memory_order_acquire);
+			intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+
+			if (diff == 0) {
+				if (m_Head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			} else if (diff < 0)
+				return false;
+			else
+				pos = m_Head.load(std::memory_order_relaxed);
+		}
+
+		T *value = reinterpret_cast<T *>(&cell->Storage);
+		item = std::move(*value);
+		value->~T();
+		cell->Sequence.store(pos + m_Capacity, std::memory_order_release);
+
+		return true;
+	}
+
+	size_t GetCapacity() const
+	{
+		return m_Capacity;
+	}
+
+private:
+	struct Cell
+	{
+		std::atomic<size_t> Sequence;
+		typename std::aligned_storage<sizeof(T), alignof(T)>::type Storage;
+	};
+
+	size_t m_Capacity;
+	std::unique_ptr<Cell[]> m_Cells;
+
+	/* Keep producers and consumers on separate cache lines. */
+	char m_Padding1[64];
+	std::atomic<size_t> m_Head{0};
+	char m_Padding2[64];
+	std::atomic<size_t> m_Tail{0};
+};
+
+}
+
+#endif /* MPMCRING_H */
@@ -0,0 +1,117 @@
+/******************************************************************************
+ * Icinga 2                                                                   *
+ * Copyright (C) 2012-2018 Icinga Development Team (https://www.icinga.com/)  *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or              *
+ * modify it under the terms of the GNU General Public License                *
+ * as published by the Free Software Foundation; either version 2             *
+ * of the License, or (at your option) any later version.                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software Foundation     *
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
+ ******************************************************************************/
+
+#ifndef MPSCQUEUE_H
+#define MPSCQUEUE_H
+
+#include "base/i2-base.hpp"
+#include <atomic>
+#include <vector>
+
+namespace icinga
+{
+
+/**
+ * A lock-free queue which supports any number of producers and a single
+ * consumer. The consumer always takes all queued items at once.
+ *
+ * @ingroup base
+ */
+template<typename T>
+class MpscQueue
+{
+public:
+	MpscQueue() = default;
+	MpscQueue(const MpscQueue&) = delete;
+	MpscQueue& operator=(const MpscQueue&) = delete;
+
+	~MpscQueue()
+	{
+		Node *node = m_Head.load();
+
+		while (node) {
+			Node *next = node->Next;
+			delete node;
+			node = next;
+		}
+	}
+
+	/**
+	 * Adds an item to the queue.
+	 *
+	 * @param item The item.
+	 * @returns true if the queue was empty before, false otherwise.
+	 */
+	bool Push(T item)
+	{
+		auto *node = new Node{std::move(item), m_Head.load(std::memory_order_relaxed)};
+
+		while (!m_Head.compare_exchange_weak(node->Next, node, std::memory_order_release, std::memory_order_relaxed))
+			; /* empty loop */
+
+		return node->Next == nullptr;
+	}
+
+	/**
+	 * Removes all items from the queue and appends them to the specified
+	 * vector in the order in which they were added. Must only be called
+	 * by the consumer.
+	 *
+	 * @param items The vector.
+	 */
+	void PopAll(std::vector<T>& items)
+	{
+		Node *node = m_Head.exchange(nullptr, std::memory_order_acquire);
+
+		/* The list is in LIFO order. */
+		Node *prev = nullptr;
+
+		while (node) {
+			Node *next = node->Next;
+			node->Next = prev;
+			prev = node;
+			node = next;
+		}
+
+		while (prev) {
+			Node *next = prev->Next;
+			items.emplace_back(std::move(prev->Item));
+			delete prev;
+			prev = next;
+		}
+	}
+
+	bool IsEmpty() const
+	{
+		return m_Head.load(std::memory_order_acquire) == nullptr;
+	}
+
+private:
+	struct Node
+	{
+		T Item;
+		Node *Next;
+	};
+
+	std::atomic<Node *> m_Head{nullptr};
+};
+
+}
+
+#endif /* MPSCQUEUE_H */
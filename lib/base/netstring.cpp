@@ -111,12 +111,41 @@ StreamReadStatus NetString::ReadStringFromStream(const Stream::Ptr& stream, Stri
  */
 size_t NetString::WriteStringToStream(const Stream::Ptr& stream, const String& str)
 {
-	std::ostringstream msgbuf;
-	WriteStringToStream(msgbuf, str);
+	std::string msg = std::to_string(str.GetLength());
+	msg.reserve(msg.size() + str.GetLength() + 2);
+	msg += ':';
+	msg.append(str.GetData());
+	msg += ',';
+
+	stream->Write(msg.c_str(), msg.size());
+	return msg.size();
+}
+
+/**
+ * Writes data into a stream using the netstring format and returns bytes written.
+ * Unlike the other overload this doesn't copy the String into a temporary
+ * buffer. The stream may take over the String's buffer instead.
+ *
+ * @param stream The stream.
+ * @param str The String that is to be written.
+ *
+ * @return The amount of bytes written.
+ */
+size_t NetString::WriteStringToStream(const Stream::Ptr& stream, String&& str)
+{
+	size_t length = str.GetLength();
+
+	String buffers[] = {
+		std::to_string(length) + ":",
+		std::move(str),
+		","
+	};
+
+	size_t count = buffers[0].GetLength() + length + 1;
+
+	stream->WriteBuffers(buffers, sizeof(buffers) / sizeof(buffers[0]));
 
-	String msg = msgbuf.str();
-	stream->Write(msg.CStr(), msg.GetLength());
-	return msg.GetLength();
+	return count;
 }
 
 /**
@@ -40,6 +40,7 @@ class NetString
 public:
 	static StreamReadStatus ReadStringFromStream(const Stream::Ptr& stream, String *message, StreamReadContext& context, bool may_wait = false);
 	static size_t WriteStringToStream(const Stream::Ptr& stream, const String& message);
+	static size_t WriteStringToStream(const Stream::Ptr& stream, String&& message);
 	static void WriteStringToStream(std::ostream& stream, const String& message);
 
 private:
@@ -27,9 +27,10 @@
 #include "base/logger.hpp"
 #include "base/utility.hpp"
 #include "base/scriptglobal.hpp"
-#include "base/json.hpp"
 #include <boost/algorithm/string/join.hpp>
 #include <boost/thread/once.hpp>
+#include <atomic>
+#include <memory>
 #include <thread>
 #include <iostream>
 
@@ -49,6 +50,7 @@ extern char **environ;
 using namespace icinga;
 
 #define IOTHREADS 4
+#define SPAWNHELPERS 4
 
 static boost::mutex l_ProcessMutex[IOTHREADS];
 static std::map<Process::ProcessHandle, Process::Ptr> l_Processes[IOTHREADS];
@@ -58,17 +60,98 @@ static HANDLE l_Events[IOTHREADS];
 static int l_EventFDs[IOTHREADS][2];
 static std::map<Process::ConsoleHandle, Process::ProcessHandle> l_FDs[IOTHREADS];
 
-static boost::mutex l_ProcessControlMutex;
+/**
+ * A forked helper process which spawns plugins on behalf of the main process.
+ * Each helper serves one request at a time; multiple helpers allow spawns
+ * to be processed in parallel.
+ */
+struct SpawnHelper
+{
+	boost::mutex Mutex;
+	int FD{-1};
+	pid_t PID{-1};
+};
+
+/**
+ * Commands understood by the spawn helper.
+ */
+enum SpawnHelperCommand
+{
+	SpawnHelperSpawn,
+	SpawnHelperWaitPID,
+	SpawnHelperKill
+};
+
+/**
+ * Fixed-size header of a spawn helper request. 'spawn' requests are followed
+ * by ArgumentCount + EnvironmentCount NUL-terminated strings. The environment
+ * strings are only the variables which should be added to the helper's own
+ * environment.
+ */
+struct SpawnHelperRequest
+{
+	int Command;
+	pid_t PID;
+	int Signum;
+	int AdjustPriority;
+	unsigned int ArgumentCount;
+	unsigned int EnvironmentCount;
+};
+
+/**
+ * Response for a spawn helper request.
+ */
+struct SpawnHelperResponse
+{
+	pid_t RC;
+	int Errno;
+	int Status;
+};
+
+static std::unique_ptr<SpawnHelper[]> l_SpawnHelpers;
+static int l_SpawnHelperCount = 0;
+static std::atomic<unsigned int> l_NextSpawnHelper(0);
+
+/* Only valid inside of a spawn helper process. */
 static int l_ProcessControlFD = -1;
-static pid_t l_ProcessControlPID;
 #endif /* _WIN32 */
 static boost::once_flag l_ProcessOnceFlag = BOOST_ONCE_INIT;
 static boost::once_flag l_SpawnHelperOnceFlag = BOOST_ONCE_INIT;
 
+/* Upper bounds (in milliseconds) of the spawn latency histogram buckets. */
+static const double l_SpawnLatencyBuckets[] = { 1, 5, 10, 50, 100, 500 };
+#define SPAWNLATENCYBUCKETS (sizeof(l_SpawnLatencyBuckets) / sizeof(l_SpawnLatencyBuckets[0]))
+
+static std::atomic<unsigned long> l_SpawnLatencyHistogram[SPAWNLATENCYBUCKETS + 1];
+static std::atomic<unsigned long> l_SpawnCount(0);
+static std::atomic<unsigned long> l_SpawnLatencySum(0); /* microseconds */
+static std::atomic<unsigned long> l_SpawnLatencyMax(0); /* microseconds */
+
+static void UpdateSpawnLatencyStatistics(double latency)
+{
+	unsigned long usec = latency * 1000 * 1000;
+
+	size_t bucket;
+	for (bucket = 0; bucket < SPAWNLATENCYBUCKETS; bucket++) {
+		if (latency * 1000 < l_SpawnLatencyBuckets[bucket])
+			break;
+	}
+
+	l_SpawnLatencyHistogram[bucket]++;
+	l_SpawnCount++;
+	l_SpawnLatencySum += usec;
+
+	unsigned long max = l_SpawnLatencyMax;
+	while (usec > max && !l_SpawnLatencyMax.compare_exchange_weak(max, usec))
+		;
+}
+
 Process::Process(Process::Arguments arguments, Dictionary::Ptr extraEnvironment)
 	: m_Arguments(std::move(arguments)), m_ExtraEnvironment(std::move(extraEnvironment)), m_Timeout(600), m_AdjustPriority(false)
 #ifdef _WIN32
 	, m_ReadPending(false), m_ReadFailed(false), m_Overlapped()
+#else /* _WIN32 */
+	, m_SpawnHelper(0)
 #endif /* _WIN32 */
 {
 #ifdef _WIN32
@@ -84,60 +167,85 @@ Process::~Process()
 }
 
 #ifndef _WIN32
-static Value ProcessSpawnImpl(struct msghdr *msgh, const Dictionary::Ptr& request)
+static void ProcessSpawnImpl(struct msghdr *msgh, const SpawnHelperRequest& request, char *strings, size_t length, SpawnHelperResponse& response)
 {
+	/* The helper's environment never changes, so we only need to build the
+	 * base part of envp once. */
+	static std::vector<char *> baseEnvironment;
+	static bool baseEnvironmentInitialized = false;
+	static std::vector<char *> argv, envp;
+	static char lcNumeric[] = "LC_NUMERIC=C";
+
+	response.RC = -1;
+
 	struct cmsghdr *cmsg = CMSG_FIRSTHDR(msgh);
 
 	if (cmsg == nullptr || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_len != CMSG_LEN(sizeof(int) * 3)) {
 		std::cerr << "Invalid 'spawn' request: FDs missing" << std::endl;
-		return Empty;
+		response.Errno = EINVAL;
+		return;
 	}
 
 	auto *fds = (int *)CMSG_DATA(cmsg);
 
-	Array::Ptr arguments = request->Get("arguments");
-	Dictionary::Ptr extraEnvironment = request->Get("extraEnvironment");
-	bool adjustPriority = request->Get("adjustPriority");
-
-	// build argv
-	auto **argv = new char *[arguments->GetLength() + 1];
+	if (!baseEnvironmentInitialized) {
+		for (int i = 0; environ[i]; i++)
+			baseEnvironment.push_back(environ[i]);
 
-	for (unsigned int i = 0; i < arguments->GetLength(); i++) {
-		String arg = arguments->Get(i);
-		argv[i] = strdup(arg.CStr());
+		baseEnvironmentInitialized = true;
 	}
 
-	argv[arguments->GetLength()] = nullptr;
+	argv.clear();
+	envp = baseEnvironment;
 
-	// build envp
-	int envc = 0;
+	/* argv and envp point directly into the request buffer */
+	char *end = strings + length;
+	bool valid = true;
 
-	/* count existing environment variables */
-	while (environ[envc])
-		envc++;
+	for (unsigned int i = 0; i < request.ArgumentCount + request.EnvironmentCount; i++) {
+		char *str = strings;
 
-	auto **envp = new char *[envc + (extraEnvironment ? extraEnvironment->GetLength() : 0) + 2];
+		while (strings < end && *strings != '\0')
+			strings++;
 
-	for (int i = 0; i < envc; i++)
-		envp[i] = strdup(environ[i]);
+		if (strings == end) {
+			valid = false;
+			break;
+		}
 
-	if (extraEnvironment) {
-		ObjectLock olock(extraEnvironment);
+		strings++;
 
-		int index = envc;
-		for (const Dictionary::Pair& kv : extraEnvironment) {
-			String skv = kv.first + "=" + Convert::ToString(kv.second);
-			envp[index] = strdup(skv.CStr());
-			index++;
-		}
+		if (i < request.ArgumentCount)
+			argv.push_back(str);
+		else
+			envp.push_back(str);
+	}
+
+	if (!valid || argv.empty()) {
+		std::cerr << "Invalid 'spawn' request: Malformed argument list" << std::endl;
+
+		(void)close(fds[0]);
+		(void)close(fds[1]);
+		(void)close(fds[2]);
+
+		response.Errno = EINVAL;
+		return;
 	}
 
-	envp[envc + (extraEnvironment ? extraEnvironment->GetLength() : 0)] = strdup("LC_NUMERIC=C");
-	envp[envc + (extraEnvironment ? extraEnvironment->GetLength() : 0) + 1] = nullptr;
+	argv.push_back(nullptr);
+
+	envp.push_back(lcNumeric);
+	envp.push_back(nullptr);
 
-	extraEnvironment.reset();
+	bool adjustPriority = request.AdjustPriority;
 
+#ifdef HAVE_VFORK
+	/* The helper is single-threaded and blocks until the child has called
+	 * execvpe() anyway, so we can avoid copying the page tables. */
+	pid_t pid = vfork();
+#else /* HAVE_VFORK */
 	pid_t pid = fork();
+#endif /* HAVE_VFORK */
 
 	int errorCode = 0;
 
@@ -172,7 +280,7 @@ static Value ProcessSpawnImpl(struct msghdr *msgh, const Dictionary::Ptr& reques
 		sigemptyset(&mask);
 		sigprocmask(SIG_SETMASK, &mask, nullptr);
 
-		if (icinga2_execvpe(argv[0], argv, envp) < 0) {
+		if (icinga2_execvpe(argv[0], argv.data(), envp.data()) < 0) {
 			char errmsg[512];
 			strcpy(errmsg, "execvpe(");
 			strncat(errmsg, argv[0], sizeof(errmsg) - strlen(errmsg) - 1);
@@ -189,55 +297,21 @@ static Value ProcessSpawnImpl(struct msghdr *msgh, const Dictionary::Ptr& reques
 	(void)close(fds[1]);
 	(void)close(fds[2]);
 
-	// free arguments
-	for (int i = 0; argv[i]; i++)
-		free(argv[i]);
-
-	delete[] argv;
-
-	// free environment
-	for (int i = 0; envp[i]; i++)
-		free(envp[i]);
-
-	delete[] envp;
-
-	Dictionary::Ptr response = new Dictionary({
-		{ "rc", pid },
-		{ "errno", errorCode }
-	});
-
-	return response;
+	response.RC = pid;
+	response.Errno = errorCode;
 }
 
-static Value ProcessKillImpl(struct msghdr *msgh, const Dictionary::Ptr& request)
+static void ProcessKillImpl(const SpawnHelperRequest& request, SpawnHelperResponse& response)
 {
-	pid_t pid = request->Get("pid");
-	int signum = request->Get("signum");
-
 	errno = 0;
-	kill(pid, signum);
-	int error = errno;
-
-	Dictionary::Ptr response = new Dictionary({
-		{ "errno", error }
-	});
-
-	return response;
+	response.RC = kill(request.PID, request.Signum);
+	response.Errno = errno;
 }
 
-static Value ProcessWaitPIDImpl(struct msghdr *msgh, const Dictionary::Ptr& request)
+static void ProcessWaitPIDImpl(const SpawnHelperRequest& request, SpawnHelperResponse& response)
 {
-	pid_t pid = request->Get("pid");
-
-	int status;
-	int rc = waitpid(pid, &status, 0);
-
-	Dictionary::Ptr response = new Dictionary({
-		{ "status", status },
-		{ "rc", rc }
-	});
-
-	return response;
+	response.RC = waitpid(request.PID, &response.Status, 0);
+	response.Errno = errno;
 }
 
 static void ProcessHandler()
@@ -258,6 +332,8 @@ static void ProcessHandler()
 				(void)close(i);
 	}
 
+	std::vector<char> mbuf;
+
 	for (;;) {
 		size_t length;
 
@@ -284,49 +360,48 @@ static void ProcessHandler()
 			break;
 		}
 
-		auto *mbuf = new char[length];
+		mbuf.resize(length);
 
 		size_t count = 0;
 		while (count < length) {
-			rc = recv(l_ProcessControlFD, mbuf + count, length - count, 0);
+			rc = recv(l_ProcessControlFD, &mbuf[count], length - count, 0);
 
 			if (rc <= 0) {
 				if (rc < 0 && (errno == EINTR || errno == EAGAIN))
 					continue;
 
-				delete [] mbuf;
-
 				_exit(0);
 			}
 
 			count += rc;
-
-			if (rc == 0)
-				break;
 		}
 
-		String jrequest = String(mbuf, mbuf + count);
-
-		delete [] mbuf;
-
-		Dictionary::Ptr request = JsonDecode(jrequest);
+		SpawnHelperResponse response = {};
 
-		String command = request->Get("command");
-
-		Value response;
-
-		if (command == "spawn")
-			response = ProcessSpawnImpl(&msg, request);
-		else if (command == "waitpid")
-			response = ProcessWaitPIDImpl(&msg, request);
-		else if (command == "kill")
-			response = ProcessKillImpl(&msg, request);
-		else
-			response = Empty;
-
-		String jresponse = JsonEncode(response);
+		if (length < sizeof(SpawnHelperRequest)) {
+			response.RC = -1;
+			response.Errno = EINVAL;
+		} else {
+			SpawnHelperRequest request;
+			memcpy(&request, mbuf.data(), sizeof(request));
+
+			switch (request.Command) {
+				case SpawnHelperSpawn:
+					ProcessSpawnImpl(&msg, request, mbuf.data() + sizeof(request), length - sizeof(request), response);
+					break;
+				case SpawnHelperWaitPID:
+					ProcessWaitPIDImpl(request, response);
+					break;
+				case SpawnHelperKill:
+					ProcessKillImpl(request, response);
+					break;
+				default:
+					response.RC = -1;
+					response.Errno = EINVAL;
+			}
+		}
 
-		if (send(l_ProcessControlFD, jresponse.CStr(), jresponse.GetLength(), 0) < 0) {
+		if (send(l_ProcessControlFD, &response, sizeof(response), 0) < 0) {
 			BOOST_THROW_EXCEPTION(posix_error()
 				<< boost::errinfo_api_function("send")
 				<< boost::errinfo_errno(errno));
@@ -336,13 +411,13 @@ static void ProcessHandler()
 	_exit(0);
 }
 
-static void StartSpawnProcessHelper()
+static void StartSpawnProcessHelper(SpawnHelper& helper)
 {
-	if (l_ProcessControlFD != -1) {
-		(void)close(l_ProcessControlFD);
+	if (helper.FD != -1) {
+		(void)close(helper.FD);
 
 		int status;
-		(void)waitpid(l_ProcessControlPID, &status, 0);
+		(void)waitpid(helper.PID, &status, 0);
 	}
 
 	int controlFDs[2];
@@ -372,141 +447,203 @@ static void StartSpawnProcessHelper()
 
 	(void)close(controlFDs[0]);
 
-	l_ProcessControlFD = controlFDs[1];
-	l_ProcessControlPID = pid;
+	Utility::SetCloExec(controlFDs[1]);
+
+	helper.FD = controlFDs[1];
+	helper.PID = pid;
 }
 
-static pid_t ProcessSpawn(const std::vector<String>& arguments, const Dictionary::Ptr& extraEnvironment, bool adjustPriority, int fds[3])
+/**
+ * Picks a spawn helper for a new process and locks it. Helpers are
+ * assigned round-robin; if the selected helper is busy we try the
+ * other ones before blocking.
+ */
+static int AcquireSpawnHelper(boost::mutex::scoped_lock& lock)
 {
-	Dictionary::Ptr request = new Dictionary({
-		{ "command", "spawn" },
-		{ "arguments", Array::FromVector(arguments) },
-		{ "extraEnvironment", extraEnvironment },
-		{ "adjustPriority", adjustPriority }
-	});
+	unsigned int start = l_NextSpawnHelper++;
+
+	for (int i = 0; i < l_SpawnHelperCount; i++) {
+		int index = (start + i) % l_SpawnHelperCount;
 
-	String jrequest = JsonEncode(request);
-	size_t length = jrequest.GetLength();
+		boost::mutex::scoped_lock tlock(l_SpawnHelpers[index].Mutex, boost::try_to_lock);
+
+		if (tlock.owns_lock()) {
+			lock.swap(tlock);
+			return index;
+		}
+	}
+
+	int index = start % l_SpawnHelperCount;
+
+	boost::mutex::scoped_lock tlock(l_SpawnHelpers[index].Mutex);
+	lock.swap(tlock);
+
+	return index;
+}
 
-	boost::mutex::scoped_lock lock(l_ProcessControlMutex);
+/**
+ * Sends a request to a spawn helper and waits for its response. The caller
+ * must hold the helper's mutex.
+ */
+static bool SpawnHelperRoundTrip(SpawnHelper& helper, const std::vector<char>& request, const int *fds, SpawnHelperResponse& response)
+{
+	size_t length = request.size();
 
 	struct msghdr msg;
 	memset(&msg, 0, sizeof(msg));
 
-	struct iovec io;
-	io.iov_base = &length;
-	io.iov_len = sizeof(length);
+	struct iovec io[2];
+	io[0].iov_base = &length;
+	io[0].iov_len = sizeof(length);
+	io[1].iov_base = const_cast<char *>(request.data());
+	io[1].iov_len = length;
 
-	msg.msg_iov = &io;
-	msg.msg_iovlen = 1;
+	msg.msg_iov = io;
+	msg.msg_iovlen = 2;
 
 	char cbuf[CMSG_SPACE(sizeof(int) * 3)];
-	msg.msg_control = cbuf;
-	msg.msg_controllen = sizeof(cbuf);
 
-	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
-	cmsg->cmsg_level = SOL_SOCKET;
-	cmsg->cmsg_type = SCM_RIGHTS;
-	cmsg->cmsg_len = CMSG_LEN(sizeof(int) * 3);
+	if (fds) {
+		msg.msg_control = cbuf;
+		msg.msg_controllen = sizeof(cbuf);
 
-	memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * 3);
+		struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int) * 3);
 
-	msg.msg_controllen = cmsg->cmsg_len;
+		memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * 3);
 
-send_message:
-	while (sendmsg(l_ProcessControlFD, &msg, 0) < 0)
-		StartSpawnProcessHelper();
+		msg.msg_controllen = cmsg->cmsg_len;
+	}
 
-	if (send(l_ProcessControlFD, jrequest.CStr(), jrequest.GetLength(), 0) < 0)
-		goto send_message;
+	while (sendmsg(helper.FD, &msg, 0) < 0)
+		StartSpawnProcessHelper(helper);
 
-	char buf[4096];
+	size_t count = 0;
+	while (count < sizeof(response)) {
+		ssize_t rc = recv(helper.FD, reinterpret_cast<char *>(&response) + count, sizeof(response) - count, 0);
 
-	ssize_t rc = recv(l_ProcessControlFD, buf, sizeof(buf), 0);
+		if (rc <= 0) {
+			if (rc < 0 && errno == EINTR)
+				continue;
 
-	if (rc <= 0)
-		return -1;
+			return false;
+		}
 
-	String jresponse = String(buf, buf + rc);
+		count += rc;
+	}
 
-	Dictionary::Ptr response = JsonDecode(jresponse);
+	return true;
+}
 
-	if (response->Get("rc") == -1)
-		errno = response->Get("errno");
+static void AppendSpawnHelperString(std::vector<char>& request, const String& str)
+{
+	/* The strings are NUL-terminated: Anything after an embedded NUL would
+	 * end up in the next argument or environment variable. */
+	const char *data = str.CStr();
 
-	return response->Get("rc");
+	request.insert(request.end(), data, data + strlen(data));
+	request.push_back('\0');
 }
 
-static int ProcessKill(pid_t pid, int signum)
+static pid_t ProcessSpawn(const std::vector<String>& arguments, const Dictionary::Ptr& extraEnvironment, bool adjustPriority, int fds[3], int *helperIndex)
 {
-	Dictionary::Ptr request = new Dictionary({
-		{ "command", "kill" },
-		{ "pid", pid },
-		{ "signum", signum }
-	});
+	SpawnHelperRequest header = {};
+	header.Command = SpawnHelperSpawn;
+	header.AdjustPriority = adjustPriority;
+	header.ArgumentCount = arguments.size();
 
-	String jrequest = JsonEncode(request);
-	size_t length = jrequest.GetLength();
+	std::vector<char> request(sizeof(header));
 
-	boost::mutex::scoped_lock lock(l_ProcessControlMutex);
+	for (const String& argument : arguments)
+		AppendSpawnHelperString(request, argument);
 
-send_message:
-	while (send(l_ProcessControlFD, &length, sizeof(length), 0) < 0)
-		StartSpawnProcessHelper();
+	if (extraEnvironment) {
+		ObjectLock olock(extraEnvironment);
 
-	if (send(l_ProcessControlFD, jrequest.CStr(), jrequest.GetLength(), 0) < 0)
-		goto send_message;
+		for (const Dictionary::Pair& kv : extraEnvironment) {
+			AppendSpawnHelperString(request, kv.first + "=" + Convert::ToString(kv.second));
+			header.EnvironmentCount++;
+		}
+	}
 
-	char buf[4096];
+	memcpy(request.data(), &header, sizeof(header));
 
-	ssize_t rc = recv(l_ProcessControlFD, buf, sizeof(buf), 0);
+	boost::mutex::scoped_lock lock;
+	*helperIndex = AcquireSpawnHelper(lock);
 
-	if (rc <= 0)
+	SpawnHelperResponse response;
+
+	if (!SpawnHelperRoundTrip(l_SpawnHelpers[*helperIndex], request, fds, response))
 		return -1;
 
-	String jresponse = String(buf, buf + rc);
+	if (response.RC == -1)
+		errno = response.Errno;
 
-	Dictionary::Ptr response = JsonDecode(jresponse);
-	return response->Get("errno");
+	return response.RC;
 }
 
-static int ProcessWaitPID(pid_t pid, int *status)
+static int ProcessKill(int helperIndex, pid_t pid, int signum)
 {
-	Dictionary::Ptr request = new Dictionary({
-		{ "command", "waitpid" },
-		{ "pid", pid }
-	});
+	SpawnHelperRequest header = {};
+	header.Command = SpawnHelperKill;
+	header.PID = pid;
+	header.Signum = signum;
 
-	String jrequest = JsonEncode(request);
-	size_t length = jrequest.GetLength();
+	std::vector<char> request(sizeof(header));
+	memcpy(request.data(), &header, sizeof(header));
 
-	boost::mutex::scoped_lock lock(l_ProcessControlMutex);
+	SpawnHelper& helper = l_SpawnHelpers[helperIndex];
+	boost::mutex::scoped_lock lock(helper.Mutex);
 
-send_message:
-	while (send(l_ProcessControlFD, &length, sizeof(length), 0) < 0)
-		StartSpawnProcessHelper();
+	SpawnHelperResponse response;
 
-	if (send(l_ProcessControlFD, jrequest.CStr(), jrequest.GetLength(), 0) < 0)
-		goto send_message;
+	if (!SpawnHelperRoundTrip(helper, request, nullptr, response))
+		return -1;
 
-	char buf[4096];
+	return response.Errno;
+}
 
-	ssize_t rc = recv(l_ProcessControlFD, buf, sizeof(buf), 0);
+static int ProcessWaitPID(int helperIndex, pid_t pid, int *status)
+{
+	SpawnHelperRequest header = {};
+	header.Command = SpawnHelperWaitPID;
+	header.PID = pid;
 
-	if (rc <= 0)
-		return -1;
+	std::vector<char> request(sizeof(header));
+	memcpy(request.data(), &header, sizeof(header));
 
-	String jresponse = String(buf, buf + rc);
+	/* Only the helper which forked the process can reap it. */
+	SpawnHelper& helper = l_SpawnHelpers[helperIndex];
+	boost::mutex::scoped_lock lock(helper.Mutex);
 
-	Dictionary::Ptr response = JsonDecode(jresponse);
-	*status = response->Get("status");
-	return response->Get("rc");
+	SpawnHelperResponse response;
+
+	if (!SpawnHelperRoundTrip(helper, request, nullptr, response))
+		return -1;
+
+	*status = response.Status;
+	return response.RC;
 }
 
 void Process::InitializeSpawnHelper()
 {
-	if (l_ProcessControlFD == -1)
-		StartSpawnProcessHelper();
+	if (l_SpawnHelpers)
+		return;
+
+	int count = ScriptGlobal::Get("SpawnHelpers", &Empty);
+
+	if (count <= 0)
+		count = SPAWNHELPERS;
+
+	l_SpawnHelpers.reset(new SpawnHelper[count]);
+	l_SpawnHelperCount = count;
+
+	for (int i = 0; i < count; i++)
+		StartSpawnProcessHelper(l_SpawnHelpers[i]);
+
+	ScriptGlobal::Set("SpawnHelpers", count);
 }
 #endif /* _WIN32 */
 
@@ -941,6 +1078,8 @@ void Process::Run(const std::function<void(const ProcessResult&)>& callback)
 		return;
 	}
 
+	UpdateSpawnLatencyStatistics(Utility::GetTime() - m_Result.ExecutionStart);
+
 	delete [] args;
 	free(envp);
 /*	DeleteProcThreadAttributeList(lpAttributeList);
@@ -986,13 +1125,14 @@ void Process::Run(const std::function<void(const ProcessResult&)>& callback)
 	fds[1] = outfds[1];
 	fds[2] = outfds[1];
 
-	m_Process = ProcessSpawn(m_Arguments, m_ExtraEnvironment, m_AdjustPriority, fds);
+	m_Process = ProcessSpawn(m_Arguments, m_ExtraEnvironment, m_AdjustPriority, fds, &m_SpawnHelper);
 	m_PID = m_Process;
 
 	if (m_PID == -1) {
 		m_OutputStream << "Fork failed with error code " << errno << " (" << Utility::FormatErrorNumber(errno) << ")";
 		Log(LogCritical, "Process", m_OutputStream.str());
-	}
+	} else
+		UpdateSpawnLatencyStatistics(Utility::GetTime() - m_Result.ExecutionStart);
 
 	Log(LogNotice, "Process")
 		<< "Running command " << PrettyPrintArguments(m_Arguments) << ": PID " << m_PID;
@@ -1043,7 +1183,7 @@ bool Process::DoEvents()
 #ifdef _WIN32
 			TerminateProcess(m_Process, 1);
 #else /* _WIN32 */
-			int error = ProcessKill(-m_Process, SIGKILL);
+			int error = ProcessKill(m_SpawnHelper, -m_Process, SIGKILL);
 			if (error) {
 				Log(LogWarning, "Process")
 					<< "Couldn't kill the process group " << m_PID << " (" << PrettyPrintArguments(m_Arguments)
@@ -1097,7 +1237,7 @@ bool Process::DoEvents()
 	int status, exitcode;
 	if (could_not_kill || m_PID == -1) {
 		exitcode = 128;
-	} else if (ProcessWaitPID(m_Process, &status) != m_Process) {
+	} else if (ProcessWaitPID(m_SpawnHelper, m_Process, &status) != m_Process) {
 		exitcode = 128;
 
 		Log(LogWarning, "Process")
@@ -1147,6 +1287,28 @@ pid_t Process::GetPID() const
 	return m_PID;
 }
 
+Dictionary::Ptr Process::GetSpawnStatistics()
+{
+	unsigned long count = l_SpawnCount;
+
+	Dictionary::Ptr histogram = new Dictionary();
+
+	for (size_t i = 0; i < SPAWNLATENCYBUCKETS; i++)
+		histogram->Set("le_" + Convert::ToString(l_SpawnLatencyBuckets[i]) + "ms", l_SpawnLatencyHistogram[i].load());
+
+	histogram->Set("inf", l_SpawnLatencyHistogram[SPAWNLATENCYBUCKETS].load());
+
+	return new Dictionary({
+#ifndef _WIN32
+		{ "helpers", l_SpawnHelperCount },
+#endif /* _WIN32 */
+		{ "count", count },
+		{ "avg_latency", count > 0 ? l_SpawnLatencySum / 1000.0 / 1000.0 / count : 0 },
+		{ "max_latency", l_SpawnLatencyMax / 1000.0 / 1000.0 },
+		{ "latency_histogram", histogram }
+	});
+}
+
 
 int Process::GetTID() const
 {
@@ -85,6 +85,8 @@ public:
 
 	static String PrettyPrintArguments(const Arguments& arguments);
 
+	static Dictionary::Ptr GetSpawnStatistics();
+
 #ifndef _WIN32
 	static void InitializeSpawnHelper();
 #endif /* _WIN32 */
@@ -105,6 +107,8 @@ private:
 	bool m_ReadFailed;
 	OVERLAPPED m_Overlapped;
 	char m_ReadBuffer[1024];
+#else /* _WIN32 */
+	int m_SpawnHelper;
 #endif /* _WIN32 */
 
 	std::ostringstream m_OutputStream;
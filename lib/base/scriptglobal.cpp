@@ -111,7 +111,7 @@ void ScriptGlobal::WriteToFile(const String& filename)
 			value = Convert::ToString(value);
 
 		Dictionary::Ptr persistentVariable = new Dictionary({
-			{ "name", kv.first },
+			{ "name", kv.first.GetString() },
 			{ "value", value }
 		});
 
@@ -389,7 +389,7 @@ Array::Ptr ScriptUtils::Keys(const Dictionary::Ptr& dict)
 	if (dict) {
 		ObjectLock olock(dict);
 		for (const Dictionary::Pair& kv : dict) {
-			result.push_back(kv.first);
+			result.push_back(kv.first.GetString());
 		}
 	}
 
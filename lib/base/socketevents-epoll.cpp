@@ -27,19 +27,23 @@
 
 using namespace icinga;
 
+/* Distinguishes registrations which reuse a file descriptor. */
+static std::atomic<uint32_t> l_NextGeneration(1);
+
 void SocketEventEngineEpoll::InitializeThread(int tid)
 {
+	if (!m_PollFDs)
+		m_PollFDs.reset(new SOCKET[m_ThreadCount]);
+
 	m_PollFDs[tid] = epoll_create(128);
 	Utility::SetCloExec(m_PollFDs[tid]);
 
-	SocketEventDescriptor sed;
-
-	m_Sockets[tid][m_EventFDs[tid][0]] = sed;
 	m_FDChanged[tid] = true;
 
+	/* The event FD is level-triggered and doesn't have a descriptor. */
 	epoll_event event;
 	memset(&event, 0, sizeof(event));
-	event.data.fd = m_EventFDs[tid][0];
+	event.data.u64 = MakeEventData(m_EventFDs[tid][0], 0);
 	event.events = EPOLLIN;
 	epoll_ctl(m_PollFDs[tid], EPOLL_CTL_ADD, m_EventFDs[tid][0], &event);
 }
@@ -54,7 +58,7 @@ int SocketEventEngineEpoll::PollToEpoll(int events)
 	if (events & POLLOUT)
 		result |= EPOLLOUT;
 
-	return events;
+	return result;
 }
 
 int SocketEventEngineEpoll::EpollToPoll(int events)
@@ -67,13 +71,49 @@ int SocketEventEngineEpoll::EpollToPoll(int events)
 	if (events & EPOLLOUT)
 		result |= POLLOUT;
 
-	return events;
+	if (events & EPOLLERR)
+		result |= POLLERR;
+
+	if (events & EPOLLHUP)
+		result |= POLLHUP;
+
+	return result;
+}
+
+/**
+ * Returns the data epoll reports along with a socket's events. Events are
+ * matched to their descriptor by the socket and the registration's
+ * generation, which makes events for sockets that were unregistered in the
+ * meantime easy to detect.
+ */
+uint64_t SocketEventEngineEpoll::MakeEventData(SOCKET fd, uint32_t generation)
+{
+	return static_cast<uint64_t>(generation) << 32 | static_cast<uint32_t>(fd);
+}
+
+/**
+ * Updates the events the kernel reports for a socket. This also re-arms the
+ * socket, i.e. epoll reports the events again if they're still pending.
+ * The caller must hold the thread's mutex.
+ */
+void SocketEventEngineEpoll::ArmEvents(int tid, SOCKET fd, SocketEventDescriptor& desc, int events)
+{
+	desc.ArmedEvents = events;
+
+	epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.data.u64 = MakeEventData(fd, desc.Generation);
+	event.events = SocketEventEngineEpoll::PollToEpoll(events) | EPOLLET;
+	epoll_ctl(m_PollFDs[tid], EPOLL_CTL_MOD, fd, &event);
 }
 
 void SocketEventEngineEpoll::ThreadProc(int tid)
 {
 	Utility::SetThreadName("SocketIO");
 
+	epoll_event pevents[128];
+	std::vector<EventDescription> events;
+
 	for (;;) {
 		{
 			boost::mutex::scoped_lock lock(m_EventMutex[tid]);
@@ -84,35 +124,56 @@ void SocketEventEngineEpoll::ThreadProc(int tid)
 			}
 		}
 
-		epoll_event pevents[64];
 		int ready = epoll_wait(m_PollFDs[tid], pevents, sizeof(pevents) / sizeof(pevents[0]), -1);
 
-		std::vector<EventDescription> events;
+		events.clear();
 
 		{
 			boost::mutex::scoped_lock lock(m_EventMutex[tid]);
 
+			/* Descriptors might have been removed while we were waiting. Their
+			 * events are skipped below; the events for all other sockets have
+			 * to be handled because the sockets are edge-triggered and the
+			 * kernel won't report them again. */
 			if (m_FDChanged[tid]) {
 				m_FDChanged[tid] = false;
-
-				continue;
+				m_CV[tid].notify_all();
 			}
 
 			for (int i = 0; i < ready; i++) {
-				if (pevents[i].data.fd == m_EventFDs[tid][0]) {
-					char buffer[512];
-					if (recv(m_EventFDs[tid][0], buffer, sizeof(buffer), 0) < 0)
-						Log(LogCritical, "SocketEvents", "Read from event FD failed.");
+				auto fd = static_cast<SOCKET>(pevents[i].data.u64 & 0xffffffff);
+				auto generation = static_cast<uint32_t>(pevents[i].data.u64 >> 32);
+
+				if (fd == m_EventFDs[tid][0]) {
+					ReadWakeUpEvent(tid);
 
 					continue;
 				}
 
-				if ((pevents[i].events & (EPOLLIN | EPOLLOUT | EPOLLHUP | EPOLLERR)) == 0)
+				auto it = m_Sockets[tid].find(fd);
+
+				if (it == m_Sockets[tid].end() || it->second.Generation != generation)
+					continue;
+
+				SocketEventDescriptor *desc = &it->second;
+
+				int revents = SocketEventEngineEpoll::EpollToPoll(pevents[i].events);
+
+				/* Events the socket is no longer interested in are removed lazily
+				 * when they show up, rather than every time ChangeEvents() is called. */
+				int unwanted = revents & desc->ArmedEvents & ~desc->Events;
+
+				if (unwanted)
+					ArmEvents(tid, desc->EventInterface->m_FD, *desc, desc->ArmedEvents & ~unwanted);
+
+				revents &= desc->Events | POLLERR | POLLHUP;
+
+				if (revents == 0)
 					continue;
 
 				EventDescription event;
-				event.REvents = SocketEventEngineEpoll::EpollToPoll(pevents[i].events);
-				event.Descriptor = m_Sockets[tid][pevents[i].data.fd];
+				event.REvents = revents;
+				event.Descriptor = *desc;
 				event.LifesupportReference = event.Descriptor.LifesupportObject;
 				VERIFY(event.LifesupportReference);
 
@@ -120,6 +181,8 @@ void SocketEventEngineEpoll::ThreadProc(int tid)
 			}
 		}
 
+		m_Stats[tid].Events += events.size();
+
 		for (const EventDescription& event : events) {
 			try {
 				event.Descriptor.EventInterface->OnEvent(event.REvents);
@@ -136,25 +199,27 @@ void SocketEventEngineEpoll::ThreadProc(int tid)
 
 void SocketEventEngineEpoll::Register(SocketEvents *se, Object *lifesupportObject)
 {
-	int tid = se->m_ID % SOCKET_IOTHREADS;
+	int tid = AssignThread();
 
 	{
 		boost::mutex::scoped_lock lock(m_EventMutex[tid]);
 
 		VERIFY(se->m_FD != INVALID_SOCKET);
 
-		SocketEventDescriptor desc;
-		desc.EventInterface = se;
-		desc.LifesupportObject = lifesupportObject;
+		se->m_ThreadIndex = tid;
 
 		VERIFY(m_Sockets[tid].find(se->m_FD) == m_Sockets[tid].end());
 
-		m_Sockets[tid][se->m_FD] = desc;
+		SocketEventDescriptor& desc = m_Sockets[tid][se->m_FD];
+		desc.Events = 0;
+		desc.EventInterface = se;
+		desc.LifesupportObject = lifesupportObject;
+		desc.Generation = l_NextGeneration++;
 
 		epoll_event event;
 		memset(&event, 0, sizeof(event));
-		event.data.fd = se->m_FD;
-		event.events = 0;
+		event.data.u64 = MakeEventData(se->m_FD, desc.Generation);
+		event.events = EPOLLET;
 		epoll_ctl(m_PollFDs[tid], EPOLL_CTL_ADD, se->m_FD, &event);
 
 		se->m_Events = true;
@@ -163,7 +228,7 @@ void SocketEventEngineEpoll::Register(SocketEvents *se, Object *lifesupportObjec
 
 void SocketEventEngineEpoll::Unregister(SocketEvents *se)
 {
-	int tid = se->m_ID % SOCKET_IOTHREADS;
+	int tid = se->m_ThreadIndex;
 
 	{
 		boost::mutex::scoped_lock lock(m_EventMutex[tid]);
@@ -174,6 +239,8 @@ void SocketEventEngineEpoll::Unregister(SocketEvents *se)
 		m_Sockets[tid].erase(se->m_FD);
 		m_FDChanged[tid] = true;
 
+		ReleaseThread(tid);
+
 		epoll_ctl(m_PollFDs[tid], EPOLL_CTL_DEL, se->m_FD, nullptr);
 
 		se->m_FD = INVALID_SOCKET;
@@ -188,7 +255,7 @@ void SocketEventEngineEpoll::ChangeEvents(SocketEvents *se, int events)
 	if (se->m_FD == INVALID_SOCKET)
 		BOOST_THROW_EXCEPTION(std::runtime_error("Tried to read/write from a closed socket."));
 
-	int tid = se->m_ID % SOCKET_IOTHREADS;
+	int tid = se->m_ThreadIndex;
 
 	{
 		boost::mutex::scoped_lock lock(m_EventMutex[tid]);
@@ -198,11 +265,17 @@ void SocketEventEngineEpoll::ChangeEvents(SocketEvents *se, int events)
 		if (it == m_Sockets[tid].end())
 			return;
 
-		epoll_event event;
-		memset(&event, 0, sizeof(event));
-		event.data.fd = se->m_FD;
-		event.events = SocketEventEngineEpoll::PollToEpoll(events);
-		epoll_ctl(m_PollFDs[tid], EPOLL_CTL_MOD, se->m_FD, &event);
+		SocketEventDescriptor& desc = it->second;
+
+		int added = events & ~desc.Events;
+
+		desc.Events = events;
+
+		/* Sockets are edge-triggered, so we only need to talk to the kernel when new
+		 * events are requested: The socket might have become ready while we weren't
+		 * interested in it, and re-arming it makes epoll check that again. */
+		if (added)
+			ArmEvents(tid, se->m_FD, desc, desc.ArmedEvents | events);
 	}
 }
 #endif /* __linux__ */
@@ -95,9 +95,7 @@ void SocketEventEnginePoll::ThreadProc(int tid)
 					continue;
 
 				if (pfds[i].fd == m_EventFDs[tid][0]) {
-					char buffer[512];
-					if (recv(m_EventFDs[tid][0], buffer, sizeof(buffer), 0) < 0)
-						Log(LogCritical, "SocketEvents", "Read from event FD failed.");
+					ReadWakeUpEvent(tid);
 
 					continue;
 				}
@@ -112,6 +110,8 @@ void SocketEventEnginePoll::ThreadProc(int tid)
 			}
 		}
 
+		m_Stats[tid].Events += events.size();
+
 		for (const EventDescription& event : events) {
 			try {
 				event.Descriptor.EventInterface->OnEvent(event.REvents);
@@ -128,13 +128,15 @@ void SocketEventEnginePoll::ThreadProc(int tid)
 
 void SocketEventEnginePoll::Register(SocketEvents *se, Object *lifesupportObject)
 {
-	int tid = se->m_ID % SOCKET_IOTHREADS;
+	int tid = AssignThread();
 
 	{
 		boost::mutex::scoped_lock lock(m_EventMutex[tid]);
 
 		VERIFY(se->m_FD != INVALID_SOCKET);
 
+		se->m_ThreadIndex = tid;
+
 		SocketEventDescriptor desc;
 		desc.Events = 0;
 		desc.EventInterface = se;
@@ -154,7 +156,7 @@ void SocketEventEnginePoll::Register(SocketEvents *se, Object *lifesupportObject
 
 void SocketEventEnginePoll::Unregister(SocketEvents *se)
 {
-	int tid = se->m_ID % SOCKET_IOTHREADS;
+	int tid = se->m_ThreadIndex;
 
 	{
 		boost::mutex::scoped_lock lock(m_EventMutex[tid]);
@@ -165,6 +167,8 @@ void SocketEventEnginePoll::Unregister(SocketEvents *se)
 		m_Sockets[tid].erase(se->m_FD);
 		m_FDChanged[tid] = true;
 
+		ReleaseThread(tid);
+
 		se->m_FD = INVALID_SOCKET;
 		se->m_Events = false;
 	}
@@ -177,7 +181,7 @@ void SocketEventEnginePoll::ChangeEvents(SocketEvents *se, int events)
 	if (se->m_FD == INVALID_SOCKET)
 		BOOST_THROW_EXCEPTION(std::runtime_error("Tried to read/write from a closed socket."));
 
-	int tid = se->m_ID % SOCKET_IOTHREADS;
+	int tid = se->m_ThreadIndex;
 
 	{
 		boost::mutex::scoped_lock lock(m_EventMutex[tid]);
@@ -22,10 +22,13 @@
 #include "base/logger.hpp"
 #include "base/application.hpp"
 #include "base/scriptglobal.hpp"
+#include "base/array.hpp"
+#include "base/convert.hpp"
 #include <boost/thread/once.hpp>
 #include <map>
 #ifdef __linux__
 #	include <sys/epoll.h>
+#	include <sys/eventfd.h>
 #endif /* __linux__ */
 
 using namespace icinga;
@@ -33,20 +36,41 @@ using namespace icinga;
 static boost::once_flag l_SocketIOOnceFlag = BOOST_ONCE_INIT;
 static SocketEventEngine *l_SocketIOEngine;
 
-int SocketEvents::m_NextID = 0;
-
-void SocketEventEngine::Start()
+void SocketEventEngine::Start(int threadCount)
 {
-	for (int tid = 0; tid < SOCKET_IOTHREADS; tid++) {
+	m_ThreadCount = threadCount;
+	m_Threads.reset(new std::thread[threadCount]);
+	m_EventFDs.reset(new SOCKET[threadCount][2]);
+	m_FDChanged.reset(new bool[threadCount]);
+	m_EventMutex.reset(new boost::mutex[threadCount]);
+	m_CV.reset(new boost::condition_variable[threadCount]);
+	m_Sockets.reset(new std::map<SOCKET, SocketEventDescriptor>[threadCount]);
+	m_Stats.reset(new SocketEventThreadStats[threadCount]);
+
+	for (int tid = 0; tid < threadCount; tid++) {
+#ifdef __linux__
+		/* An eventfd is used for both ends: Wakeups are counted by the
+		 * kernel and a single read() consumes all of them. */
+		m_EventFDs[tid][0] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+		if (m_EventFDs[tid][0] < 0) {
+			BOOST_THROW_EXCEPTION(posix_error()
+				<< boost::errinfo_api_function("eventfd")
+				<< boost::errinfo_errno(errno));
+		}
+
+		m_EventFDs[tid][1] = m_EventFDs[tid][0];
+#else /* __linux__ */
 		Socket::SocketPair(m_EventFDs[tid]);
 
 		Utility::SetNonBlockingSocket(m_EventFDs[tid][0]);
 		Utility::SetNonBlockingSocket(m_EventFDs[tid][1]);
 
-#ifndef _WIN32
+#	ifndef _WIN32
 		Utility::SetCloExec(m_EventFDs[tid][0]);
 		Utility::SetCloExec(m_EventFDs[tid][1]);
-#endif /* _WIN32 */
+#	endif /* _WIN32 */
+#endif /* __linux__ */
 
 		InitializeThread(tid);
 
@@ -54,29 +78,140 @@ void SocketEventEngine::Start()
 	}
 }
 
-void SocketEventEngine::WakeUpThread(int sid, bool wait)
+/**
+ * Checks whether the current thread is one of the engine's I/O threads.
+ */
+bool SocketEventEngine::IsEventThread() const
 {
-	int tid = sid % SOCKET_IOTHREADS;
+	std::thread::id id = std::this_thread::get_id();
+
+	for (int tid = 0; tid < m_ThreadCount; tid++) {
+		if (m_Threads[tid].get_id() == id)
+			return true;
+	}
 
+	return false;
+}
+
+void SocketEventEngine::WakeUpThread(int tid, bool wait)
+{
 	if (std::this_thread::get_id() == m_Threads[tid].get_id())
 		return;
 
+	/* Wakeups are coalesced: Only the first request since the thread has last
+	 * read its event FD needs to signal it. Its timestamp is also used to
+	 * measure the wakeup latency. */
+	double requested = 0;
+	bool pending = !m_Stats[tid].WakeUpRequested.compare_exchange_strong(requested, Utility::GetTime());
+
 	if (wait) {
 		boost::mutex::scoped_lock lock(m_EventMutex[tid]);
 
 		m_FDChanged[tid] = true;
 
 		while (m_FDChanged[tid]) {
-			(void) send(m_EventFDs[tid][1], "T", 1, 0);
+			SignalWakeUpEvent(tid);
 
 			boost::system_time const timeout = boost::get_system_time() + boost::posix_time::milliseconds(50);
 			m_CV[tid].timed_wait(lock, timeout);
 		}
-	} else {
-		(void) send(m_EventFDs[tid][1], "T", 1, 0);
+	} else if (!pending) {
+		SignalWakeUpEvent(tid);
 	}
 }
 
+void SocketEventEngine::SignalWakeUpEvent(int tid)
+{
+#ifdef __linux__
+	uint64_t value = 1;
+	(void) write(m_EventFDs[tid][1], &value, sizeof(value));
+#else /* __linux__ */
+	(void) send(m_EventFDs[tid][1], "T", 1, 0);
+#endif /* __linux__ */
+}
+
+/**
+ * Reads all pending wakeup notifications from the event FD.
+ * Must only be called by the thread itself.
+ */
+void SocketEventEngine::ReadWakeUpEvent(int tid)
+{
+	SocketEventThreadStats& stats = m_Stats[tid];
+
+	/* This has to happen before reading the event FD, otherwise
+	 * WakeUpThread() might skip a wakeup we've already consumed. */
+	double requested = stats.WakeUpRequested.exchange(0);
+
+#ifdef __linux__
+	uint64_t value;
+	if (read(m_EventFDs[tid][0], &value, sizeof(value)) < 0 && errno != EAGAIN)
+#else /* __linux__ */
+	char buffer[512];
+	if (recv(m_EventFDs[tid][0], buffer, sizeof(buffer), 0) < 0)
+#endif /* __linux__ */
+		Log(LogCritical, "SocketEvents", "Read from event FD failed.");
+
+	if (requested > 0) {
+		double latency = Utility::GetTime() - requested;
+		double avg = stats.AvgWakeUpLatency.load();
+
+		stats.AvgWakeUpLatency.store(avg + (latency - avg) / 16);
+		stats.WakeUps++;
+	}
+}
+
+/**
+ * Picks the thread with the least number of sockets for a new socket.
+ * Ties are broken by the number of events the threads have handled.
+ *
+ * @returns The thread index.
+ */
+int SocketEventEngine::AssignThread()
+{
+	boost::mutex::scoped_lock lock(m_AssignMutex);
+
+	int best = 0;
+
+	for (int tid = 1; tid < m_ThreadCount; tid++) {
+		const SocketEventThreadStats& stats = m_Stats[tid];
+		const SocketEventThreadStats& bestStats = m_Stats[best];
+
+		if (stats.Sockets < bestStats.Sockets ||
+		    (stats.Sockets == bestStats.Sockets && stats.Events < bestStats.Events))
+			best = tid;
+	}
+
+	m_Stats[best].Sockets++;
+
+	return best;
+}
+
+void SocketEventEngine::ReleaseThread(int tid)
+{
+	m_Stats[tid].Sockets--;
+}
+
+Dictionary::Ptr SocketEventEngine::GetStats() const
+{
+	Array::Ptr threads = new Array();
+
+	for (int tid = 0; tid < m_ThreadCount; tid++) {
+		const SocketEventThreadStats& stats = m_Stats[tid];
+
+		threads->Add(new Dictionary({
+			{ "sockets", stats.Sockets.load() },
+			{ "events", stats.Events.load() },
+			{ "wakeups", stats.WakeUps.load() },
+			{ "avg_wakeup_latency", stats.AvgWakeUpLatency.load() }
+		}));
+	}
+
+	return new Dictionary({
+		{ "engine", ScriptGlobal::Get("EventEngine", &Empty) },
+		{ "threads", threads }
+	});
+}
+
 void SocketEvents::InitializeEngine()
 {
 	String eventEngine = ScriptGlobal::Get("EventEngine", &Empty);
@@ -103,16 +238,35 @@ void SocketEvents::InitializeEngine()
 		l_SocketIOEngine = new SocketEventEnginePoll();
 	}
 
-	l_SocketIOEngine->Start();
+	int threadCount = 0;
+	Value threadsValue = ScriptGlobal::Get("EventEngineThreads", &Empty);
+
+	if (!threadsValue.IsEmpty())
+		threadCount = Convert::ToLong(threadsValue);
+
+	if (threadCount < 1) {
+		if (!threadsValue.IsEmpty()) {
+			Log(LogWarning, "SocketEvents")
+				<< "Invalid number of event engine threads: " << threadsValue << " - Using the number of CPU cores";
+		}
+
+		threadCount = std::thread::hardware_concurrency();
+
+		if (threadCount < 1)
+			threadCount = 8;
+	}
+
+	l_SocketIOEngine->Start(threadCount);
 
 	ScriptGlobal::Set("EventEngine", eventEngine);
+	ScriptGlobal::Set("EventEngineThreads", threadCount);
 }
 
 /**
  * Constructor for the SocketEvents class.
  */
 SocketEvents::SocketEvents(const Socket::Ptr& socket, Object *lifesupportObject)
-	: m_ID(m_NextID++), m_FD(socket->GetFD()), m_EnginePrivate(nullptr)
+	: m_FD(socket->GetFD()), m_EnginePrivate(nullptr)
 {
 	boost::call_once(l_SocketIOOnceFlag, &SocketEvents::InitializeEngine);
 
@@ -129,6 +283,15 @@ void SocketEvents::Register(Object *lifesupportObject)
 	l_SocketIOEngine->Register(this, lifesupportObject);
 }
 
+/**
+ * Checks whether the current thread handles socket events. These threads
+ * must not wait for other sockets' events.
+ */
+bool SocketEvents::IsEventThread()
+{
+	return l_SocketIOEngine && l_SocketIOEngine->IsEventThread();
+}
+
 void SocketEvents::Unregister()
 {
 	l_SocketIOEngine->Unregister(this);
@@ -146,11 +309,22 @@ boost::mutex& SocketEventEngine::GetMutex(int tid)
 
 bool SocketEvents::IsHandlingEvents() const
 {
-	int tid = m_ID % SOCKET_IOTHREADS;
-	boost::mutex::scoped_lock lock(l_SocketIOEngine->GetMutex(tid));
+	boost::mutex::scoped_lock lock(l_SocketIOEngine->GetMutex(m_ThreadIndex));
 	return m_Events;
 }
 
+/**
+ * Returns per-thread statistics for the socket event engine.
+ *
+ * @returns A dictionary with the statistics.
+ */
+Dictionary::Ptr SocketEvents::GetStats()
+{
+	boost::call_once(l_SocketIOOnceFlag, &SocketEvents::InitializeEngine);
+
+	return l_SocketIOEngine->GetStats();
+}
+
 void SocketEvents::OnEvent(int revents)
 {
 
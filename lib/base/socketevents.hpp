@@ -22,6 +22,8 @@
 
 #include "base/i2-base.hpp"
 #include "base/socket.hpp"
+#include "base/dictionary.hpp"
+#include <atomic>
 #include <thread>
 
 #ifndef _WIN32
@@ -34,6 +36,9 @@ namespace icinga
 /**
  * Socket event interface
  *
+ * OnEvent() has to keep reading or writing until the socket would block:
+ * The epoll engine is edge-triggered and doesn't report pending events again.
+ *
  * @ingroup base
  */
 class SocketEvents
@@ -52,17 +57,19 @@ public:
 	void *GetEnginePrivate() const;
 	void SetEnginePrivate(void *priv);
 
+	static Dictionary::Ptr GetStats();
+
+	static bool IsEventThread();
+
 protected:
 	SocketEvents(const Socket::Ptr& socket, Object *lifesupportObject);
 
 private:
-	int m_ID;
+	int m_ThreadIndex{-1};
 	SOCKET m_FD;
 	bool m_Events;
 	void *m_EnginePrivate;
 
-	static int m_NextID;
-
 	static void InitializeEngine();
 
 	void WakeUpThread(bool wait = false);
@@ -73,11 +80,11 @@ private:
 	friend class SocketEventEngineEpoll;
 };
 
-#define SOCKET_IOTHREADS 8
-
 struct SocketEventDescriptor
 {
 	int Events{POLLIN};
+	int ArmedEvents{0};
+	uint32_t Generation{0};
 	SocketEvents *EventInterface{nullptr};
 	Object *LifesupportObject{nullptr};
 };
@@ -89,15 +96,28 @@ struct EventDescription
 	Object::Ptr LifesupportReference;
 };
 
+struct SocketEventThreadStats
+{
+	std::atomic<int> Sockets{0};
+	std::atomic<unsigned long long> Events{0};
+	std::atomic<unsigned long long> WakeUps{0};
+	std::atomic<double> WakeUpRequested{0};
+	std::atomic<double> AvgWakeUpLatency{0};
+};
+
 class SocketEventEngine
 {
 public:
-	void Start();
+	void Start(int threadCount);
 
-	void WakeUpThread(int sid, bool wait);
+	void WakeUpThread(int tid, bool wait);
 
 	boost::mutex& GetMutex(int tid);
 
+	Dictionary::Ptr GetStats() const;
+
+	bool IsEventThread() const;
+
 protected:
 	virtual void InitializeThread(int tid) = 0;
 	virtual void ThreadProc(int tid) = 0;
@@ -105,12 +125,20 @@ protected:
 	virtual void Unregister(SocketEvents *se) = 0;
 	virtual void ChangeEvents(SocketEvents *se, int events) = 0;
 
-	std::thread m_Threads[SOCKET_IOTHREADS];
-	SOCKET m_EventFDs[SOCKET_IOTHREADS][2];
-	bool m_FDChanged[SOCKET_IOTHREADS];
-	boost::mutex m_EventMutex[SOCKET_IOTHREADS];
-	boost::condition_variable m_CV[SOCKET_IOTHREADS];
-	std::map<SOCKET, SocketEventDescriptor> m_Sockets[SOCKET_IOTHREADS];
+	int AssignThread();
+	void ReleaseThread(int tid);
+	void SignalWakeUpEvent(int tid);
+	void ReadWakeUpEvent(int tid);
+
+	int m_ThreadCount{0};
+	std::unique_ptr<std::thread[]> m_Threads;
+	std::unique_ptr<SOCKET[][2]> m_EventFDs;
+	std::unique_ptr<bool[]> m_FDChanged;
+	std::unique_ptr<boost::mutex[]> m_EventMutex;
+	std::unique_ptr<boost::condition_variable[]> m_CV;
+	std::unique_ptr<std::map<SOCKET, SocketEventDescriptor>[]> m_Sockets;
+	std::unique_ptr<SocketEventThreadStats[]> m_Stats;
+	boost::mutex m_AssignMutex;
 
 	friend class SocketEvents;
 };
@@ -140,7 +168,11 @@ protected:
 	virtual void ThreadProc(int tid);
 
 private:
-	SOCKET m_PollFDs[SOCKET_IOTHREADS];
+	std::unique_ptr<SOCKET[]> m_PollFDs;
+
+	void ArmEvents(int tid, SOCKET fd, SocketEventDescriptor& desc, int events);
+
+	static uint64_t MakeEventData(SOCKET fd, uint32_t generation);
 
 	static int PollToEpoll(int events);
 	static int EpollToPoll(int events);
@@ -50,6 +50,27 @@ size_t Stream::Peek(void *buffer, size_t count, bool allow_partial)
 	BOOST_THROW_EXCEPTION(std::runtime_error("Stream does not support Peek()."));
 }
 
+void Stream::WriteBuffers(String *buffers, size_t count)
+{
+	if (count == 1) {
+		Write(buffers[0].CStr(), buffers[0].GetLength());
+		return;
+	}
+
+	size_t length = 0;
+
+	for (size_t i = 0; i < count; i++)
+		length += buffers[i].GetLength();
+
+	std::string data;
+	data.reserve(length);
+
+	for (size_t i = 0; i < count; i++)
+		data.append(buffers[i].GetData());
+
+	Write(data.c_str(), data.size());
+}
+
 void Stream::SignalDataAvailable()
 {
 	OnDataAvailable(this);
@@ -100,6 +100,15 @@ public:
 	 */
 	virtual void Write(const void *buffer, size_t count) = 0;
 
+	/**
+	 * Writes several buffers to the stream as a single write. Streams may take
+	 * over the buffers instead of copying their contents.
+	 *
+	 * @param buffers The buffers. Their contents are unspecified afterwards.
+	 * @param count The number of buffers.
+	 */
+	virtual void WriteBuffers(String *buffers, size_t count);
+
 	/**
 	 * Causes the stream to be closed (via Close()) once all pending data has been
 	 * written.
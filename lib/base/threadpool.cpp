@@ -17,23 +17,36 @@
  * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
  ******************************************************************************/
 
+
 #include "base/threadpool.hpp"
 #include "base/logger.hpp"
 #include "base/debug.hpp"
 #include "base/utility.hpp"
 #include "base/exception.hpp"
 #include "base/application.hpp"
+#include "base/array.hpp"
+#include <boost/thread/tss.hpp>
 #include <iostream>
 
 using namespace icinga;
 
 int ThreadPool::m_NextID = 1;
 
+static void NullWorkerCleanup(void *)
+{ }
+
+static boost::thread_specific_ptr<void> l_CurrentWorker(&NullWorkerCleanup);
+
 ThreadPool::ThreadPool(size_t max_threads)
 	: m_ID(m_NextID++), m_MaxThreads(max_threads)
 {
-	if (m_MaxThreads != UINT_MAX && m_MaxThreads < sizeof(m_Queues) / sizeof(m_Queues[0]))
-		m_MaxThreads = sizeof(m_Queues) / sizeof(m_Queues[0]);
+	if (m_MaxThreads < MINTHREADS)
+		m_MaxThreads = MINTHREADS;
+
+	size_t slots = std::min<size_t>(m_MaxThreads, MAXTHREADS);
+
+	for (size_t i = 0; i < slots; i++)
+		m_Workers.emplace_back(new Worker(this, i));
 
 	Start();
 }
@@ -49,13 +62,22 @@ void ThreadPool::Start()
 		return;
 
 	m_Stopped = false;
+	m_WorkersStopped = false;
+
+	{
+		boost::mutex::scoped_lock lock(m_WorkersMutex);
 
-	for (auto& queue : m_Queues)
-		queue.SpawnWorker(m_ThreadGroup);
+		for (size_t i = 0; i < MINTHREADS; i++)
+			SpawnWorker();
+	}
 
 	m_MgmtThread = std::thread(std::bind(&ThreadPool::ManagerThreadProc, this));
 }
 
+/**
+ * Stops the thread pool. Work items which were posted before Stop()
+ * was called are processed before the worker threads terminate.
+ */
 void ThreadPool::Stop()
 {
 	if (m_Stopped)
@@ -70,126 +92,198 @@ void ThreadPool::Stop()
 	if (m_MgmtThread.joinable())
 		m_MgmtThread.join();
 
-	for (auto& queue : m_Queues) {
-		boost::mutex::scoped_lock lock(queue.Mutex);
-		queue.Stopped = true;
-		queue.CV.notify_all();
+	{
+		boost::mutex::scoped_lock lock(m_IdleMutex);
+		m_WorkersStopped = true;
+		m_IdleCV.notify_all();
 	}
 
 	m_ThreadGroup.join_all();
 	m_ThreadGroup.~thread_group();
 	new (&m_ThreadGroup) boost::thread_group();
 
-	for (auto& queue : m_Queues)
-		queue.Stopped = false;
+	/* Wait for detached zombie threads, they still reference their worker slot. */
+	for (;;) {
+		{
+			boost::mutex::scoped_lock lock(m_WorkersMutex);
+
+			if (std::none_of(m_Workers.begin(), m_Workers.end(),
+			    [](const std::unique_ptr<Worker>& worker) { return worker->State != ThreadDead; }))
+				break;
+		}
+
+		Utility::Sleep(0.01);
+	}
 
 	m_Stopped = true;
 }
 
 /**
- * Waits for work items and processes them.
+ * Finds the next work item for a worker: Items from the worker's own
+ * deque come first, followed by the global injection queue. If both are
+ * empty the worker tries to steal items from the other workers.
+ *
+ * @returns The work item or nullptr if there currently is no work.
  */
-void ThreadPool::WorkerThread::ThreadProc(Queue& queue)
+ThreadPool::WorkItem *ThreadPool::GetWorkItem(Worker& worker)
 {
-	std::ostringstream idbuf;
-	idbuf << "Q #" << &queue << " W #" << this;
-	Utility::SetThreadName(idbuf.str());
-
-	for (;;) {
-		WorkItem wi;
+	WorkItem *wi;
 
-		{
-			boost::mutex::scoped_lock lock(queue.Mutex);
+	while (worker.Items.Steal(&wi)) {
+		if (wi)
+			return wi;
+	}
 
-			UpdateUtilization(ThreadIdle);
+	{
+		boost::mutex::scoped_lock lock(m_InjectionMutex);
 
-			while (queue.Items.empty() && !queue.Stopped && !Zombie) {
-				if (queue.Items.empty())
-					queue.CVStarved.notify_all();
+		if (!m_InjectionQueue.empty()) {
+			wi = m_InjectionQueue.front();
+			m_InjectionQueue.pop_front();
+			return wi;
+		}
+	}
 
-				queue.CV.wait(lock);
-			}
+	size_t count = m_Workers.size();
 
-			if (Zombie)
-				break;
+	for (size_t i = 1; i < count; i++) {
+		Worker& victim = *m_Workers[(worker.Index + i) % count];
 
-			if (queue.Items.empty() && queue.Stopped)
-				break;
+		while (victim.Items.Steal(&wi)) {
+			if (wi) {
+				worker.StealCount.store(worker.StealCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+				return wi;
+			}
+		}
+	}
 
-			wi = queue.Items.front();
-			queue.Items.pop_front();
+	return nullptr;
+}
 
-			UpdateUtilization(ThreadBusy);
-		}
+void ThreadPool::RunWorkItem(Worker& worker, WorkItem *wi)
+{
+	double st = Utility::GetTime();
+	double latency = st - wi->Timestamp;
 
-		double st = Utility::GetTime();;
+	worker.BusySince.store(st, std::memory_order_relaxed);
 
 #ifdef I2_DEBUG
 #	ifdef RUSAGE_THREAD
-		struct rusage usage_start, usage_end;
+	struct rusage usage_start, usage_end;
 
-		(void) getrusage(RUSAGE_THREAD, &usage_start);
+	(void) getrusage(RUSAGE_THREAD, &usage_start);
 #	endif /* RUSAGE_THREAD */
 #endif /* I2_DEBUG */
 
-		try {
-			if (wi.Callback)
-				wi.Callback();
-		} catch (const std::exception& ex) {
-			Log(LogCritical, "ThreadPool")
-				<< "Exception thrown in event handler:\n"
-				<< DiagnosticInformation(ex);
-		} catch (...) {
-			Log(LogCritical, "ThreadPool", "Exception of unknown type thrown in event handler.");
-		}
+	try {
+		if (wi->Callback)
+			wi->Callback();
+	} catch (const std::exception& ex) {
+		Log(LogCritical, "ThreadPool")
+			<< "Exception thrown in event handler:\n"
+			<< DiagnosticInformation(ex);
+	} catch (...) {
+		Log(LogCritical, "ThreadPool", "Exception of unknown type thrown in event handler.");
+	}
 
-		double et = Utility::GetTime();
-		double latency = st - wi.Timestamp;
+	delete wi;
 
-		{
-			boost::mutex::scoped_lock lock(queue.Mutex);
+	double et = Utility::GetTime();
 
-			queue.WaitTime += latency;
-			queue.ServiceTime += et - st;
-			queue.TaskCount++;
-		}
+	worker.BusySince.store(0, std::memory_order_relaxed);
+	worker.BusyTime.store(worker.BusyTime.load(std::memory_order_relaxed) + (et - st), std::memory_order_relaxed);
+	worker.WaitTime.store(worker.WaitTime.load(std::memory_order_relaxed) + latency, std::memory_order_relaxed);
+
+	if (latency > worker.MaxWaitTime.load(std::memory_order_relaxed))
+		worker.MaxWaitTime.store(latency, std::memory_order_relaxed);
+
+	worker.TaskCount.store(worker.TaskCount.load(std::memory_order_relaxed) + 1, std::memory_order_release);
 
 #ifdef I2_DEBUG
 #	ifdef RUSAGE_THREAD
-		(void) getrusage(RUSAGE_THREAD, &usage_end);
+	(void) getrusage(RUSAGE_THREAD, &usage_end);
 
-		double duser = (usage_end.ru_utime.tv_sec - usage_start.ru_utime.tv_sec) +
-			(usage_end.ru_utime.tv_usec - usage_start.ru_utime.tv_usec) / 1000000.0;
+	double duser = (usage_end.ru_utime.tv_sec - usage_start.ru_utime.tv_sec) +
+		(usage_end.ru_utime.tv_usec - usage_start.ru_utime.tv_usec) / 1000000.0;
 
-		double dsys = (usage_end.ru_stime.tv_sec - usage_start.ru_stime.tv_sec) +
-			(usage_end.ru_stime.tv_usec - usage_start.ru_stime.tv_usec) / 1000000.0;
+	double dsys = (usage_end.ru_stime.tv_sec - usage_start.ru_stime.tv_sec) +
+		(usage_end.ru_stime.tv_usec - usage_start.ru_stime.tv_usec) / 1000000.0;
 
-		double dwait = (et - st) - (duser + dsys);
+	double dwait = (et - st) - (duser + dsys);
 
-		int dminfaults = usage_end.ru_minflt - usage_start.ru_minflt;
-		int dmajfaults = usage_end.ru_majflt - usage_start.ru_majflt;
+	int dminfaults = usage_end.ru_minflt - usage_start.ru_minflt;
+	int dmajfaults = usage_end.ru_majflt - usage_start.ru_majflt;
 
-		int dvctx = usage_end.ru_nvcsw - usage_start.ru_nvcsw;
-		int divctx = usage_end.ru_nivcsw - usage_start.ru_nivcsw;
+	int dvctx = usage_end.ru_nvcsw - usage_start.ru_nvcsw;
+	int divctx = usage_end.ru_nivcsw - usage_start.ru_nivcsw;
 #	endif /* RUSAGE_THREAD */
-		if (et - st > 0.5) {
-			Log(LogWarning, "ThreadPool")
+	if (et - st > 0.5) {
+		Log(LogWarning, "ThreadPool")
 #	ifdef RUSAGE_THREAD
-				<< "Event call took user:" << duser << "s, system:" << dsys << "s, wait:" << dwait << "s, minor_faults:" << dminfaults << ", major_faults:" << dmajfaults << ", voluntary_csw:" << dvctx << ", involuntary_csw:" << divctx;
+			<< "Event call took user:" << duser << "s, system:" << dsys << "s, wait:" << dwait << "s, minor_faults:" << dminfaults << ", major_faults:" << dmajfaults << ", voluntary_csw:" << dvctx << ", involuntary_csw:" << divctx;
 #	else
-				<< "Event call took " << (et - st) << "s";
+			<< "Event call took " << (et - st) << "s";
 #	endif /* RUSAGE_THREAD */
-		}
+	}
 #endif /* I2_DEBUG */
+}
+
+/**
+ * Waits for work items and processes them.
+ */
+void ThreadPool::WorkerThreadProc(Worker& worker)
+{
+	std::ostringstream idbuf;
+	idbuf << "TP #" << m_ID << " W #" << worker.Index;
+	Utility::SetThreadName(idbuf.str());
+
+	l_CurrentWorker.reset(&worker);
+
+	for (;;) {
+		WorkItem *wi = GetWorkItem(worker);
+
+		if (wi) {
+			m_Pending--;
+			RunWorkItem(worker, wi);
+			continue;
+		}
+
+		if (worker.Zombie)
+			break;
+
+		/* Another worker is about to publish an item or lost a race
+		 * for it - try again instead of going to sleep. */
+		if (m_Pending > 0) {
+			boost::this_thread::yield();
+			continue;
+		}
+
+		if (m_WorkersStopped)
+			break;
+
+		m_Sleeping++;
+
+		{
+			boost::mutex::scoped_lock lock(m_IdleMutex);
+
+			while (m_Pending == 0 && !m_WorkersStopped && !worker.Zombie)
+				m_IdleCV.wait(lock);
+		}
+
+		m_Sleeping--;
 	}
 
-	boost::mutex::scoped_lock lock(queue.Mutex);
-	UpdateUtilization(ThreadDead);
-	Zombie = false;
+	l_CurrentWorker.release();
+
+	boost::mutex::scoped_lock lock(m_WorkersMutex);
+	worker.State = ThreadDead;
+	worker.Zombie = false;
 }
 
 /**
- * Appends a work item to the work queue. Work items will be processed in FIFO order.
+ * Appends a work item to the thread pool. Items which are posted from
+ * one of the pool's worker threads are added to that worker's deque
+ * and are processed in FIFO order unless another worker steals them.
  *
  * @param callback The callback function for the work item.
  * @param policy The scheduling policy
@@ -197,28 +291,72 @@ void ThreadPool::WorkerThread::ThreadProc(Queue& queue)
  */
 bool ThreadPool::Post(const ThreadPool::WorkFunction& callback, SchedulerPolicy policy)
 {
-	WorkItem wi;
-	wi.Callback = callback;
-	wi.Timestamp = Utility::GetTime();
+	if (m_WorkersStopped)
+		return false;
+
+	if (policy == LowLatencyScheduler && m_Sleeping == 0) {
+		boost::mutex::scoped_lock lock(m_WorkersMutex);
+		SpawnWorker();
+	}
 
-	Queue& queue = m_Queues[Utility::Random() % (sizeof(m_Queues) / sizeof(m_Queues[0]))];
+	WorkItem *wi = new WorkItem();
+	wi->Callback = callback;
+	wi->Timestamp = Utility::GetTime();
 
-	{
-		boost::mutex::scoped_lock lock(queue.Mutex);
+	auto *worker = static_cast<Worker *>(l_CurrentWorker.get());
 
-		if (queue.Stopped)
-			return false;
+	if (worker && worker->Pool == this)
+		worker->Items.Push(wi);
+	else {
+		boost::mutex::scoped_lock lock(m_InjectionMutex);
+		m_InjectionQueue.push_back(wi);
+	}
 
-		if (policy == LowLatencyScheduler)
-			queue.SpawnWorker(m_ThreadGroup);
+	m_Pending++;
 
-		queue.Items.emplace_back(std::move(wi));
-		queue.CV.notify_one();
+	if (m_Sleeping > 0) {
+		boost::mutex::scoped_lock lock(m_IdleMutex);
+		m_IdleCV.notify_one();
 	}
 
 	return true;
 }
 
+/**
+ * Note: Caller must hold m_WorkersMutex.
+ */
+void ThreadPool::UpdateUtilization(Worker& worker, double now)
+{
+	double busyTime = worker.BusyTime.load(std::memory_order_relaxed);
+	double busySince = worker.BusySince.load(std::memory_order_relaxed);
+
+	if (busySince != 0 && busySince < now)
+		busyTime += now - busySince;
+
+	double time = now - worker.LastUpdate;
+	double busy = busyTime - worker.LastBusyTime;
+
+	worker.LastUpdate = now;
+	worker.LastBusyTime = busyTime;
+
+	if (time <= 0)
+		return;
+
+	double utilization = busy / time;
+
+	if (utilization < 0)
+		utilization = 0;
+	else if (utilization > 1)
+		utilization = 1;
+
+	const double avg_time = 5.0;
+
+	if (time > avg_time)
+		time = avg_time;
+
+	worker.Utilization = (worker.Utilization * (avg_time - time) + utilization * time) / avg_time;
+}
+
 void ThreadPool::ManagerThreadProc()
 {
 	std::ostringstream idbuf;
@@ -228,10 +366,6 @@ void ThreadPool::ManagerThreadProc()
 	double lastStats = 0;
 
 	for (;;) {
-		size_t total_pending = 0, total_alive = 0;
-		double total_avg_latency = 0;
-		double total_utilization = 0;
-
 		{
 			boost::mutex::scoped_lock lock(m_MgmtMutex);
 
@@ -242,120 +376,136 @@ void ThreadPool::ManagerThreadProc()
 				break;
 		}
 
-		for (auto& queue : m_Queues) {
-			size_t pending, alive = 0;
-			double avg_latency;
-			double utilization = 0;
+		size_t pending = m_Pending;
+		size_t alive = 0;
+		unsigned long tasks = 0, steals = 0;
+		double waitTime = 0;
+		double utilization = 0;
+		double now = Utility::GetTime();
 
-				boost::mutex::scoped_lock lock(queue.Mutex);
+		boost::mutex::scoped_lock lock(m_WorkersMutex);
 
-			for (auto& thread : queue.Threads)
-				thread.UpdateUtilization();
+		for (auto& worker : m_Workers) {
+			if (worker->State == ThreadDead || worker->Zombie)
+				continue;
 
-			pending = queue.Items.size();
+			UpdateUtilization(*worker, now);
 
-			for (auto& thread : queue.Threads) {
-				if (thread.State != ThreadDead && !thread.Zombie) {
-					alive++;
-					utilization += thread.Utilization * 100;
-				}
-			}
+			unsigned long taskCount = worker->TaskCount.load(std::memory_order_acquire);
+			double workerWaitTime = worker->WaitTime.load(std::memory_order_relaxed);
 
-			utilization /= alive;
+			alive++;
+			utilization += worker->Utilization * 100;
+			tasks += taskCount - worker->LastTaskCount;
+			waitTime += workerWaitTime - worker->LastWaitTime;
+			steals += worker->StealCount.load(std::memory_order_relaxed);
 
-			if (queue.TaskCount > 0)
-				avg_latency = queue.WaitTime / (queue.TaskCount * 1.0);
-			else
-				avg_latency = 0;
+			worker->LastTaskCount = taskCount;
+			worker->LastWaitTime = workerWaitTime;
+		}
 
-			if (utilization < 60 || utilization > 80 || alive < 8) {
-				double wthreads = std::ceil((utilization * alive) / 80.0);
+		if (alive > 0)
+			utilization /= alive;
 
-				int tthreads = wthreads - alive;
+		double avg_latency = (tasks > 0) ? waitTime / tasks : 0;
 
-				/* Make sure there is at least one thread per queue */
-				if (alive + tthreads < 1)
-					tthreads = 1 - alive;
+		if (utilization < 60 || utilization > 80 || alive < MINTHREADS * 2) {
+			double wthreads = std::ceil((utilization * alive) / 80.0);
 
-				/* Don't kill more than 2 threads at once. */
-				if (tthreads < -2)
-					tthreads = -2;
+			int tthreads = wthreads - alive;
 
-				/* Spawn more workers if there are outstanding work items. */
-				if (tthreads > 0 && pending > 0)
-					tthreads = 2;
+			/* Make sure there are at least MINTHREADS threads */
+			if (alive + tthreads < MINTHREADS)
+				tthreads = MINTHREADS - alive;
 
-				if (m_MaxThreads != UINT_MAX && (alive + tthreads) * (sizeof(m_Queues) / sizeof(m_Queues[0])) > m_MaxThreads)
-					tthreads = m_MaxThreads / (sizeof(m_Queues) / sizeof(m_Queues[0])) - alive;
+			/* Don't kill more than 2 threads at once. */
+			if (tthreads < -2)
+				tthreads = -2;
 
-				if (tthreads != 0) {
-					Log(LogNotice, "ThreadPool")
-						<< "Thread pool; current: " << alive << "; adjustment: " << tthreads;
-				}
+			/* Spawn more workers if there are outstanding work items. */
+			if (tthreads > 0 && pending > 0)
+				tthreads = 2;
 
-				for (int i = 0; i < -tthreads; i++)
-					queue.KillWorker(m_ThreadGroup);
+			if (alive + tthreads > m_Workers.size())
+				tthreads = m_Workers.size() - alive;
 
-				for (int i = 0; i < tthreads; i++)
-					queue.SpawnWorker(m_ThreadGroup);
+			if (tthreads != 0) {
+				Log(LogNotice, "ThreadPool")
+					<< "Thread pool; current: " << alive << "; adjustment: " << tthreads;
 			}
 
-			queue.WaitTime = 0;
-			queue.ServiceTime = 0;
-			queue.TaskCount = 0;
+			for (int i = 0; i < -tthreads; i++)
+				KillWorker();
 
-			total_pending += pending;
-			total_alive += alive;
-			total_avg_latency += avg_latency;
-			total_utilization += utilization;
+			for (int i = 0; i < tthreads; i++)
+				SpawnWorker();
 		}
 
-		double now = Utility::GetTime();
+		lock.unlock();
 
 		if (lastStats < now - 15) {
 			lastStats = now;
 
 			Log(LogNotice, "ThreadPool")
-				<< "Pool #" << m_ID << ": Pending tasks: " << total_pending << "; Average latency: "
-				<< (long)(total_avg_latency * 1000 / (sizeof(m_Queues) / sizeof(m_Queues[0]))) << "ms"
-				<< "; Threads: " << total_alive
-				<< "; Pool utilization: " << (total_utilization / (sizeof(m_Queues) / sizeof(m_Queues[0]))) << "%";
+				<< "Pool #" << m_ID << ": Pending tasks: " << pending << "; Average latency: "
+				<< (long)(avg_latency * 1000) << "ms"
+				<< "; Threads: " << alive
+				<< "; Pool utilization: " << utilization << "%"
+				<< "; Steals: " << steals;
 		}
 	}
 }
 
 /**
- * Note: Caller must hold m_Mutex
+ * Returns per-worker statistics for the thread pool.
+ *
+ * @returns A dictionary with the statistics.
  */
-void ThreadPool::Queue::SpawnWorker(boost::thread_group& group)
+Dictionary::Ptr ThreadPool::GetStats() const
 {
-	for (auto& thread : Threads) {
-		if (thread.State == ThreadDead) {
-			Log(LogDebug, "ThreadPool", "Spawning worker thread.");
+	Array::Ptr workers = new Array();
+	size_t alive = 0;
 
-			thread = WorkerThread(ThreadIdle);
-			thread.Thread = group.create_thread(std::bind(&ThreadPool::WorkerThread::ThreadProc, std::ref(thread), std::ref(*this)));
+	boost::mutex::scoped_lock lock(m_WorkersMutex);
 
-			break;
-		}
+	for (auto& worker : m_Workers) {
+		if (worker->State == ThreadDead)
+			continue;
+
+		unsigned long taskCount = worker->TaskCount.load(std::memory_order_acquire);
+
+		alive++;
+
+		workers->Add(new Dictionary({
+			{ "tasks", taskCount },
+			{ "steals", worker->StealCount.load(std::memory_order_relaxed) },
+			{ "avg_latency", (taskCount > 0) ? worker->WaitTime.load(std::memory_order_relaxed) / taskCount : 0.0 },
+			{ "max_latency", worker->MaxWaitTime.load(std::memory_order_relaxed) },
+			{ "utilization", worker->Utilization * 100 }
+		}));
 	}
+
+	return new Dictionary({
+		{ "pending", m_Pending.load() },
+		{ "threads", alive },
+		{ "workers", workers }
+	});
 }
 
 /**
- * Note: Caller must hold Mutex.
+ * Note: Caller must hold m_WorkersMutex.
  */
-void ThreadPool::Queue::KillWorker(boost::thread_group& group)
+void ThreadPool::SpawnWorker()
 {
-	for (auto& thread : Threads) {
-		if (thread.State == ThreadIdle && !thread.Zombie) {
-			Log(LogDebug, "ThreadPool", "Killing worker thread.");
-
-			group.remove_thread(thread.Thread);
-			thread.Thread->detach();
-			delete thread.Thread;
+	for (auto& worker : m_Workers) {
+		if (worker->State == ThreadDead) {
+			Log(LogDebug, "ThreadPool", "Spawning worker thread.");
 
-			thread.Zombie = true;
-			CV.notify_all();
+			worker->State = ThreadAlive;
+			worker->Utilization = 0;
+			worker->LastUpdate = Utility::GetTime();
+			worker->LastBusyTime = worker->BusyTime;
+			worker->Thread = m_ThreadGroup.create_thread(std::bind(&ThreadPool::WorkerThreadProc, this, std::ref(*worker)));
 
 			break;
 		}
@@ -363,36 +513,26 @@ void ThreadPool::Queue::KillWorker(boost::thread_group& group)
 }
 
 /**
- * Note: Caller must hold queue Mutex.
+ * Note: Caller must hold m_WorkersMutex.
  */
-void ThreadPool::WorkerThread::UpdateUtilization(ThreadState state)
+void ThreadPool::KillWorker()
 {
-	double utilization;
-
-	switch (State) {
-		case ThreadDead:
-			return;
-		case ThreadIdle:
-			utilization = 0;
-			break;
-		case ThreadBusy:
-			utilization = 1;
-			break;
-		default:
-			VERIFY(0);
-	}
-
-	double now = Utility::GetTime();
-	double time = now - LastUpdate;
-
-	const double avg_time = 5.0;
+	for (auto& worker : m_Workers) {
+		if (worker->State == ThreadAlive && !worker->Zombie && worker->BusySince == 0) {
+			Log(LogDebug, "ThreadPool", "Killing worker thread.");
 
-	if (time > avg_time)
-		time = avg_time;
+			m_ThreadGroup.remove_thread(worker->Thread);
+			worker->Thread->detach();
+			delete worker->Thread;
+			worker->Thread = nullptr;
 
-	Utilization = (Utilization * (avg_time - time) + utilization * time) / avg_time;
-	LastUpdate = now;
+			{
+				boost::mutex::scoped_lock lock(m_IdleMutex);
+				worker->Zombie = true;
+				m_IdleCV.notify_all();
+			}
 
-	if (state != ThreadUnspecified)
-		State = state;
+			break;
+		}
+	}
 }
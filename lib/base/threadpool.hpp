@@ -21,16 +21,20 @@
 #define THREADPOOL_H
 
 #include "base/i2-base.hpp"
+#include "base/dictionary.hpp"
+#include "base/workstealingdeque.hpp"
 #include <boost/thread/thread.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/condition_variable.hpp>
+#include <atomic>
 #include <deque>
 #include <thread>
 
 namespace icinga
 {
 
-#define QUEUECOUNT 4U
+#define MINTHREADS 4U
+#define MAXTHREADS 64U
 
 enum SchedulerPolicy
 {
@@ -39,7 +43,12 @@ enum SchedulerPolicy
 };
 
 /**
- * A thread pool.
+ * A work-stealing thread pool.
+ *
+ * Work items which are posted by one of the pool's worker threads are
+ * added to that worker's deque, all other work items go into a global
+ * injection queue. Idle workers take items from their own deque, then
+ * from the injection queue and finally steal them from other workers.
  *
  * @ingroup base
  */
@@ -56,13 +65,13 @@ public:
 
 	bool Post(const WorkFunction& callback, SchedulerPolicy policy = DefaultScheduler);
 
+	Dictionary::Ptr GetStats() const;
+
 private:
 	enum ThreadState
 	{
-		ThreadUnspecified,
 		ThreadDead,
-		ThreadIdle,
-		ThreadBusy
+		ThreadAlive
 	};
 
 	struct WorkItem
@@ -71,43 +80,34 @@ private:
 		double Timestamp;
 	};
 
-	struct Queue;
-
-	struct WorkerThread
+	struct Worker
 	{
+		ThreadPool *Pool;
+		size_t Index;
+		WorkStealingDeque<WorkItem> Items;
+
+		/* protected by m_WorkersMutex */
 		ThreadState State{ThreadDead};
-		bool Zombie{false};
+		boost::thread *Thread{nullptr};
 		double Utilization{0};
+		double LastBusyTime{0};
 		double LastUpdate{0};
-		boost::thread *Thread{nullptr};
+		unsigned long LastTaskCount{0};
+		double LastWaitTime{0};
 
-		WorkerThread(ThreadState state = ThreadDead)
-			: State(state)
-		{ }
-
-		void UpdateUtilization(ThreadState state = ThreadUnspecified);
+		std::atomic<bool> Zombie{false};
 
-		void ThreadProc(Queue& queue);
-	};
-
-	struct Queue
-	{
-		boost::mutex Mutex;
-		boost::condition_variable CV;
-		boost::condition_variable CVStarved;
+		/* only updated by the worker thread */
+		std::atomic<double> BusyTime{0};
+		std::atomic<double> BusySince{0};
+		std::atomic<unsigned long> TaskCount{0};
+		std::atomic<unsigned long> StealCount{0};
+		std::atomic<double> WaitTime{0};
+		std::atomic<double> MaxWaitTime{0};
 
-		std::deque<WorkItem> Items;
-
-		double WaitTime{0};
-		double ServiceTime{0};
-		int TaskCount{0};
-
-		bool Stopped{false};
-
-		WorkerThread Threads[16];
-
-		void SpawnWorker(boost::thread_group& group);
-		void KillWorker(boost::thread_group& group);
+		Worker(ThreadPool *pool, size_t index)
+			: Pool(pool), Index(index)
+		{ }
 	};
 
 	int m_ID;
@@ -122,7 +122,26 @@ private:
 	boost::condition_variable m_MgmtCV;
 	bool m_Stopped{true};
 
-	Queue m_Queues[QUEUECOUNT];
+	mutable boost::mutex m_WorkersMutex;
+	std::vector<std::unique_ptr<Worker> > m_Workers;
+
+	boost::mutex m_InjectionMutex;
+	std::deque<WorkItem *> m_InjectionQueue;
+
+	std::atomic<int> m_Pending{0};
+
+	boost::mutex m_IdleMutex;
+	boost::condition_variable m_IdleCV;
+	std::atomic<int> m_Sleeping{0};
+	std::atomic<bool> m_WorkersStopped{false};
+
+	void WorkerThreadProc(Worker& worker);
+	WorkItem *GetWorkItem(Worker& worker);
+	void RunWorkItem(Worker& worker, WorkItem *wi);
+
+	void SpawnWorker();
+	void KillWorker();
+	void UpdateUtilization(Worker& worker, double now);
 
 	void ManagerThreadProc();
 };
@@ -17,61 +17,84 @@
  * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
  ******************************************************************************/
 
+
 #include "base/timer.hpp"
 #include "base/debug.hpp"
 #include "base/utility.hpp"
+#include "base/timingwheel.hpp"
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/condition_variable.hpp>
-#include <boost/multi_index_container.hpp>
-#include <boost/multi_index/ordered_index.hpp>
-#include <boost/multi_index/key_extractors.hpp>
 #include <thread>
 
 using namespace icinga;
 
-namespace icinga {
+#define TIMERSHARDS 4U
 
-class TimerHolder {
-public:
-	TimerHolder(Timer *timer)
-		: m_Timer(timer)
-	{ }
+namespace
+{
 
-	inline Timer *GetObject() const
-	{
-		return m_Timer;
-	}
+/**
+ * Timers are distributed across several shards, each of which has its
+ * own lock, timing wheel and timer thread.
+ */
+struct TimerShard
+{
+	boost::mutex Mutex;
+	boost::condition_variable CV;
+	std::thread Thread;
+
+	/* 1ms resolution, items more than ~4 seconds in the future are kept
+	 * in the wheel's ordered overflow map. */
+	TimingWheel<Timer *> Timers{Utility::GetTime(), 0.001, 4096};
+
+	/* Statistics, protected by Mutex. */
+	unsigned long long Calls{0};
+	double AvgLateness{0};
+	double AvgJitter{0};
+	double MaxLateness[2]{0, 0};
+	long long MaxLatenessBucket{0};
+};
 
-	inline double GetNextUnlocked() const
-	{
-		return m_Timer->m_Next;
-	}
+}
 
-	operator Timer *() const
-	{
-		return m_Timer;
-	}
+static boost::mutex l_TimerMutex;
+static std::atomic<bool> l_StopTimerThread(false);
+static int l_AliveTimers;
 
-private:
-	Timer *m_Timer;
-};
+static TimerShard *GetTimerShards()
+{
+	static TimerShard shards[TIMERSHARDS];
+	return shards;
+}
 
+static TimerShard& GetTimerShard(const Timer *timer)
+{
+	return GetTimerShards()[(reinterpret_cast<uintptr_t>(timer) >> 4) % TIMERSHARDS];
 }
 
-typedef boost::multi_index_container<
-	TimerHolder,
-	boost::multi_index::indexed_by<
-		boost::multi_index::ordered_unique<boost::multi_index::const_mem_fun<TimerHolder, Timer *, &TimerHolder::GetObject> >,
-		boost::multi_index::ordered_non_unique<boost::multi_index::const_mem_fun<TimerHolder, double, &TimerHolder::GetNextUnlocked> >
-	>
-> TimerSet;
+static void StopTimerThreads()
+{
+	for (size_t i = 0; i < TIMERSHARDS; i++) {
+		TimerShard& shard = GetTimerShards()[i];
 
-static boost::mutex l_TimerMutex;
-static boost::condition_variable l_TimerCV;
-static std::thread l_TimerThread;
-static bool l_StopTimerThread;
-static TimerSet l_Timers;
-static int l_AliveTimers;
+		boost::mutex::scoped_lock lock(shard.Mutex);
+		l_StopTimerThread = true;
+		shard.CV.notify_all();
+	}
+
+	for (size_t i = 0; i < TIMERSHARDS; i++) {
+		std::thread& thread = GetTimerShards()[i].Thread;
+
+		if (!thread.joinable())
+			continue;
+
+		/* Timers might be stopped from an inline timer proc. */
+		if (thread.get_id() == std::this_thread::get_id())
+			thread.detach();
+		else
+			thread.join();
+	}
+}
 
 /**
  * Destructor for the Timer class.
@@ -83,14 +106,7 @@ Timer::~Timer()
 
 void Timer::Uninitialize()
 {
-	{
-		boost::mutex::scoped_lock lock(l_TimerMutex);
-		l_StopTimerThread = true;
-		l_TimerCV.notify_all();
-	}
-
-	if (l_TimerThread.joinable())
-		l_TimerThread.join();
+	StopTimerThreads();
 }
 
 /**
@@ -98,15 +114,20 @@ void Timer::Uninitialize()
  */
 void Timer::Call()
 {
+	double lateness = Utility::GetTime() - m_Deadline;
+
+	if (lateness < 0)
+		lateness = 0;
+
 	try {
 		OnTimerExpired(Timer::Ptr(this));
 	} catch (...) {
-		InternalReschedule(true);
+		InternalReschedule(true, -1, lateness);
 
 		throw;
 	}
 
-	InternalReschedule(true);
+	InternalReschedule(true, -1, lateness);
 }
 
 /**
@@ -116,7 +137,7 @@ void Timer::Call()
  */
 void Timer::SetInterval(double interval)
 {
-	boost::mutex::scoped_lock lock(l_TimerMutex);
+	boost::mutex::scoped_lock lock(GetTimerShard(this).Mutex);
 	m_Interval = interval;
 }
 
@@ -127,7 +148,7 @@ void Timer::SetInterval(double interval)
  */
 double Timer::GetInterval() const
 {
-	boost::mutex::scoped_lock lock(l_TimerMutex);
+	boost::mutex::scoped_lock lock(GetTimerShard(this).Mutex);
 	return m_Interval;
 }
 
@@ -138,11 +159,17 @@ void Timer::Start()
 {
 	{
 		boost::mutex::scoped_lock lock(l_TimerMutex);
-		m_Started = true;
+
+		{
+			boost::mutex::scoped_lock slock(GetTimerShard(this).Mutex);
+			m_Started = true;
+		}
 
 		if (l_AliveTimers++ == 0) {
 			l_StopTimerThread = false;
-			l_TimerThread = std::thread(&Timer::TimerThreadProc);
+
+			for (size_t i = 0; i < TIMERSHARDS; i++)
+				GetTimerShards()[i].Thread = std::thread(std::bind(&Timer::TimerThreadProc, i));
 		}
 	}
 
@@ -157,28 +184,34 @@ void Timer::Stop(bool wait)
 	if (l_StopTimerThread)
 		return;
 
-	boost::mutex::scoped_lock lock(l_TimerMutex);
+	TimerShard& shard = GetTimerShard(this);
 
-	if (m_Started && --l_AliveTimers == 0) {
-		l_StopTimerThread = true;
-		l_TimerCV.notify_all();
+	{
+		boost::mutex::scoped_lock lock(l_TimerMutex);
 
-		lock.unlock();
+		bool started;
 
-		if (l_TimerThread.joinable() && l_TimerThread.get_id() != std::this_thread::get_id())
-			l_TimerThread.join();
+		{
+			boost::mutex::scoped_lock slock(shard.Mutex);
+			started = m_Started;
+		}
 
-		lock.lock();
-	}
+		if (started && --l_AliveTimers == 0)
+			StopTimerThreads();
 
-	m_Started = false;
-	l_Timers.erase(this);
+		boost::mutex::scoped_lock slock(shard.Mutex);
+
+		m_Started = false;
+		shard.Timers.Erase(this);
+
+		/* Notify the timer thread that we've disabled a timer. */
+		shard.CV.notify_all();
+	}
 
-	/* Notify the worker thread that we've disabled a timer. */
-	l_TimerCV.notify_all();
+	boost::mutex::scoped_lock slock(shard.Mutex);
 
 	while (wait && m_Running)
-		l_TimerCV.wait(lock);
+		shard.CV.wait(slock);
 }
 
 void Timer::Reschedule(double next)
@@ -192,14 +225,44 @@ void Timer::Reschedule(double next)
  * @param completed Whether the timer has just completed its callback.
  * @param next The time when this timer should be called again. Use -1 to let
  *        the timer figure out a suitable time based on the interval.
+ * @param lateness How late the completed call was, or -1.
  */
-void Timer::InternalReschedule(bool completed, double next)
+void Timer::InternalReschedule(bool completed, double next, double lateness)
 {
-	boost::mutex::scoped_lock lock(l_TimerMutex);
+	TimerShard& shard = GetTimerShard(this);
 
-	if (completed)
+	boost::mutex::scoped_lock lock(shard.Mutex);
+
+	if (completed) {
 		m_Running = false;
 
+		if (lateness >= 0) {
+			const double alpha = 1.0 / 16;
+
+			shard.AvgLateness += (lateness - shard.AvgLateness) * alpha;
+
+			if (m_LastLateness >= 0)
+				shard.AvgJitter += (std::fabs(lateness - m_LastLateness) - shard.AvgJitter) * alpha;
+
+			m_LastLateness = lateness;
+
+			/* Keep the maximum for the current and the previous minute. */
+			long long bucket = static_cast<long long>(m_Deadline / 60);
+
+			if (bucket != shard.MaxLatenessBucket) {
+				shard.MaxLateness[0] = (bucket == shard.MaxLatenessBucket + 1) ? shard.MaxLateness[1] : 0;
+				shard.MaxLateness[1] = 0;
+				shard.MaxLatenessBucket = bucket;
+			}
+
+			if (lateness > shard.MaxLateness[1])
+				shard.MaxLateness[1] = lateness;
+		}
+
+		/* Notify Stop() callers which are waiting for this timer. */
+		shard.CV.notify_all();
+	}
+
 	if (next < 0) {
 		/* Don't schedule the next call if this is not a periodic timer. */
 		if (m_Interval <= 0)
@@ -211,12 +274,10 @@ void Timer::InternalReschedule(bool completed, double next)
 	m_Next = next;
 
 	if (m_Started && !m_Running) {
-		/* Remove and re-add the timer to update the index. */
-		l_Timers.erase(this);
-		l_Timers.insert(this);
+		shard.Timers.Insert(this, m_Next);
 
-		/* Notify the worker that we've rescheduled a timer. */
-		l_TimerCV.notify_all();
+		/* Notify the timer thread that we've rescheduled a timer. */
+		shard.CV.notify_all();
 	}
 }
 
@@ -227,7 +288,7 @@ void Timer::InternalReschedule(bool completed, double next)
  */
 double Timer::GetNext() const
 {
-	boost::mutex::scoped_lock lock(l_TimerMutex);
+	boost::mutex::scoped_lock lock(GetTimerShard(this).Mutex);
 	return m_Next;
 }
 
@@ -239,75 +300,133 @@ double Timer::GetNext() const
  */
 void Timer::AdjustTimers(double adjustment)
 {
-	boost::mutex::scoped_lock lock(l_TimerMutex);
-
 	double now = Utility::GetTime();
 
-	typedef boost::multi_index::nth_index<TimerSet, 1>::type TimerView;
-	TimerView& idx = boost::get<1>(l_Timers);
+	for (size_t i = 0; i < TIMERSHARDS; i++) {
+		TimerShard& shard = GetTimerShards()[i];
+
+		boost::mutex::scoped_lock lock(shard.Mutex);
+
+		for (Timer *timer : shard.Timers.GetItems()) {
+			if (std::fabs(now - (timer->m_Next + adjustment)) <
+				std::fabs(now - timer->m_Next)) {
+				timer->m_Next += adjustment;
+				shard.Timers.Insert(timer, timer->m_Next);
+			}
+		}
+
+		/* Notify the timer thread that we've rescheduled some timers. */
+		shard.CV.notify_all();
+	}
+}
 
-	std::vector<Timer *> timers;
+/**
+ * Returns statistics about how late timers were called.
+ *
+ * @returns A dictionary with the statistics.
+ */
+Dictionary::Ptr Timer::GetStats()
+{
+	unsigned long long calls = 0;
+	size_t timers = 0;
+	double avgLateness = 0, avgJitter = 0, maxLateness = 0;
+	int activeShards = 0;
 
-	for (Timer *timer : idx) {
-		if (std::fabs(now - (timer->m_Next + adjustment)) <
-			std::fabs(now - timer->m_Next)) {
-			timer->m_Next += adjustment;
-			timers.push_back(timer);
+	long long bucket = static_cast<long long>(Utility::GetTime() / 60);
+
+	for (size_t i = 0; i < TIMERSHARDS; i++) {
+		TimerShard& shard = GetTimerShards()[i];
+
+		boost::mutex::scoped_lock lock(shard.Mutex);
+
+		timers += shard.Timers.GetSize();
+		calls += shard.Calls;
+
+		if (shard.Calls > 0) {
+			avgLateness += shard.AvgLateness;
+			avgJitter += shard.AvgJitter;
+			activeShards++;
 		}
+
+		if (bucket - shard.MaxLatenessBucket <= 1)
+			maxLateness = std::max(maxLateness, shard.MaxLateness[1]);
+
+		if (bucket == shard.MaxLatenessBucket)
+			maxLateness = std::max(maxLateness, shard.MaxLateness[0]);
 	}
 
-	for (Timer *timer : timers) {
-		l_Timers.erase(timer);
-		l_Timers.insert(timer);
+	if (activeShards > 0) {
+		avgLateness /= activeShards;
+		avgJitter /= activeShards;
 	}
 
-	/* Notify the worker that we've rescheduled some timers. */
-	l_TimerCV.notify_all();
+	return new Dictionary({
+		{ "timers", timers },
+		{ "calls", calls },
+		{ "avg_lateness", avgLateness },
+		{ "max_lateness", maxLateness },
+		{ "avg_jitter", avgJitter }
+	});
 }
 
 /**
  * Worker thread proc for Timer objects.
  */
-void Timer::TimerThreadProc()
+void Timer::TimerThreadProc(size_t shardIndex)
 {
-	Utility::SetThreadName("Timer Thread");
+	std::ostringstream idbuf;
+	idbuf << "Timer Thread #" << shardIndex;
+	Utility::SetThreadName(idbuf.str());
 
-	for (;;) {
-		boost::mutex::scoped_lock lock(l_TimerMutex);
+	TimerShard& shard = GetTimerShards()[shardIndex];
 
-		typedef boost::multi_index::nth_index<TimerSet, 1>::type NextTimerView;
-		NextTimerView& idx = boost::get<1>(l_Timers);
+	boost::mutex::scoped_lock lock(shard.Mutex);
 
+	for (;;) {
 		/* Wait until there is at least one timer. */
-		while (idx.empty() && !l_StopTimerThread)
-			l_TimerCV.wait(lock);
+		while (shard.Timers.GetSize() == 0 && !l_StopTimerThread)
+			shard.CV.wait(lock);
 
 		if (l_StopTimerThread)
 			break;
 
-		auto it = idx.begin();
-		Timer *timer = *it;
+		double now = Utility::GetTime();
+
+		Timer *timer;
+		double deadline;
 
-		double wait = timer->m_Next - Utility::GetTime();
+		if (!shard.Timers.GetNext(now, &timer, &deadline))
+			continue;
 
-		if (wait > 0.01) {
+		double wait = deadline - now;
+
+		if (wait > 0.001) {
 			/* Wait for the next timer. */
-			l_TimerCV.timed_wait(lock, boost::posix_time::milliseconds(wait * 1000));
+			shard.CV.timed_wait(lock, boost::posix_time::microseconds(static_cast<long>(wait * 1000 * 1000)));
 
 			continue;
 		}
 
 		Timer::Ptr ptimer = timer;
 
-		/* Remove the timer from the list so it doesn't get called again
+		/* Remove the timer from the wheel so it doesn't get called again
 		 * until the current call is completed. */
-		l_Timers.erase(timer);
+		shard.Timers.Erase(timer);
 
 		timer->m_Running = true;
+		timer->m_Deadline = deadline;
+
+		shard.Calls++;
 
 		lock.unlock();
 
 		/* Asynchronously call the timer. */
 		Utility::QueueAsyncCallback(std::bind(&Timer::Call, ptimer));
+
+		/* Release the timer before re-acquiring the lock, its destructor
+		 * needs the lock as well. */
+		ptimer.reset();
+
+		lock.lock();
 	}
 }
@@ -22,12 +22,11 @@
 
 #include "base/i2-base.hpp"
 #include "base/object.hpp"
+#include "base/dictionary.hpp"
 #include <boost/signals2.hpp>
 
 namespace icinga {
 
-class TimerHolder;
-
 /**
  * A timer that periodically triggers an event.
  *
@@ -53,6 +52,8 @@ public:
 	void Reschedule(double next = -1);
 	double GetNext() const;
 
+	static Dictionary::Ptr GetStats();
+
 	boost::signals2::signal<void(const Timer::Ptr&)> OnTimerExpired;
 
 private:
@@ -60,13 +61,13 @@ private:
 	double m_Next{0}; /**< When the next event should happen. */
 	bool m_Started{false}; /**< Whether the timer is enabled. */
 	bool m_Running{false}; /**< Whether the timer proc is currently running. */
+	double m_Deadline{0}; /**< When the current call was due. */
+	double m_LastLateness{-1}; /**< How late the previous call was. */
 
 	void Call();
-	void InternalReschedule(bool completed, double next = -1);
-
-	static void TimerThreadProc();
+	void InternalReschedule(bool completed, double next = -1, double lateness = -1);
 
-	friend class TimerHolder;
+	static void TimerThreadProc(size_t shardIndex);
 };
 
 }
@@ -0,0 +1,296 @@
+/******************************************************************************
+ * Icinga 2                                                                   *
+ * Copyright (C) 2012-2018 Icinga Development Team (https://www.icinga.com/)  *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or              *
+ * modify it under the terms of the GNU General Public License                *
+ * as published by the Free Software Foundation; either version 2             *
+ * of the License, or (at your option) any later version.                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software Foundation     *
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
+ ******************************************************************************/
+
+
+#ifndef TIMINGWHEEL_H
+#define TIMINGWHEEL_H
+
+#include "base/i2-base.hpp"
+#include "base/object.hpp"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+namespace icinga
+{
+
+/**
+ * Hash function for items stored in a timing wheel.
+ *
+ * @ingroup base
+ */
+template<typename T>
+struct TimingWheelHash : std::hash<T>
+{ };
+
+template<typename T>
+struct TimingWheelHash<intrusive_ptr<T> >
+{
+	size_t operator()(const intrusive_ptr<T>& item) const
+	{
+		return std::hash<T *>()(item.get());
+	}
+};
+
+/**
+ * A hashed timing wheel which keeps track of items and their deadlines.
+ *
+ * Items whose deadline is within the wheel's horizon (resolution * slots
+ * seconds after the current position) are stored in the slot for their tick,
+ * which makes inserting, rescheduling and removing them O(1). Items beyond
+ * the horizon are kept in an ordered overflow map and are moved into the
+ * wheel once the horizon reaches them. A bitmap of the non-empty slots lets
+ * GetNext() skip empty slots 64 at a time.
+ *
+ * This class is not thread-safe.
+ *
+ * @ingroup base
+ */
+template<typename T>
+class TimingWheel
+{
+public:
+	TimingWheel(double now, double resolution = 0.1, size_t slots = 4096)
+		: m_Resolution(resolution), m_Slots(slots), m_Occupied((slots + 63) / 64), m_Cursor(GetTick(now))
+	{ }
+
+	TimingWheel(const TimingWheel&) = delete;
+	TimingWheel& operator=(const TimingWheel&) = delete;
+
+	/**
+	 * Adds an item to the wheel. If the item is already in the wheel it is
+	 * rescheduled.
+	 */
+	void Insert(const T& item, double deadline)
+	{
+		auto it = m_Entries.find(item);
+
+		if (it != m_Entries.end())
+			Unlink(&*it);
+		else
+			it = m_Entries.insert(std::make_pair(item, Entry())).first;
+
+		it->second.Deadline = deadline;
+		Link(&*it);
+	}
+
+	bool Erase(const T& item)
+	{
+		auto it = m_Entries.find(item);
+
+		if (it == m_Entries.end())
+			return false;
+
+		Unlink(&*it);
+		m_Entries.erase(it);
+
+		return true;
+	}
+
+	bool Contains(const T& item) const
+	{
+		return m_Entries.find(item) != m_Entries.end();
+	}
+
+	/**
+	 * Finds the item with the earliest deadline. Items within the same tick
+	 * are returned in no particular order, i.e. the result may be off by up
+	 * to the wheel's resolution. The item is not removed from the wheel.
+	 *
+	 * @param now The current time, used to advance the wheel.
+	 * @returns false if the wheel is empty.
+	 */
+	bool GetNext(double now, T *item, double *deadline)
+	{
+		MigrateOverflow();
+
+		long long end = m_Cursor + m_Slots.size();
+		long long tick = FindOccupiedSlot(m_Cursor, end);
+
+		/* Empty slots in the past can't receive new items anymore. */
+		m_Cursor = std::max(m_Cursor, std::min(tick, GetTick(now)));
+
+		if (tick < end) {
+			EntryPair *next = m_Slots[tick % m_Slots.size()].back();
+
+			*item = next->first;
+			*deadline = next->second.Deadline;
+			return true;
+		}
+
+		if (m_Overflow.empty())
+			return false;
+
+		*item = m_Overflow.begin()->second->first;
+		*deadline = m_Overflow.begin()->first;
+		return true;
+	}
+
+	size_t GetSize() const
+	{
+		return m_Entries.size();
+	}
+
+	/**
+	 * Returns all items which are currently in the wheel, in no particular
+	 * order.
+	 */
+	std::vector<T> GetItems() const
+	{
+		std::vector<T> items;
+		items.reserve(m_Entries.size());
+
+		for (const EntryPair& pair : m_Entries)
+			items.push_back(pair.first);
+
+		return items;
+	}
+
+	void Clear()
+	{
+		for (Slot& slot : m_Slots)
+			slot.clear();
+
+		std::fill(m_Occupied.begin(), m_Occupied.end(), 0);
+
+		m_Overflow.clear();
+		m_Entries.clear();
+	}
+
+private:
+	struct Entry;
+
+	typedef std::unordered_map<T, Entry, TimingWheelHash<T> > EntryMap;
+	typedef typename EntryMap::value_type EntryPair;
+	typedef std::vector<EntryPair *> Slot;
+	typedef std::multimap<double, EntryPair *> OverflowMap;
+
+	struct Entry
+	{
+		double Deadline;
+		long long Tick;
+		size_t SlotIndex;
+		typename OverflowMap::iterator OverflowIterator;
+		bool Overflow;
+	};
+
+	double m_Resolution;
+	std::vector<Slot> m_Slots;
+	std::vector<uint64_t> m_Occupied; /* one bit per non-empty slot */
+	long long m_Cursor;
+	OverflowMap m_Overflow;
+	EntryMap m_Entries;
+
+	long long GetTick(double deadline) const
+	{
+		return static_cast<long long>(std::floor(deadline / m_Resolution));
+	}
+
+	void Link(EntryPair *pair)
+	{
+		Entry& entry = pair->second;
+
+		/* Items which are already due are placed in the current slot. */
+		long long tick = std::max(GetTick(entry.Deadline), m_Cursor);
+
+		if (tick >= m_Cursor + static_cast<long long>(m_Slots.size())) {
+			entry.Overflow = true;
+			entry.OverflowIterator = m_Overflow.insert(std::make_pair(entry.Deadline, pair));
+			return;
+		}
+
+		Slot& slot = m_Slots[tick % m_Slots.size()];
+
+		entry.Overflow = false;
+		entry.Tick = tick;
+		entry.SlotIndex = slot.size();
+		slot.push_back(pair);
+
+		size_t index = tick % m_Slots.size();
+		m_Occupied[index / 64] |= static_cast<uint64_t>(1) << (index % 64);
+	}
+
+	void Unlink(EntryPair *pair)
+	{
+		Entry& entry = pair->second;
+
+		if (entry.Overflow) {
+			m_Overflow.erase(entry.OverflowIterator);
+			return;
+		}
+
+		Slot& slot = m_Slots[entry.Tick % m_Slots.size()];
+
+		slot[entry.SlotIndex] = slot.back();
+		slot[entry.SlotIndex]->second.SlotIndex = entry.SlotIndex;
+		slot.pop_back();
+
+		if (slot.empty()) {
+			size_t index = entry.Tick % m_Slots.size();
+			m_Occupied[index / 64] &= ~(static_cast<uint64_t>(1) << (index % 64));
+		}
+	}
+
+	/**
+	 * Finds the first non-empty slot in [from, to).
+	 *
+	 * @returns The slot's tick or to if all slots in the range are empty.
+	 */
+	long long FindOccupiedSlot(long long from, long long to) const
+	{
+		long long tick = from;
+
+		while (tick < to) {
+			size_t index = tick % m_Slots.size();
+			uint64_t bits = m_Occupied[index / 64] >> (index % 64);
+
+			if (bits == 0) {
+				/* Skip to the next word, which might wrap around to slot 0. */
+				tick += std::min(64 - index % 64, m_Slots.size() - index);
+				continue;
+			}
+
+			while (!(bits & 1)) {
+				bits >>= 1;
+				tick++;
+			}
+
+			return std::min(tick, to);
+		}
+
+		return to;
+	}
+
+	void MigrateOverflow()
+	{
+		long long end = m_Cursor + m_Slots.size();
+
+		while (!m_Overflow.empty() && GetTick(m_Overflow.begin()->first) < end) {
+			EntryPair *pair = m_Overflow.begin()->second;
+			m_Overflow.erase(m_Overflow.begin());
+			Link(pair);
+		}
+	}
+};
+
+}
+
+#endif /* TIMINGWHEEL_H */
@@ -21,6 +21,8 @@
 #include "base/utility.hpp"
 #include "base/exception.hpp"
 #include "base/logger.hpp"
+#include "base/scriptglobal.hpp"
+#include "base/convert.hpp"
 #include <iostream>
 
 #ifndef _WIN32
@@ -40,8 +42,9 @@ bool TlsStream::m_SSLIndexInitialized = false;
  */
 TlsStream::TlsStream(const Socket::Ptr& socket, const String& hostname, ConnectionRole role, const std::shared_ptr<SSL_CTX>& sslContext)
 	: SocketEvents(socket, this), m_Eof(false), m_HandshakeOK(false), m_VerifyOK(true), m_ErrorCode(0),
-	m_ErrorOccurred(false),  m_Socket(socket), m_Role(role), m_SendQ(new FIFO()), m_RecvQ(new FIFO()),
-	m_CurrentAction(TlsActionNone), m_Retry(false), m_Shutdown(false)
+	m_ErrorOccurred(false),  m_Socket(socket), m_Role(role), m_RecvQ(new FIFO()),
+	m_CurrentAction(TlsActionNone), m_Retry(false), m_Shutdown(false), m_KernelTls(false),
+	m_MaxBufferSize(0), m_ReadPaused(false)
 {
 	std::ostringstream msgbuf;
 	char errbuf[120];
@@ -70,6 +73,16 @@ TlsStream::TlsStream(const Socket::Ptr& socket, const String& hostname, Connecti
 
 	SSL_set_fd(m_SSL.get(), socket->GetFD());
 
+	Value maxBufferSize = ScriptGlobal::Get("MaxConnectionBufferSize", &Empty);
+
+	if (!maxBufferSize.IsEmpty())
+		m_MaxBufferSize = Convert::ToLong(maxBufferSize);
+
+#ifdef I2_KTLS
+	if (ScriptGlobal::Get("TlsKernelOffload", &Empty).ToBool())
+		SSL_set_options(m_SSL.get(), SSL_OP_ENABLE_KTLS);
+#endif /* I2_KTLS */
+
 	if (m_Role == RoleServer)
 		SSL_set_accept_state(m_SSL.get());
 	else {
@@ -151,10 +164,10 @@ void TlsStream::OnEvent(int revents)
 	if (m_CurrentAction == TlsActionNone) {
 		if (revents & (POLLIN | POLLERR | POLLHUP))
 			m_CurrentAction = TlsActionRead;
-		else if (m_SendQ->GetAvailableBytes() > 0 && (revents & POLLOUT))
+		else if (!m_SendQ.IsEmpty() && (revents & POLLOUT))
 			m_CurrentAction = TlsActionWrite;
 		else {
-			ChangeEvents(POLLIN);
+			ChangeEvents(GetPollEvents());
 			return;
 		}
 	}
@@ -166,94 +179,154 @@ void TlsStream::OnEvent(int revents)
 	 */
 	ERR_clear_error();
 
-	switch (m_CurrentAction) {
-		case TlsActionRead:
-			do {
-				rc = SSL_read(m_SSL.get(), buffer, sizeof(buffer));
+	for (;;) {
+		switch (m_CurrentAction) {
+			case TlsActionRead:
+				do {
+					/* Stop reading when the application doesn't keep up, Read() resumes it. */
+					if (m_MaxBufferSize > 0 && m_RecvQ->GetAvailableBytes() >= m_MaxBufferSize) {
+						m_ReadPaused = true;
+						success = true;
+						rc = 1;
+						break;
+					}
+
+					rc = SSL_read(m_SSL.get(), buffer, sizeof(buffer));
+
+					if (rc > 0) {
+						m_RecvQ->Write(buffer, rc);
+						success = true;
+					}
+				} while (rc > 0);
+
+				if (success)
+					m_CV.notify_all();
 
-				if (rc > 0) {
-					m_RecvQ->Write(buffer, rc);
-					success = true;
-				}
-			} while (rc > 0);
+				break;
+			case TlsActionWrite:
+#ifdef I2_KTLS
+				if (m_KernelTls && !SSL_want_write(m_SSL.get())) {
+					if (!WriteKernelTls(success)) {
+						m_ErrorOccurred = true;
 
-			if (success)
-				m_CV.notify_all();
+						Log(LogWarning, "TlsStream", "TLS stream was disconnected.");
 
-			break;
-		case TlsActionWrite:
-			count = m_SendQ->Peek(buffer, sizeof(buffer), true);
+						lock.unlock();
 
-			rc = SSL_write(m_SSL.get(), buffer, count);
+						Close();
 
-			if (rc > 0) {
-				m_SendQ->Read(nullptr, rc, true);
-				success = true;
-			}
+						return;
+					}
 
-			break;
-		case TlsActionHandshake:
-			rc = SSL_do_handshake(m_SSL.get());
+					rc = 1;
 
-			if (rc > 0) {
-				success = true;
-				m_HandshakeOK = true;
-				m_CV.notify_all();
-			}
+					break;
+				}
+#endif /* I2_KTLS */
 
-			break;
-		default:
-			VERIFY(!"Invalid TlsAction");
-	}
+				do {
+					BufferSegment segment;
+					const char *data;
 
-	if (rc <= 0) {
-		int err = SSL_get_error(m_SSL.get(), rc);
+					m_SendQ.GetSegments(&segment, 1);
 
-		switch (err) {
-			case SSL_ERROR_WANT_READ:
-				m_Retry = true;
-				ChangeEvents(POLLIN);
+					/* Large buffers are passed to OpenSSL as they are, small ones are
+					 * gathered so that they don't end up in separate TLS records. */
+					if (segment.Size >= BufferChain::MinBufferSize) {
+						data = segment.Data;
+						count = segment.Size;
+					} else {
+						data = buffer;
+						count = m_SendQ.Peek(buffer, SSL3_RT_MAX_PLAIN_LENGTH);
+					}
 
-				break;
-			case SSL_ERROR_WANT_WRITE:
-				m_Retry = true;
-				ChangeEvents(POLLOUT);
+					rc = SSL_write(m_SSL.get(), data, count);
+
+					if (rc > 0) {
+						m_SendQ.Drop(rc);
+						success = true;
+					}
+				} while (rc > 0 && !m_SendQ.IsEmpty());
 
 				break;
-			case SSL_ERROR_ZERO_RETURN:
-				lock.unlock();
+			case TlsActionHandshake:
+				rc = SSL_do_handshake(m_SSL.get());
 
-				Close();
+				if (rc > 0) {
+					success = true;
+					m_HandshakeOK = true;
+#ifdef I2_KTLS
+					m_KernelTls = BIO_get_ktls_send(SSL_get_wbio(m_SSL.get()));
+#endif /* I2_KTLS */
+					m_CV.notify_all();
+				}
 
-				return;
+				break;
 			default:
-				m_ErrorCode = ERR_peek_error();
-				m_ErrorOccurred = true;
-
-				if (m_ErrorCode != 0) {
-					Log(LogWarning, "TlsStream")
-						<< "OpenSSL error: " << ERR_error_string(m_ErrorCode, nullptr);
-				} else {
-					Log(LogWarning, "TlsStream", "TLS stream was disconnected.");
-				}
+				VERIFY(!"Invalid TlsAction");
+		}
+
+		int err = SSL_ERROR_NONE;
 
-				lock.unlock();
+		if (rc <= 0) {
+			err = SSL_get_error(m_SSL.get(), rc);
 
-				Close();
+			switch (err) {
+				case SSL_ERROR_WANT_READ:
+					m_Retry = true;
+					ChangeEvents(POLLIN);
 
-				return;
+					break;
+				case SSL_ERROR_WANT_WRITE:
+					m_Retry = true;
+					ChangeEvents(POLLOUT);
+
+					break;
+				case SSL_ERROR_ZERO_RETURN:
+					lock.unlock();
+
+					Close();
+
+					return;
+				default:
+					m_ErrorCode = ERR_peek_error();
+					m_ErrorOccurred = true;
+
+					if (m_ErrorCode != 0) {
+						Log(LogWarning, "TlsStream")
+							<< "OpenSSL error: " << ERR_error_string(m_ErrorCode, nullptr);
+					} else {
+						Log(LogWarning, "TlsStream", "TLS stream was disconnected.");
+					}
+
+					lock.unlock();
+
+					Close();
+
+					return;
+			}
 		}
+
+		/* The event engine might be edge-triggered and won't tell us about data which
+		 * arrived during the handshake or about the socket still being writable after
+		 * a read, so keep going until the socket would block. */
+		if (m_CurrentAction == TlsActionHandshake && m_HandshakeOK)
+			m_CurrentAction = TlsActionRead;
+		else if (m_CurrentAction == TlsActionRead && err == SSL_ERROR_WANT_READ && !m_SendQ.IsEmpty())
+			m_CurrentAction = TlsActionWrite;
+		else
+			break;
 	}
 
 	if (success) {
 		m_CurrentAction = TlsActionNone;
 
-		if (!m_Eof) {
-			if (m_SendQ->GetAvailableBytes() > 0)
-				ChangeEvents(POLLIN|POLLOUT);
-			else
-				ChangeEvents(POLLIN);
-		}
+		if (!m_Eof)
+			ChangeEvents(GetPollEvents());
+
+		/* Writers might be waiting for the send queue to drain. */
+		if (m_MaxBufferSize > 0)
+			m_CV.notify_all();
 
 		lock.unlock();
 
@@ -261,7 +334,7 @@ void TlsStream::OnEvent(int revents)
 			SignalDataAvailable();
 	}
 
-	if (m_Shutdown && !m_SendQ->IsDataAvailable()) {
+	if (m_Shutdown && m_SendQ.IsEmpty()) {
 		if (!success)
 			lock.unlock();
 
@@ -269,6 +342,57 @@ void TlsStream::OnEvent(int revents)
 	}
 }
 
+#ifdef I2_KTLS
+/**
+ * Sends the send queue with sendmsg() once the kernel has taken over
+ * the encryption. This avoids copying the buffers.
+ *
+ * @param[out] success Set to true if any data was sent.
+ * @returns false if the connection failed.
+ */
+bool TlsStream::WriteKernelTls(bool& success)
+{
+	const size_t maxSegments = 64;
+	BufferSegment segments[maxSegments];
+	iovec iov[maxSegments];
+
+	while (!m_SendQ.IsEmpty()) {
+		size_t count = m_SendQ.GetSegments(segments, maxSegments);
+
+		for (size_t i = 0; i < count; i++) {
+			iov[i].iov_base = const_cast<char *>(segments[i].Data);
+			iov[i].iov_len = segments[i].Size;
+		}
+
+		msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iov;
+		msg.msg_iovlen = count;
+
+		ssize_t rc = sendmsg(m_Socket->GetFD(), &msg, MSG_NOSIGNAL);
+
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				m_Retry = true;
+				ChangeEvents(POLLOUT);
+
+				return true;
+			}
+
+			return false;
+		}
+
+		m_SendQ.Drop(rc);
+		success = true;
+	}
+
+	return true;
+}
+#endif /* I2_KTLS */
+
 void TlsStream::HandleError() const
 {
 	if (m_ErrorOccurred) {
@@ -320,16 +444,94 @@ size_t TlsStream::Read(void *buffer, size_t count, bool allow_partial)
 
 	HandleError();
 
-	return m_RecvQ->Read(buffer, count, true);
+	size_t rc = m_RecvQ->Read(buffer, count, true);
+
+	if (m_ReadPaused && !m_Eof && m_RecvQ->GetAvailableBytes() < m_MaxBufferSize / 2) {
+		m_ReadPaused = false;
+
+		/* A pending TLS operation might still be waiting for POLLOUT. */
+		int events = GetPollEvents();
+
+		if (m_CurrentAction != TlsActionNone)
+			events |= POLLOUT;
+
+		ChangeEvents(events);
+	}
+
+	return rc;
 }
 
 void TlsStream::Write(const void *buffer, size_t count)
 {
 	boost::mutex::scoped_lock lock(m_Mutex);
 
-	m_SendQ->Write(buffer, count);
+	WaitForSendQueue(lock, count);
+
+	m_SendQ.Append(buffer, count);
+
+	ChangeEvents(GetPollEvents());
+}
+
+void TlsStream::WriteBuffers(String *buffers, size_t count)
+{
+	boost::mutex::scoped_lock lock(m_Mutex);
+
+	size_t length = 0;
+
+	for (size_t i = 0; i < count; i++)
+		length += buffers[i].GetLength();
+
+	WaitForSendQueue(lock, length);
+
+	for (size_t i = 0; i < count; i++)
+		m_SendQ.Append(std::move(buffers[i]));
+
+	ChangeEvents(GetPollEvents());
+}
+
+/**
+ * Makes sure that a slow peer doesn't make the send queue grow without bounds:
+ * Writers wait until the queue has drained far enough for their data. A single
+ * write is always accepted if the queue is empty. The I/O threads can't wait
+ * for the socket they'd have to drain themselves, so writes from them which
+ * would exceed the limit close the stream instead.
+ *
+ * @param lock The lock for m_Mutex.
+ * @param count The number of bytes which are about to be queued.
+ */
+void TlsStream::WaitForSendQueue(boost::mutex::scoped_lock& lock, size_t count)
+{
+	if (m_MaxBufferSize == 0 || m_SendQ.IsEmpty() || m_SendQ.GetAvailableBytes() + count <= m_MaxBufferSize)
+		return;
+
+	if (IsEventThread()) {
+		lock.unlock();
+
+		Close();
+
+		BOOST_THROW_EXCEPTION(std::runtime_error("The send queue exceeds the limit of "
+			+ Convert::ToString(m_MaxBufferSize) + " bytes."));
+	}
+
+	while (!m_SendQ.IsEmpty() && m_SendQ.GetAvailableBytes() + count > m_MaxBufferSize && !m_ErrorOccurred && !m_Eof)
+		m_CV.wait(lock);
+
+	HandleError();
+}
+
+/**
+ * Returns the socket events we're interested in while no TLS operation is pending.
+ *
+ * @returns The events.
+ */
+int TlsStream::GetPollEvents() const
+{
+	int events = m_ReadPaused ? 0 : POLLIN;
+
+	if (!m_SendQ.IsEmpty())
+		events |= POLLOUT;
 
-	ChangeEvents(POLLIN|POLLOUT);
+	return events;
 }
 
 void TlsStream::Shutdown()
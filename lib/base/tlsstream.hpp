@@ -26,6 +26,11 @@
 #include "base/stream.hpp"
 #include "base/tlsutility.hpp"
 #include "base/fifo.hpp"
+#include "base/bufferchain.hpp"
+
+#if defined(__linux__) && defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+#	define I2_KTLS
+#endif /* defined(__linux__) && defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS) */
 
 namespace icinga
 {
@@ -64,6 +69,7 @@ public:
 	size_t Peek(void *buffer, size_t count, bool allow_partial = false) override;
 	size_t Read(void *buffer, size_t count, bool allow_partial = false) override;
 	void Write(const void *buffer, size_t count) override;
+	void WriteBuffers(String *buffers, size_t count) override;
 
 	bool IsEof() const override;
 
@@ -87,12 +93,15 @@ private:
 	Socket::Ptr m_Socket;
 	ConnectionRole m_Role;
 
-	FIFO::Ptr m_SendQ;
+	BufferChain m_SendQ;
 	FIFO::Ptr m_RecvQ;
 
 	TlsAction m_CurrentAction;
 	bool m_Retry;
 	bool m_Shutdown;
+	bool m_KernelTls;
+	size_t m_MaxBufferSize;
+	bool m_ReadPaused;
 
 	static int m_SSLIndex;
 	static bool m_SSLIndexInitialized;
@@ -100,6 +109,12 @@ private:
 	void OnEvent(int revents) override;
 
 	void HandleError() const;
+	void WaitForSendQueue(boost::mutex::scoped_lock& lock, size_t count);
+	int GetPollEvents() const;
+
+#ifdef I2_KTLS
+	bool WriteKernelTls(bool& success);
+#endif /* I2_KTLS */
 
 	static int ValidateCertificate(int preverify_ok, X509_STORE_CTX *ctx);
 	static void NullCertificateDeleter(X509 *certificate);
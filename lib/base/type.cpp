@@ -18,13 +18,20 @@
  ******************************************************************************/
 
 #include "base/type.hpp"
+#include "base/internedstring.hpp"
 #include "base/scriptglobal.hpp"
 #include "base/objectlock.hpp"
+#include <memory>
 
 using namespace icinga;
 
 Type::Ptr Type::TypeInstance;
 
+struct Type::FieldNameTable : std::vector<std::pair<InternedString, int> >
+{
+	using std::vector<std::pair<InternedString, int> >::vector;
+};
+
 INITIALIZE_ONCE_WITH_PRIORITY([]() {
 	Type::Ptr type = new TypeType();
 	type->SetPrototype(TypeType::GetPrototype());
@@ -32,6 +39,11 @@ INITIALIZE_ONCE_WITH_PRIORITY([]() {
 	Type::Register(type);
 }, 20);
 
+Type::~Type()
+{
+	delete m_FieldNames.load();
+}
+
 String Type::ToString() const
 {
 	return "type '" + GetName() + "'";
@@ -77,6 +89,61 @@ std::vector<Type::Ptr> Type::GetAllTypes()
 	return types;
 }
 
+/**
+ * Looks up a field by its name. Unlike the GetFieldId() overload for plain
+ * strings this compares the name's string table entry with the field names
+ * rather than the name itself.
+ *
+ * @param name The field name.
+ * @returns The field ID or -1 if there is no such field.
+ */
+int Type::GetFieldId(const InternedString& name) const
+{
+	FieldNameTable *table = GetFieldNameTable();
+
+	size_t mask = table->size() - 1;
+
+	for (size_t index = name.GetHash() & mask; (*table)[index].second != -1; index = (index + 1) & mask) {
+		if ((*table)[index].first == name)
+			return (*table)[index].second;
+	}
+
+	return -1;
+}
+
+Type::FieldNameTable *Type::GetFieldNameTable() const
+{
+	FieldNameTable *table = m_FieldNames.load(std::memory_order_acquire);
+
+	if (table)
+		return table;
+
+	int count = GetFieldCount();
+	size_t size = 16;
+
+	while (size < static_cast<size_t>(count) * 2)
+		size *= 2;
+
+	std::unique_ptr<FieldNameTable> newTable(new FieldNameTable(size, std::make_pair(InternedString(), -1)));
+	size_t mask = size - 1;
+
+	for (int i = 0; i < count; i++) {
+		InternedString fieldName(GetFieldInfo(i).Name, true);
+		size_t index = fieldName.GetHash() & mask;
+
+		/* Fields of derived types hide fields of their base types. */
+		while ((*newTable)[index].second != -1 && (*newTable)[index].first != fieldName)
+			index = (index + 1) & mask;
+
+		(*newTable)[index] = std::make_pair(fieldName, i);
+	}
+
+	if (m_FieldNames.compare_exchange_strong(table, newTable.get()))
+		return newTable.release();
+
+	return table;
+}
+
 String Type::GetPluralName() const
 {
 	String name = GetName();
@@ -24,11 +24,14 @@
 #include "base/string.hpp"
 #include "base/object.hpp"
 #include "base/initialize.hpp"
+#include <atomic>
 #include <vector>
 
 namespace icinga
 {
 
+class InternedString;
+
 /* keep this in sync with tools/mkclass/classcompiler.hpp */
 enum FieldAttribute
 {
@@ -75,6 +78,8 @@ class Type : public Object
 public:
 	DECLARE_OBJECT(Type);
 
+	~Type() override;
+
 	String ToString() const override;
 
 	virtual String GetName() const = 0;
@@ -84,6 +89,8 @@ public:
 	virtual Field GetFieldInfo(int id) const = 0;
 	virtual int GetFieldCount() const = 0;
 
+	int GetFieldId(const InternedString& name) const;
+
 	String GetPluralName() const;
 
 	Object::Ptr Instantiate(const std::vector<Value>& args) const;
@@ -111,7 +118,12 @@ protected:
 	virtual ObjectFactory GetFactory() const = 0;
 
 private:
+	struct FieldNameTable;
+
 	Object::Ptr m_Prototype;
+	mutable std::atomic<FieldNameTable *> m_FieldNames{nullptr};
+
+	FieldNameTable *GetFieldNameTable() const;
 };
 
 class TypeType final : public Type
@@ -24,187 +24,87 @@
 
 using namespace icinga;
 
-template class boost::variant<boost::blank, double, bool, String, Object::Ptr>;
-template const double& Value::Get<double>() const;
-template const bool& Value::Get<bool>() const;
-template const String& Value::Get<String>() const;
-template const Object::Ptr& Value::Get<Object::Ptr>() const;
-
 Value icinga::Empty;
 
 Value::Value(std::nullptr_t)
+	: m_Type(ValueEmpty)
 { }
 
 Value::Value(int value)
-	: m_Value(double(value))
+	: m_Number(value), m_Type(ValueNumber)
 { }
 
 Value::Value(unsigned int value)
-	: m_Value(double(value))
+	: m_Number(value), m_Type(ValueNumber)
 { }
 
 Value::Value(long value)
-	: m_Value(double(value))
+	: m_Number(value), m_Type(ValueNumber)
 { }
 
 Value::Value(unsigned long value)
-	: m_Value(double(value))
+	: m_Number(value), m_Type(ValueNumber)
 { }
 
 Value::Value(long long value)
-	: m_Value(double(value))
+	: m_Number(value), m_Type(ValueNumber)
 { }
 
 Value::Value(unsigned long long value)
-	: m_Value(double(value))
+	: m_Number(value), m_Type(ValueNumber)
 { }
 
 Value::Value(double value)
-	: m_Value(value)
+	: m_Number(value), m_Type(ValueNumber)
 { }
 
 Value::Value(bool value)
-	: m_Value(value)
+	: m_Boolean(value), m_Type(ValueBoolean)
 { }
 
 Value::Value(const String& value)
-	: m_Value(value)
+	: m_String(new SharedString(value)), m_Type(ValueString)
 { }
 
 Value::Value(String&& value)
-	: m_Value(value)
+	: m_String(new SharedString(std::move(value))), m_Type(ValueString)
 { }
 
 Value::Value(const char *value)
-	: m_Value(String(value))
-{ }
-
-Value::Value(const Value& other)
-	: m_Value(other.m_Value)
+	: m_String(new SharedString(String(value))), m_Type(ValueString)
 { }
 
-Value::Value(Value&& other)
-{
-#if BOOST_VERSION >= 105400
-	m_Value = std::move(other.m_Value);
-#else /* BOOST_VERSION */
-	m_Value.swap(other.m_Value);
-#endif /* BOOST_VERSION */
-}
-
 Value::Value(Object *value)
 	: Value(Object::Ptr(value))
 { }
 
 Value::Value(const intrusive_ptr<Object>& value)
+	: m_Type(ValueEmpty)
 {
-	if (value)
-		m_Value = value;
-}
-
-Value& Value::operator=(const Value& other)
-{
-	m_Value = other.m_Value;
-	return *this;
-}
-
-Value& Value::operator=(Value&& other)
-{
-#if BOOST_VERSION >= 105400
-	m_Value = std::move(other.m_Value);
-#else /* BOOST_VERSION */
-	m_Value.swap(other.m_Value);
-#endif /* BOOST_VERSION */
-
-	return *this;
-}
-
-/**
- * Checks whether the variant is empty.
- *
- * @returns true if the variant is empty, false otherwise.
- */
-bool Value::IsEmpty() const
-{
-	return (GetType() == ValueEmpty || (IsString() && boost::get<String>(m_Value).IsEmpty()));
-}
-
-/**
- * Checks whether the variant is scalar (i.e. not an object and not empty).
- *
- * @returns true if the variant is scalar, false otherwise.
- */
-bool Value::IsScalar() const
-{
-	return !IsEmpty() && !IsObject();
-}
-
-/**
-* Checks whether the variant is a number.
-*
-* @returns true if the variant is a number.
-*/
-bool Value::IsNumber() const
-{
-	return (GetType() == ValueNumber);
-}
-
-/**
- * Checks whether the variant is a boolean.
- *
- * @returns true if the variant is a boolean.
- */
-bool Value::IsBoolean() const
-{
-	return (GetType() == ValueBoolean);
-}
-
-/**
- * Checks whether the variant is a string.
- *
- * @returns true if the variant is a string.
- */
-bool Value::IsString() const
-{
-	return (GetType() == ValueString);
-}
-
-/**
- * Checks whether the variant is a non-null object.
- *
- * @returns true if the variant is a non-null object, false otherwise.
- */
-bool Value::IsObject() const
-{
-	return  (GetType() == ValueObject);
-}
-
-/**
- * Returns the type of the value.
- *
- * @returns The type.
- */
-ValueType Value::GetType() const
-{
-	return static_cast<ValueType>(m_Value.which());
+	if (value) {
+		new (&m_Object) Object::Ptr(value);
+		m_Type = ValueObject;
+	}
 }
 
 void Value::Swap(Value& other)
 {
-	m_Value.swap(other.m_Value);
+	Value tmp(std::move(other));
+	other = std::move(*this);
+	*this = std::move(tmp);
 }
 
 bool Value::ToBool() const
 {
 	switch (GetType()) {
 		case ValueNumber:
-			return static_cast<bool>(boost::get<double>(m_Value));
+			return static_cast<bool>(m_Number);
 
 		case ValueBoolean:
-			return boost::get<bool>(m_Value);
+			return m_Boolean;
 
 		case ValueString:
-			return !boost::get<String>(m_Value).IsEmpty();
+			return !m_String->Str.IsEmpty();
 
 		case ValueObject:
 			if (IsObjectType<Dictionary>()) {
@@ -239,7 +139,7 @@ String Value::GetTypeName() const
 		case ValueString:
 			return "String";
 		case ValueObject:
-			t = boost::get<Object::Ptr>(m_Value)->GetReflectionType();
+			t = m_Object->GetReflectionType();
 			if (!t) {
 				if (IsObjectType<Array>())
 					return "Array";
@@ -266,7 +166,7 @@ Type::Ptr Value::GetReflectionType() const
 		case ValueString:
 			return Type::GetByName("String");
 		case ValueObject:
-			return boost::get<Object::Ptr>(m_Value)->GetReflectionType();
+			return m_Object->GetReflectionType();
 		default:
 			return nullptr;
 	}
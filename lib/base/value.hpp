@@ -22,8 +22,8 @@
 
 #include "base/object.hpp"
 #include "base/string.hpp"
-#include <boost/variant/variant.hpp>
-#include <boost/variant/get.hpp>
+#include <atomic>
+#include <typeinfo>
 
 namespace icinga
 {
@@ -44,15 +44,40 @@ enum ValueType
 	ValueObject = 4
 };
 
+/**
+ * A reference-counted string. Copies of a string value share it.
+ *
+ * @ingroup base
+ */
+struct SharedString
+{
+	std::atomic<int> References;
+	String Str;
+
+	SharedString(const String& str)
+		: References(1), Str(str)
+	{ }
+
+	SharedString(String&& str)
+		: References(1), Str(std::move(str))
+	{ }
+};
+
 /**
  * A type that can hold an arbitrary value.
  *
+ * Values are 16 bytes: the number, boolean, string or object and the
+ * value's type. Strings are shared between copies of a value.
+ *
  * @ingroup base
  */
 class Value
 {
 public:
-	Value() = default;
+	Value()
+		: m_Type(ValueEmpty)
+	{ }
+
 	Value(std::nullptr_t);
 	Value(int value);
 	Value(unsigned int value);
@@ -65,11 +90,24 @@ public:
 	Value(const String& value);
 	Value(String&& value);
 	Value(const char *value);
-	Value(const Value& other);
-	Value(Value&& other);
 	Value(Object *value);
 	Value(const intrusive_ptr<Object>& value);
 
+	Value(const Value& other)
+	{
+		CopyFrom(other);
+	}
+
+	Value(Value&& other)
+	{
+		MoveFrom(std::move(other));
+	}
+
+	~Value()
+	{
+		Destroy();
+	}
+
 	template<typename T>
 	Value(const intrusive_ptr<T>& value)
 		: Value(static_pointer_cast<Object>(value))
@@ -82,8 +120,25 @@ public:
 	operator double() const;
 	operator String() const;
 
-	Value& operator=(const Value& other);
-	Value& operator=(Value&& other);
+	Value& operator=(const Value& other)
+	{
+		if (this != &other) {
+			Destroy();
+			CopyFrom(other);
+		}
+
+		return *this;
+	}
+
+	Value& operator=(Value&& other)
+	{
+		if (this != &other) {
+			Destroy();
+			MoveFrom(std::move(other));
+		}
+
+		return *this;
+	}
 
 	bool operator==(bool rhs) const;
 	bool operator!=(bool rhs) const;
@@ -124,12 +179,35 @@ public:
 		return tobject;
 	}
 
-	bool IsEmpty() const;
-	bool IsScalar() const;
-	bool IsNumber() const;
-	bool IsBoolean() const;
-	bool IsString() const;
-	bool IsObject() const;
+	bool IsEmpty() const
+	{
+		return m_Type == ValueEmpty || (m_Type == ValueString && m_String->Str.IsEmpty());
+	}
+
+	bool IsScalar() const
+	{
+		return !IsEmpty() && !IsObject();
+	}
+
+	bool IsNumber() const
+	{
+		return m_Type == ValueNumber;
+	}
+
+	bool IsBoolean() const
+	{
+		return m_Type == ValueBoolean;
+	}
+
+	bool IsString() const
+	{
+		return m_Type == ValueString;
+	}
+
+	bool IsObject() const
+	{
+		return m_Type == ValueObject;
+	}
 
 	template<typename T>
 	bool IsObjectType() const
@@ -140,7 +218,10 @@ public:
 		return dynamic_cast<T *>(Get<Object::Ptr>().get());
 	}
 
-	ValueType GetType() const;
+	ValueType GetType() const
+	{
+		return m_Type;
+	}
 
 	void Swap(Value& other);
 
@@ -151,19 +232,117 @@ public:
 	Value Clone() const;
 
 	template<typename T>
-	const T& Get() const
+	const T& Get() const;
+
+private:
+	union {
+		double m_Number;
+		bool m_Boolean;
+		SharedString *m_String;
+		Object::Ptr m_Object;
+	};
+
+	ValueType m_Type;
+
+	void CopyFrom(const Value& other)
 	{
-		return boost::get<T>(m_Value);
+		switch (other.m_Type) {
+			case ValueNumber:
+				m_Number = other.m_Number;
+				break;
+			case ValueBoolean:
+				m_Boolean = other.m_Boolean;
+				break;
+			case ValueString:
+				m_String = other.m_String;
+				m_String->References.fetch_add(1, std::memory_order_relaxed);
+				break;
+			case ValueObject:
+				new (&m_Object) Object::Ptr(other.m_Object);
+				break;
+			default:
+				break;
+		}
+
+		m_Type = other.m_Type;
 	}
 
-private:
-	boost::variant<boost::blank, double, bool, String, Object::Ptr> m_Value;
+	void MoveFrom(Value&& other)
+	{
+		switch (other.m_Type) {
+			case ValueNumber:
+				m_Number = other.m_Number;
+				break;
+			case ValueBoolean:
+				m_Boolean = other.m_Boolean;
+				break;
+			case ValueString:
+				m_String = other.m_String;
+				break;
+			case ValueObject:
+				new (&m_Object) Object::Ptr(std::move(other.m_Object));
+				other.m_Object.~intrusive_ptr();
+				break;
+			default:
+				break;
+		}
+
+		m_Type = other.m_Type;
+		other.m_Type = ValueEmpty;
+	}
+
+	void Destroy()
+	{
+		if (m_Type == ValueString) {
+			if (m_String->References.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				delete m_String;
+		} else if (m_Type == ValueObject)
+			m_Object.~intrusive_ptr();
+
+		m_Type = ValueEmpty;
+	}
+
+	[[noreturn]] static void ThrowBadGet()
+	{
+		BOOST_THROW_EXCEPTION(std::bad_cast());
+	}
 };
 
-extern template const double& Value::Get<double>() const;
-extern template const bool& Value::Get<bool>() const;
-extern template const String& Value::Get<String>() const;
-extern template const Object::Ptr& Value::Get<Object::Ptr>() const;
+template<>
+inline const double& Value::Get<double>() const
+{
+	if (m_Type != ValueNumber)
+		ThrowBadGet();
+
+	return m_Number;
+}
+
+template<>
+inline const bool& Value::Get<bool>() const
+{
+	if (m_Type != ValueBoolean)
+		ThrowBadGet();
+
+	return m_Boolean;
+}
+
+template<>
+inline const String& Value::Get<String>() const
+{
+	if (m_Type != ValueString)
+		ThrowBadGet();
+
+	return m_String->Str;
+}
+
+template<>
+inline const Object::Ptr& Value::Get<Object::Ptr>() const
+{
+	if (m_Type != ValueObject)
+		ThrowBadGet();
+
+	return m_Object;
+}
 
 extern Value Empty;
 
@@ -262,6 +441,4 @@ std::istream& operator>>(std::istream& stream, Value& value);
 
 }
 
-extern template class boost::variant<boost::blank, double, bool, icinga::String, icinga::Object::Ptr>;
-
 #endif /* VALUE_H */
@@ -65,33 +65,18 @@ boost::mutex::scoped_lock WorkQueue::AcquireLock()
 	return boost::mutex::scoped_lock(m_Mutex);
 }
 
+WorkQueue::TaskQueue::~TaskQueue()
+{
+	delete Ring.load();
+}
+
 /**
  * Enqueues a task. Tasks are guaranteed to be executed in the order
  * they were enqueued in except if there is more than one worker thread.
  */
-void WorkQueue::EnqueueUnlocked(boost::mutex::scoped_lock& lock, std::function<void ()>&& function, WorkQueuePriority priority)
+void WorkQueue::EnqueueUnlocked(boost::mutex::scoped_lock& lock, TaskFunction&& function, WorkQueuePriority priority)
 {
-	if (!m_Spawned) {
-		Log(LogNotice, "WorkQueue")
-			<< "Spawning WorkQueue threads for '" << m_Name << "'";
-
-		for (int i = 0; i < m_ThreadCount; i++) {
-			m_Threads.create_thread(std::bind(&WorkQueue::WorkerThreadProc, this));
-		}
-
-		m_Spawned = true;
-	}
-
-	bool wq_thread = IsWorkerThread();
-
-	if (!wq_thread) {
-		while (m_Tasks.size() >= m_MaxItems && m_MaxItems != 0)
-			m_CVFull.wait(lock);
-	}
-
-	m_Tasks.emplace(std::move(function), priority, ++m_NextTaskID);
-
-	m_CVEmpty.notify_one();
+	Push(lock, std::move(function), priority);
 }
 
 /**
@@ -100,7 +85,7 @@ void WorkQueue::EnqueueUnlocked(boost::mutex::scoped_lock& lock, std::function<v
  * allowInterleaved is true in which case the new task might be run
  * immediately if it's being enqueued from within the WorkQueue thread.
  */
-void WorkQueue::Enqueue(std::function<void ()>&& function, WorkQueuePriority priority,
+void WorkQueue::Enqueue(TaskFunction&& function, WorkQueuePriority priority,
 	bool allowInterleaved)
 {
 	bool wq_thread = IsWorkerThread();
@@ -111,8 +96,125 @@ void WorkQueue::Enqueue(std::function<void ()>&& function, WorkQueuePriority pri
 		return;
 	}
 
-	auto lock = AcquireLock();
-	EnqueueUnlocked(lock, std::move(function), priority);
+	boost::mutex::scoped_lock lock(m_Mutex, boost::defer_lock);
+	Push(lock, std::move(function), priority);
+}
+
+/**
+ * Adds a task to the queue for the specified priority. m_Mutex is only
+ * acquired when the worker threads need to be spawned or woken up or
+ * when the queue is full. The lock is not released again if it was
+ * acquired by this method.
+ */
+void WorkQueue::Push(boost::mutex::scoped_lock& lock, TaskFunction&& function, WorkQueuePriority priority)
+{
+	if (!m_Spawned.load(std::memory_order_acquire)) {
+		if (!lock.owns_lock())
+			lock.lock();
+
+		if (!m_Spawned) {
+			Log(LogNotice, "WorkQueue")
+				<< "Spawning WorkQueue threads for '" << m_Name << "'";
+
+			for (int i = 0; i < m_ThreadCount; i++) {
+				m_Threads.create_thread(std::bind(&WorkQueue::WorkerThreadProc, this));
+			}
+
+			m_Spawned = true;
+		}
+	}
+
+	if (m_MaxItems != 0 && m_Length >= m_MaxItems && !IsWorkerThread()) {
+		if (!lock.owns_lock())
+			lock.lock();
+
+		m_FullWaiters++;
+
+		while (m_Length >= m_MaxItems)
+			m_CVFull.wait(lock);
+
+		m_FullWaiters--;
+	}
+
+	TaskQueue& queue = m_Tasks[priority];
+
+	MpmcRing<TaskFunction> *ring = queue.Ring.load(std::memory_order_acquire);
+
+	if (!ring) {
+		size_t capacity = 1024;
+
+		if (m_MaxItems != 0 && m_MaxItems < capacity)
+			capacity = m_MaxItems;
+
+		auto *newRing = new MpmcRing<TaskFunction>(capacity);
+
+		if (queue.Ring.compare_exchange_strong(ring, newRing))
+			ring = newRing;
+		else
+			delete newRing;
+	}
+
+	/* Workers take tasks from the ring buffer before they look at the
+	 * overflow queue. Once there are tasks in the overflow queue new
+	 * tasks have to go there as well in order to keep them in order. */
+	m_Length++;
+	m_Queued++;
+
+	if (queue.OverflowCount != 0 || !ring->TryPush(function)) {
+		boost::mutex::scoped_lock olock(queue.OverflowMutex);
+
+		if (queue.OverflowCount != 0 || !ring->TryPush(function)) {
+			queue.Overflow.emplace_back(std::move(function));
+			queue.OverflowCount++;
+		}
+	}
+
+	if (m_SleepingWorkers > 0) {
+		if (!lock.owns_lock())
+			lock.lock();
+
+		m_CVEmpty.notify_one();
+	}
+}
+
+/**
+ * Removes the next task from the queues, taking priorities into account.
+ *
+ * @returns true if a task was found, false otherwise.
+ */
+bool WorkQueue::Pop(TaskFunction& function)
+{
+	for (int priority = PriorityHigh; priority >= PriorityLow; priority--) {
+		TaskQueue& queue = m_Tasks[priority];
+
+		MpmcRing<TaskFunction> *ring = queue.Ring.load(std::memory_order_acquire);
+
+		if (ring && ring->TryPop(function)) {
+			m_Queued--;
+			return true;
+		}
+
+		if (queue.OverflowCount != 0) {
+			boost::mutex::scoped_lock olock(queue.OverflowMutex);
+
+			/* The ring buffer might have received tasks in the meantime
+			 * which are older than the ones in the overflow queue. */
+			if (ring->TryPop(function)) {
+				m_Queued--;
+				return true;
+			}
+
+			if (!queue.Overflow.empty()) {
+				function = std::move(queue.Overflow.front());
+				queue.Overflow.pop_front();
+				queue.OverflowCount--;
+				m_Queued--;
+				return true;
+			}
+		}
+	}
+
+	return false;
 }
 
 /**
@@ -125,9 +227,13 @@ void WorkQueue::Join(bool stop)
 {
 	boost::mutex::scoped_lock lock(m_Mutex);
 
-	while (m_Processing || !m_Tasks.empty())
+	m_StarvedWaiters++;
+
+	while (m_Processing || m_Length)
 		m_CVStarved.wait(lock);
 
+	m_StarvedWaiters--;
+
 	if (stop) {
 		m_Stopped = true;
 		m_CVEmpty.notify_all();
@@ -200,9 +306,7 @@ void WorkQueue::ReportExceptions(const String& facility) const
 
 size_t WorkQueue::GetLength() const
 {
-	boost::mutex::scoped_lock lock(m_Mutex);
-
-	return m_Tasks.size();
+	return m_Length;
 }
 
 void WorkQueue::StatusTimerHandler()
@@ -211,7 +315,7 @@ void WorkQueue::StatusTimerHandler()
 
 	ASSERT(!m_Name.IsEmpty());
 
-	size_t pending = m_Tasks.size();
+	size_t pending = m_Length;
 
 	double now = Utility::GetTime();
 	double gradient = (pending - m_PendingTasks) / (now - m_PendingTasksTimestamp);
@@ -273,62 +377,86 @@ void WorkQueue::WorkerThreadProc()
 
 	l_ThreadWorkQueue.reset(new WorkQueue *(this));
 
-	boost::mutex::scoped_lock lock(m_Mutex);
+	std::vector<TaskFunction> batch;
+	batch.reserve(32);
 
 	for (;;) {
-		while (m_Tasks.empty() && !m_Stopped)
-			m_CVEmpty.wait(lock);
-
 		if (m_Stopped)
 			break;
 
-		if (m_Tasks.size() >= m_MaxItems && m_MaxItems != 0)
-			m_CVFull.notify_all();
+		/* m_Processing must be increased before the tasks are removed
+		 * from m_Length, otherwise Join() might return too early. */
+		m_Processing++;
 
-		Task task = m_Tasks.top();
-		m_Tasks.pop();
+		/* Leave some of the tasks for the other worker threads. */
+		size_t batchSize = std::min<size_t>(32, m_Queued / m_ThreadCount + 1);
 
-		m_Processing++;
+		TaskFunction task;
 
-		lock.unlock();
+		while (batch.size() < batchSize && Pop(task))
+			batch.emplace_back(std::move(task));
+
+		if (batch.empty()) {
+			m_Processing--;
+
+			if (m_StarvedWaiters > 0) {
+				boost::mutex::scoped_lock lock(m_Mutex);
+				m_CVStarved.notify_all();
+			}
+
+			/* A producer has increased m_Queued but hasn't pushed the task yet. */
+			if (m_Queued > 0) {
+				boost::this_thread::yield();
+				continue;
+			}
+
+			m_SleepingWorkers++;
+
+			{
+				boost::mutex::scoped_lock lock(m_Mutex);
 
-		RunTaskFunction(task.Function);
+				while (m_Queued == 0 && !m_Stopped)
+					m_CVEmpty.wait(lock);
+			}
 
-		/* clear the task so whatever other resources it holds are released _before_ we re-acquire the mutex */
-		task = Task();
+			m_SleepingWorkers--;
 
-		IncreaseTaskCount();
+			continue;
+		}
+
+		for (TaskFunction& function : batch) {
+			m_Length--;
+
+			if (m_FullWaiters > 0) {
+				boost::mutex::scoped_lock lock(m_Mutex);
+				m_CVFull.notify_all();
+			}
+
+			RunTaskFunction(function);
+
+			/* clear the task so whatever other resources it holds are released _before_ we run the next one */
+			function.Reset();
+		}
 
-		lock.lock();
+		IncreaseTaskCount(batch.size());
+
+		batch.clear();
 
 		m_Processing--;
 
-		if (m_Tasks.empty())
+		if (m_Length == 0 && m_Processing == 0 && m_StarvedWaiters > 0) {
+			boost::mutex::scoped_lock lock(m_Mutex);
 			m_CVStarved.notify_all();
+		}
 	}
 }
 
-void WorkQueue::IncreaseTaskCount()
+void WorkQueue::IncreaseTaskCount(size_t count)
 {
-	m_TaskStats.InsertValue(Utility::GetTime(), 1);
+	m_TaskStats.InsertValue(Utility::GetTime(), count);
 }
 
 size_t WorkQueue::GetTaskCount(RingBuffer::SizeType span)
 {
 	return m_TaskStats.UpdateAndGetValues(Utility::GetTime(), span);
 }
-
-bool icinga::operator<(const Task& a, const Task& b)
-{
-	if (a.Priority < b.Priority)
-		return true;
-
-	if (a.Priority == b.Priority) {
-		if (a.ID > b.ID)
-			return true;
-		else
-			return false;
-	}
-
-	return false;
-}
@@ -23,13 +23,14 @@
 #include "base/i2-base.hpp"
 #include "base/timer.hpp"
 #include "base/ringbuffer.hpp"
+#include "base/mpmcring.hpp"
 #include <boost/thread/thread.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/condition_variable.hpp>
 #include <boost/exception_ptr.hpp>
-#include <queue>
 #include <deque>
 #include <atomic>
+#include <type_traits>
 
 namespace icinga
 {
@@ -41,26 +42,172 @@ enum WorkQueuePriority
 	PriorityHigh
 };
 
-using TaskFunction = std::function<void ()>;
-
-struct Task
+/**
+ * A move-only function object for work queue tasks. Callables which
+ * are small enough are stored inline rather than on the heap.
+ *
+ * @ingroup base
+ */
+class TaskFunction
 {
-	Task() = default;
+public:
+	TaskFunction() = default;
+
+	template<typename F, typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, TaskFunction>::value>::type>
+	TaskFunction(F&& func)
+	{
+		typedef typename std::decay<F>::type FuncType;
+
+		Construct<FuncType>(std::forward<F>(func), std::integral_constant<bool,
+		    sizeof(FuncType) <= sizeof(Storage) && alignof(FuncType) <= alignof(Storage) &&
+		    std::is_nothrow_move_constructible<FuncType>::value>());
+	}
+
+	TaskFunction(TaskFunction&& other) noexcept
+	{
+		MoveFrom(other);
+	}
+
+	TaskFunction& operator=(TaskFunction&& other) noexcept
+	{
+		if (this != &other) {
+			Reset();
+			MoveFrom(other);
+		}
+
+		return *this;
+	}
 
-	Task(TaskFunction function, WorkQueuePriority priority, int id)
-		: Function(std::move(function)), Priority(priority), ID(id)
-	{ }
+	TaskFunction(const TaskFunction&) = delete;
+	TaskFunction& operator=(const TaskFunction&) = delete;
+
+	~TaskFunction()
+	{
+		Reset();
+	}
+
+	void operator()() const
+	{
+		if (!m_Ops)
+			BOOST_THROW_EXCEPTION(std::bad_function_call());
+
+		m_Ops->Invoke(const_cast<Storage *>(&m_Storage));
+	}
+
+	explicit operator bool() const
+	{
+		return m_Ops != nullptr;
+	}
+
+	void Reset()
+	{
+		if (m_Ops) {
+			m_Ops->Destroy(&m_Storage);
+			m_Ops = nullptr;
+		}
+	}
+
+private:
+	typedef std::aligned_storage<48, alignof(std::max_align_t)>::type Storage;
+
+	struct FunctionOps
+	{
+		void (*Invoke)(void *storage);
+		void (*Move)(void *from, void *to);
+		void (*Destroy)(void *storage);
+	};
 
-	TaskFunction Function;
-	WorkQueuePriority Priority{PriorityNormal};
-	int ID{-1};
+	template<typename FuncType>
+	struct InlineOps
+	{
+		static void Invoke(void *storage)
+		{
+			(*static_cast<FuncType *>(storage))();
+		}
+
+		static void Move(void *from, void *to)
+		{
+			new (to) FuncType(std::move(*static_cast<FuncType *>(from)));
+			static_cast<FuncType *>(from)->~FuncType();
+		}
+
+		static void Destroy(void *storage)
+		{
+			static_cast<FuncType *>(storage)->~FuncType();
+		}
+
+		static const FunctionOps Ops;
+	};
+
+	template<typename FuncType>
+	struct HeapOps
+	{
+		static void Invoke(void *storage)
+		{
+			(**static_cast<FuncType **>(storage))();
+		}
+
+		static void Move(void *from, void *to)
+		{
+			*static_cast<FuncType **>(to) = *static_cast<FuncType **>(from);
+		}
+
+		static void Destroy(void *storage)
+		{
+			delete *static_cast<FuncType **>(storage);
+		}
+
+		static const FunctionOps Ops;
+	};
+
+	const FunctionOps *m_Ops{nullptr};
+	Storage m_Storage;
+
+	template<typename FuncType, typename F>
+	void Construct(F&& func, std::true_type)
+	{
+		new (&m_Storage) FuncType(std::forward<F>(func));
+		m_Ops = &InlineOps<FuncType>::Ops;
+	}
+
+	template<typename FuncType, typename F>
+	void Construct(F&& func, std::false_type)
+	{
+		*reinterpret_cast<FuncType **>(&m_Storage) = new FuncType(std::forward<F>(func));
+		m_Ops = &HeapOps<FuncType>::Ops;
+	}
+
+	void MoveFrom(TaskFunction& other)
+	{
+		if (other.m_Ops) {
+			other.m_Ops->Move(&other.m_Storage, &m_Storage);
+			m_Ops = other.m_Ops;
+			other.m_Ops = nullptr;
+		}
+	}
 };
 
-bool operator<(const Task& a, const Task& b);
+template<typename FuncType>
+const TaskFunction::FunctionOps TaskFunction::InlineOps<FuncType>::Ops = {
+	&TaskFunction::InlineOps<FuncType>::Invoke,
+	&TaskFunction::InlineOps<FuncType>::Move,
+	&TaskFunction::InlineOps<FuncType>::Destroy
+};
+
+template<typename FuncType>
+const TaskFunction::FunctionOps TaskFunction::HeapOps<FuncType>::Ops = {
+	&TaskFunction::HeapOps<FuncType>::Invoke,
+	&TaskFunction::HeapOps<FuncType>::Move,
+	&TaskFunction::HeapOps<FuncType>::Destroy
+};
 
 /**
  * A workqueue.
  *
+ * Tasks are stored in one lock-free ring buffer per priority. Tasks
+ * which don't fit into the ring buffer are moved to an overflow queue.
+ * Worker threads dequeue tasks in batches.
+ *
  * @ingroup base
  */
 class WorkQueue
@@ -122,14 +269,25 @@ public:
 	void ReportExceptions(const String& facility) const;
 
 protected:
-	void IncreaseTaskCount();
+	void IncreaseTaskCount(size_t count = 1);
 
 private:
+	struct TaskQueue
+	{
+		std::atomic<MpmcRing<TaskFunction> *> Ring{nullptr};
+
+		boost::mutex OverflowMutex;
+		std::deque<TaskFunction> Overflow;
+		std::atomic<size_t> OverflowCount{0};
+
+		~TaskQueue();
+	};
+
 	int m_ID;
 	String m_Name;
 	static std::atomic<int> m_NextID;
 	int m_ThreadCount;
-	bool m_Spawned{false};
+	std::atomic<bool> m_Spawned{false};
 
 	mutable boost::mutex m_Mutex;
 	boost::condition_variable m_CVEmpty;
@@ -137,10 +295,14 @@ private:
 	boost::condition_variable m_CVStarved;
 	boost::thread_group m_Threads;
 	size_t m_MaxItems;
-	bool m_Stopped{false};
-	int m_Processing{0};
-	std::priority_queue<Task, std::deque<Task> > m_Tasks;
-	int m_NextTaskID{0};
+	std::atomic<bool> m_Stopped{false};
+	std::atomic<int> m_Processing{0};
+	TaskQueue m_Tasks[PriorityHigh + 1];
+	std::atomic<size_t> m_Length{0}; /* tasks which haven't been started yet */
+	std::atomic<size_t> m_Queued{0}; /* tasks which haven't been dequeued yet */
+	std::atomic<int> m_SleepingWorkers{0};
+	std::atomic<int> m_FullWaiters{0};
+	std::atomic<int> m_StarvedWaiters{0};
 	ExceptionCallback m_ExceptionCallback;
 	std::vector<boost::exception_ptr> m_Exceptions;
 	Timer::Ptr m_StatusTimer;
@@ -150,6 +312,9 @@ private:
 	size_t m_PendingTasks{0};
 	double m_PendingTasksTimestamp{0};
 
+	void Push(boost::mutex::scoped_lock& lock, TaskFunction&& function, WorkQueuePriority priority);
+	bool Pop(TaskFunction& function);
+
 	void WorkerThreadProc();
 	void StatusTimerHandler();
 
@@ -0,0 +1,146 @@
+/******************************************************************************
+ * Icinga 2                                                                   *
+ * Copyright (C) 2012-2018 Icinga Development Team (https://www.icinga.com/)  *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or              *
+ * modify it under the terms of the GNU General Public License                *
+ * as published by the Free Software Foundation; either version 2             *
+ * of the License, or (at your option) any later version.                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software Foundation     *
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
+ ******************************************************************************/
+
+#ifndef WORKSTEALINGDEQUE_H
+#define WORKSTEALINGDEQUE_H
+
+#include "base/i2-base.hpp"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace icinga
+{
+
+/**
+ * A Chase-Lev work-stealing deque of pointers. Only the owner thread may
+ * push items; any thread (including the owner) may take items from the
+ * other end with Steal(), i.e. items are taken in FIFO order.
+ *
+ * The deque grows as needed. Old buffers are kept until the deque is
+ * destroyed because concurrent thieves might still read from them.
+ *
+ * @ingroup base
+ */
+template<typename T>
+class WorkStealingDeque
+{
+public:
+	WorkStealingDeque(size_t capacity = 256)
+	{
+		m_Buffers.emplace_back(new Buffer(capacity));
+		m_Buffer.store(m_Buffers.back().get(), std::memory_order_relaxed);
+	}
+
+	WorkStealingDeque(const WorkStealingDeque&) = delete;
+	WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+	/**
+	 * Adds an item. Must only be called by the owner thread.
+	 *
+	 * @param item The item.
+	 */
+	void Push(T *item)
+	{
+		long bottom = m_Bottom.load(std::memory_order_relaxed);
+		long top = m_Top.load(std::memory_order_acquire);
+		Buffer *buffer = m_Buffer.load(std::memory_order_relaxed);
+
+		if (bottom - top > static_cast<long>(buffer->Capacity) - 1)
+			buffer = Grow(buffer, bottom, top);
+
+		buffer->Put(bottom, item);
+		std::atomic_thread_fence(std::memory_order_release);
+		m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+	}
+
+	/**
+	 * Takes the oldest item.
+	 *
+	 * @param[out] item The item.
+	 * @returns false if the deque was empty, true otherwise. *item is
+	 *          nullptr if another thread took the item first.
+	 */
+	bool Steal(T **item)
+	{
+		long top = m_Top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		long bottom = m_Bottom.load(std::memory_order_acquire);
+
+		if (top >= bottom)
+			return false;
+
+		Buffer *buffer = m_Buffer.load(std::memory_order_acquire);
+		T *result = buffer->Get(top);
+
+		if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			result = nullptr;
+
+		*item = result;
+		return true;
+	}
+
+	bool IsEmpty() const
+	{
+		return m_Top.load(std::memory_order_acquire) >= m_Bottom.load(std::memory_order_acquire);
+	}
+
+private:
+	struct Buffer
+	{
+		size_t Capacity;
+		std::unique_ptr<std::atomic<T *>[]> Items;
+
+		Buffer(size_t capacity)
+			: Capacity(capacity), Items(new std::atomic<T *>[capacity])
+		{ }
+
+		T *Get(long index) const
+		{
+			return Items[index & (Capacity - 1)].load(std::memory_order_relaxed);
+		}
+
+		void Put(long index, T *item)
+		{
+			Items[index & (Capacity - 1)].store(item, std::memory_order_relaxed);
+		}
+	};
+
+	std::atomic<long> m_Top{0};
+	std::atomic<long> m_Bottom{0};
+	std::atomic<Buffer *> m_Buffer;
+	std::vector<std::unique_ptr<Buffer> > m_Buffers;
+
+	Buffer *Grow(Buffer *buffer, long bottom, long top)
+	{
+		m_Buffers.emplace_back(new Buffer(buffer->Capacity * 2));
+		Buffer *newBuffer = m_Buffers.back().get();
+
+		for (long i = top; i < bottom; i++)
+			newBuffer->Put(i, buffer->Get(i));
+
+		m_Buffer.store(newBuffer, std::memory_order_release);
+
+		return newBuffer;
+	}
+};
+
+}
+
+#endif /* WORKSTEALINGDEQUE_H */
@@ -0,0 +1,98 @@
+/******************************************************************************
+ * Icinga 2                                                                   *
+ * Copyright (C) 2012-2018 Icinga Development Team (https://www.icinga.com/)  *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or              *
+ * modify it under the terms of the GNU General Public License                *
+ * as published by the Free Software Foundation; either version 2             *
+ * of the License, or (at your option) any later version.                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software Foundation     *
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
+ ******************************************************************************/
+
+
+#include "checker/checkablescheduler.hpp"
+#include "base/utility.hpp"
+#include "base/exception.hpp"
+
+using namespace icinga;
+
+std::unique_ptr<CheckableScheduler> CheckableScheduler::Create(const String& type)
+{
+	if (type == "ordered")
+		return std::unique_ptr<CheckableScheduler>(new OrderedCheckableScheduler());
+	else if (type == "timingwheel")
+		return std::unique_ptr<CheckableScheduler>(new TimingWheelCheckableScheduler());
+	else
+		BOOST_THROW_EXCEPTION(std::invalid_argument("Invalid scheduler type: " + type));
+}
+
+void OrderedCheckableScheduler::Insert(const CheckableScheduleInfo& csi)
+{
+	/* remove and re-insert the object from the set in order to force an index update */
+	m_Checkables.erase(csi.Object);
+	m_Checkables.insert(csi);
+}
+
+bool OrderedCheckableScheduler::Erase(const Checkable::Ptr& checkable)
+{
+	return m_Checkables.erase(checkable) > 0;
+}
+
+bool OrderedCheckableScheduler::Contains(const Checkable::Ptr& checkable) const
+{
+	return m_Checkables.find(checkable) != m_Checkables.end();
+}
+
+bool OrderedCheckableScheduler::GetNext(double, CheckableScheduleInfo *csi)
+{
+	typedef boost::multi_index::nth_index<CheckableSet, 1>::type CheckTimeView;
+	CheckTimeView& idx = boost::get<1>(m_Checkables);
+
+	if (idx.begin() == idx.end())
+		return false;
+
+	*csi = *idx.begin();
+	return true;
+}
+
+size_t OrderedCheckableScheduler::GetSize() const
+{
+	return m_Checkables.size();
+}
+
+TimingWheelCheckableScheduler::TimingWheelCheckableScheduler()
+	: m_Wheel(Utility::GetTime())
+{ }
+
+void TimingWheelCheckableScheduler::Insert(const CheckableScheduleInfo& csi)
+{
+	m_Wheel.Insert(csi.Object, csi.NextCheck);
+}
+
+bool TimingWheelCheckableScheduler::Erase(const Checkable::Ptr& checkable)
+{
+	return m_Wheel.Erase(checkable);
+}
+
+bool TimingWheelCheckableScheduler::Contains(const Checkable::Ptr& checkable) const
+{
+	return m_Wheel.Contains(checkable);
+}
+
+bool TimingWheelCheckableScheduler::GetNext(double now, CheckableScheduleInfo *csi)
+{
+	return m_Wheel.GetNext(now, &csi->Object, &csi->NextCheck);
+}
+
+size_t TimingWheelCheckableScheduler::GetSize() const
+{
+	return m_Wheel.GetSize();
+}
@@ -0,0 +1,136 @@
+/******************************************************************************
+ * Icinga 2                                                                   *
+ * Copyright (C) 2012-2018 Icinga Development Team (https://www.icinga.com/)  *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or              *
+ * modify it under the terms of the GNU General Public License                *
+ * as published by the Free Software Foundation; either version 2             *
+ * of the License, or (at your option) any later version.                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software Foundation     *
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
+ ******************************************************************************/
+
+
+#ifndef CHECKABLESCHEDULER_H
+#define CHECKABLESCHEDULER_H
+
+#include "icinga/checkable.hpp"
+#include "base/timingwheel.hpp"
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/key_extractors.hpp>
+#include <memory>
+
+namespace icinga
+{
+
+/**
+ * @ingroup checker
+ */
+struct CheckableScheduleInfo
+{
+	Checkable::Ptr Object;
+	double NextCheck;
+};
+
+/**
+ * @ingroup checker
+ */
+struct CheckableNextCheckExtractor
+{
+	typedef double result_type;
+
+	/**
+	 * @threadsafety Always.
+	 */
+	double operator()(const CheckableScheduleInfo& csi)
+	{
+		return csi.NextCheck;
+	}
+};
+
+typedef boost::multi_index_container<
+	CheckableScheduleInfo,
+	boost::multi_index::indexed_by<
+		boost::multi_index::ordered_unique<boost::multi_index::member<CheckableScheduleInfo, Checkable::Ptr, &CheckableScheduleInfo::Object> >,
+		boost::multi_index::ordered_non_unique<CheckableNextCheckExtractor>
+	>
+> CheckableSet;
+
+/**
+ * Keeps track of the idle checkables and when their next check is due.
+ * Implementations are not thread-safe.
+ *
+ * @ingroup checker
+ */
+class CheckableScheduler
+{
+public:
+	virtual ~CheckableScheduler() = default;
+
+	/**
+	 * Adds a checkable or updates its next check timestamp.
+	 */
+	virtual void Insert(const CheckableScheduleInfo& csi) = 0;
+	virtual bool Erase(const Checkable::Ptr& checkable) = 0;
+	virtual bool Contains(const Checkable::Ptr& checkable) const = 0;
+
+	/**
+	 * Retrieves the checkable whose check is due next without removing it.
+	 */
+	virtual bool GetNext(double now, CheckableScheduleInfo *csi) = 0;
+
+	virtual size_t GetSize() const = 0;
+
+	static std::unique_ptr<CheckableScheduler> Create(const String& type);
+};
+
+/**
+ * Scheduler which keeps the checkables in a set ordered by their next check.
+ *
+ * @ingroup checker
+ */
+class OrderedCheckableScheduler final : public CheckableScheduler
+{
+public:
+	void Insert(const CheckableScheduleInfo& csi) override;
+	bool Erase(const Checkable::Ptr& checkable) override;
+	bool Contains(const Checkable::Ptr& checkable) const override;
+	bool GetNext(double now, CheckableScheduleInfo *csi) override;
+	size_t GetSize() const override;
+
+private:
+	CheckableSet m_Checkables;
+};
+
+/**
+ * Scheduler which keeps the checkables in a timing wheel. Rescheduling a
+ * checkable is O(1) as long as its next check is within the wheel's horizon.
+ *
+ * @ingroup checker
+ */
+class TimingWheelCheckableScheduler final : public CheckableScheduler
+{
+public:
+	TimingWheelCheckableScheduler();
+
+	void Insert(const CheckableScheduleInfo& csi) override;
+	bool Erase(const Checkable::Ptr& checkable) override;
+	bool Contains(const Checkable::Ptr& checkable) const override;
+	bool GetNext(double now, CheckableScheduleInfo *csi) override;
+	size_t GetSize() const override;
+
+private:
+	TimingWheel<Checkable::Ptr> m_Wheel;
+};
+
+}
+
+#endif /* CHECKABLESCHEDULER_H */
@@ -60,6 +60,12 @@ void CheckerComponent::StatsFunc(const Dictionary::Ptr& status, const Array::Ptr
 
 void CheckerComponent::OnConfigLoaded()
 {
+	for (int i = 0; i < GetSchedulerThreads(); i++) {
+		std::unique_ptr<CheckerShard> shard(new CheckerShard());
+		shard->IdleCheckables = CheckableScheduler::Create(GetSchedulerType());
+		m_Shards.push_back(std::move(shard));
+	}
+
 	ConfigObject::OnActiveChanged.connect(std::bind(&CheckerComponent::ObjectHandler, this, _1));
 	ConfigObject::OnPausedChanged.connect(std::bind(&CheckerComponent::ObjectHandler, this, _1));
 
@@ -74,7 +80,8 @@ void CheckerComponent::Start(bool runtimeCreated)
 		<< "'" << GetName() << "' started.";
 
 
-	m_Thread = std::thread(std::bind(&CheckerComponent::CheckThreadProc, this));
+	for (const auto& shard : m_Shards)
+		shard->Thread = std::thread(std::bind(&CheckerComponent::CheckThreadProc, this, shard.get()));
 
 	m_ResultTimer = new Timer();
 	m_ResultTimer->SetInterval(5);
@@ -87,52 +94,65 @@ void CheckerComponent::Stop(bool runtimeRemoved)
 	Log(LogInformation, "CheckerComponent")
 		<< "'" << GetName() << "' stopped.";
 
-	{
-		boost::mutex::scoped_lock lock(m_Mutex);
-		m_Stopped = true;
-		m_CV.notify_all();
+	for (const auto& shard : m_Shards) {
+		boost::mutex::scoped_lock lock(shard->Mutex);
+		shard->Stopped = true;
+		shard->CV.notify_all();
 	}
 
 	m_ResultTimer->Stop();
-	m_Thread.join();
+
+	for (const auto& shard : m_Shards)
+		shard->Thread.join();
 
 	ObjectImpl<CheckerComponent>::Stop(runtimeRemoved);
 }
 
-void CheckerComponent::CheckThreadProc()
+CheckerShard& CheckerComponent::GetShard(const Checkable::Ptr& checkable)
+{
+	if (m_Shards.size() == 1)
+		return *m_Shards[0];
+
+	return *m_Shards[Utility::SDBM(checkable->GetName()) % m_Shards.size()];
+}
+
+void CheckerComponent::CheckThreadProc(CheckerShard *shard)
 {
 	Utility::SetThreadName("Check Scheduler");
 
-	boost::mutex::scoped_lock lock(m_Mutex);
+	boost::mutex::scoped_lock lock(shard->Mutex);
 
 	for (;;) {
-		typedef boost::multi_index::nth_index<CheckableSet, 1>::type CheckTimeView;
-		CheckTimeView& idx = boost::get<1>(m_IdleCheckables);
+		CheckableScheduleInfo csi;
+		double now = Utility::GetTime();
 
-		while (idx.begin() == idx.end() && !m_Stopped)
-			m_CV.wait(lock);
+		while (!shard->IdleCheckables->GetNext(now, &csi) && !shard->Stopped) {
+			shard->CV.wait(lock);
+			now = Utility::GetTime();
+		}
 
-		if (m_Stopped)
+		if (shard->Stopped)
 			break;
 
-		auto it = idx.begin();
-		CheckableScheduleInfo csi = *it;
-
-		double wait = csi.NextCheck - Utility::GetTime();
-
-		if (Checkable::GetPendingChecks() >= GetConcurrentChecks())
-			wait = 0.5;
+		double wait = csi.NextCheck - now;
 
 		if (wait > 0) {
 			/* Wait for the next check. */
-			m_CV.timed_wait(lock, boost::posix_time::milliseconds(wait * 1000));
+			shard->CV.timed_wait(lock, boost::posix_time::milliseconds(wait * 1000));
+
+			continue;
+		}
+
+		/* All shards share the same check slots; ReleaseCheckSlot() wakes us up when one becomes available. */
+		if (!Checkable::TryIncreasePendingChecks(GetConcurrentChecks())) {
+			shard->CV.timed_wait(lock, boost::posix_time::milliseconds(500));
 
 			continue;
 		}
 
 		Checkable::Ptr checkable = csi.Object;
 
-		m_IdleCheckables.erase(checkable);
+		shard->IdleCheckables->Erase(checkable);
 
 		bool forced = checkable->GetForceNextCheck();
 		bool check = true;
@@ -171,9 +191,11 @@ void CheckerComponent::CheckThreadProc()
 
 		/* reschedule the checkable if checks are disabled */
 		if (!check) {
-			m_IdleCheckables.insert(GetCheckableScheduleInfo(checkable));
+			shard->IdleCheckables->Insert(GetCheckableScheduleInfo(checkable));
 			lock.unlock();
 
+			ReleaseCheckSlot();
+
 			checkable->UpdateNextCheck();
 
 			lock.lock();
@@ -181,7 +203,7 @@ void CheckerComponent::CheckThreadProc()
 			continue;
 		}
 
-		m_PendingCheckables.insert(GetCheckableScheduleInfo(checkable));
+		shard->PendingCheckables.insert(GetCheckableScheduleInfo(checkable));
 
 		lock.unlock();
 
@@ -193,8 +215,6 @@ void CheckerComponent::CheckThreadProc()
 		Log(LogDebug, "CheckerComponent")
 			<< "Executing check for '" << checkable->GetName() << "'";
 
-		Checkable::IncreasePendingChecks();
-
 		Utility::QueueAsyncCallback(std::bind(&CheckerComponent::ExecuteCheckHelper, CheckerComponent::Ptr(this), checkable));
 
 		lock.lock();
@@ -223,40 +243,50 @@ void CheckerComponent::ExecuteCheckHelper(const Checkable::Ptr& checkable)
 		Log(LogCritical, "checker", output);
 	}
 
-	Checkable::DecreasePendingChecks();
-
 	{
-		boost::mutex::scoped_lock lock(m_Mutex);
+		CheckerShard& shard = GetShard(checkable);
+		boost::mutex::scoped_lock lock(shard.Mutex);
 
 		/* remove the object from the list of pending objects; if it's not in the
 		 * list this was a manual (i.e. forced) check and we must not re-add the
 		 * object to the list because it's already there. */
-		auto it = m_PendingCheckables.find(checkable);
+		auto it = shard.PendingCheckables.find(checkable);
 
-		if (it != m_PendingCheckables.end()) {
-			m_PendingCheckables.erase(it);
+		if (it != shard.PendingCheckables.end()) {
+			shard.PendingCheckables.erase(it);
 
 			if (checkable->IsActive())
-				m_IdleCheckables.insert(GetCheckableScheduleInfo(checkable));
-
-			m_CV.notify_all();
+				shard.IdleCheckables->Insert(GetCheckableScheduleInfo(checkable));
 		}
 	}
 
+	ReleaseCheckSlot();
+
 	Log(LogDebug, "CheckerComponent")
 		<< "Check finished for object '" << checkable->GetName() << "'";
 }
 
+/**
+ * Frees a slot which was reserved with Checkable::TryIncreasePendingChecks()
+ * and wakes up the shards, any of which might be waiting for it. This must
+ * not be called while holding a shard's mutex.
+ */
+void CheckerComponent::ReleaseCheckSlot()
+{
+	Checkable::DecreasePendingChecks();
+
+	for (const auto& shard : m_Shards) {
+		boost::mutex::scoped_lock lock(shard->Mutex);
+		shard->CV.notify_all();
+	}
+}
+
 void CheckerComponent::ResultTimerHandler()
 {
 	std::ostringstream msgbuf;
 
-	{
-		boost::mutex::scoped_lock lock(m_Mutex);
-
-		msgbuf << "Pending checkables: " << m_PendingCheckables.size() << "; Idle checkables: " << m_IdleCheckables.size() << "; Checks/s: "
-			<< (CIB::GetActiveHostChecksStatistics(60) + CIB::GetActiveServiceChecksStatistics(60)) / 60.0;
-	}
+	msgbuf << "Pending checkables: " << GetPendingCheckables() << "; Idle checkables: " << GetIdleCheckables() << "; Checks/s: "
+		<< (CIB::GetActiveHostChecksStatistics(60) + CIB::GetActiveServiceChecksStatistics(60)) / 60.0;
 
 	Log(LogNotice, "CheckerComponent", msgbuf.str());
 }
@@ -272,22 +302,39 @@ void CheckerComponent::ObjectHandler(const ConfigObject::Ptr& object)
 	bool same_zone = (!zone || Zone::GetLocalZone() == zone);
 
 	{
-		boost::mutex::scoped_lock lock(m_Mutex);
+		CheckerShard& shard = GetShard(checkable);
+		boost::mutex::scoped_lock lock(shard.Mutex);
 
 		if (object->IsActive() && !object->IsPaused() && same_zone) {
-			if (m_PendingCheckables.find(checkable) != m_PendingCheckables.end())
+			if (shard.PendingCheckables.find(checkable) != shard.PendingCheckables.end())
 				return;
 
-			m_IdleCheckables.insert(GetCheckableScheduleInfo(checkable));
+			shard.IdleCheckables->Insert(GetCheckableScheduleInfo(checkable));
 		} else {
-			m_IdleCheckables.erase(checkable);
-			m_PendingCheckables.erase(checkable);
+			shard.IdleCheckables->Erase(checkable);
+			shard.PendingCheckables.erase(checkable);
 		}
 
-		m_CV.notify_all();
+		shard.CV.notify_all();
 	}
 }
 
+void CheckerComponent::ValidateSchedulerType(const Lazy<String>& lvalue, const ValidationUtils& utils)
+{
+	ObjectImpl<CheckerComponent>::ValidateSchedulerType(lvalue, utils);
+
+	if (lvalue() != "ordered" && lvalue() != "timingwheel")
+		BOOST_THROW_EXCEPTION(ValidationError(this, { "scheduler_type" }, "Invalid scheduler type. Must be one of 'ordered' or 'timingwheel'."));
+}
+
+void CheckerComponent::ValidateSchedulerThreads(const Lazy<int>& lvalue, const ValidationUtils& utils)
+{
+	ObjectImpl<CheckerComponent>::ValidateSchedulerThreads(lvalue, utils);
+
+	if (lvalue() < 1)
+		BOOST_THROW_EXCEPTION(ValidationError(this, { "scheduler_threads" }, "Value must be greater than 0."));
+}
+
 CheckableScheduleInfo CheckerComponent::GetCheckableScheduleInfo(const Checkable::Ptr& checkable)
 {
 	CheckableScheduleInfo csi;
@@ -298,35 +345,37 @@ CheckableScheduleInfo CheckerComponent::GetCheckableScheduleInfo(const Checkable
 
 void CheckerComponent::NextCheckChangedHandler(const Checkable::Ptr& checkable)
 {
-	boost::mutex::scoped_lock lock(m_Mutex);
-
-	/* remove and re-insert the object from the set in order to force an index update */
-	typedef boost::multi_index::nth_index<CheckableSet, 0>::type CheckableView;
-	CheckableView& idx = boost::get<0>(m_IdleCheckables);
-
-	auto it = idx.find(checkable);
+	CheckerShard& shard = GetShard(checkable);
+	boost::mutex::scoped_lock lock(shard.Mutex);
 
-	if (it == idx.end())
+	if (!shard.IdleCheckables->Contains(checkable))
 		return;
 
-	idx.erase(checkable);
+	shard.IdleCheckables->Insert(GetCheckableScheduleInfo(checkable));
 
-	CheckableScheduleInfo csi = GetCheckableScheduleInfo(checkable);
-	idx.insert(csi);
-
-	m_CV.notify_all();
+	shard.CV.notify_all();
 }
 
 unsigned long CheckerComponent::GetIdleCheckables()
 {
-	boost::mutex::scoped_lock lock(m_Mutex);
+	unsigned long count = 0;
+
+	for (const auto& shard : m_Shards) {
+		boost::mutex::scoped_lock lock(shard->Mutex);
+		count += shard->IdleCheckables->GetSize();
+	}
 
-	return m_IdleCheckables.size();
+	return count;
 }
 
 unsigned long CheckerComponent::GetPendingCheckables()
 {
-	boost::mutex::scoped_lock lock(m_Mutex);
+	unsigned long count = 0;
+
+	for (const auto& shard : m_Shards) {
+		boost::mutex::scoped_lock lock(shard->Mutex);
+		count += shard->PendingCheckables.size();
+	}
 
-	return m_PendingCheckables.size();
+	return count;
 }
@@ -21,43 +21,32 @@
 #define CHECKERCOMPONENT_H
 
 #include "checker/checkercomponent-ti.hpp"
+#include "checker/checkablescheduler.hpp"
 #include "icinga/service.hpp"
 #include "base/configobject.hpp"
 #include "base/timer.hpp"
 #include "base/utility.hpp"
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/condition_variable.hpp>
-#include <boost/multi_index_container.hpp>
-#include <boost/multi_index/ordered_index.hpp>
-#include <boost/multi_index/key_extractors.hpp>
 #include <thread>
 
 namespace icinga
 {
 
 /**
+ * A partition of the checkables which is scheduled by its own thread.
+ *
  * @ingroup checker
  */
-struct CheckableScheduleInfo
+struct CheckerShard
 {
-	Checkable::Ptr Object;
-	double NextCheck;
-};
+	boost::mutex Mutex;
+	boost::condition_variable CV;
+	bool Stopped{false};
+	std::thread Thread;
 
-/**
- * @ingroup checker
- */
-struct CheckableNextCheckExtractor
-{
-	typedef double result_type;
-
-	/**
-	 * @threadsafety Always.
-	 */
-	double operator()(const CheckableScheduleInfo& csi)
-	{
-		return csi.NextCheck;
-	}
+	std::unique_ptr<CheckableScheduler> IdleCheckables;
+	CheckableSet PendingCheckables;
 };
 
 /**
@@ -69,15 +58,9 @@ public:
 	DECLARE_OBJECT(CheckerComponent);
 	DECLARE_OBJECTNAME(CheckerComponent);
 
-	typedef boost::multi_index_container<
-		CheckableScheduleInfo,
-		boost::multi_index::indexed_by<
-			boost::multi_index::ordered_unique<boost::multi_index::member<CheckableScheduleInfo, Checkable::Ptr, &CheckableScheduleInfo::Object> >,
-			boost::multi_index::ordered_non_unique<CheckableNextCheckExtractor>
-		>
-	> CheckableSet;
-
 	void OnConfigLoaded() override;
+	void ValidateSchedulerType(const Lazy<String>& lvalue, const ValidationUtils& utils) override;
+	void ValidateSchedulerThreads(const Lazy<int>& lvalue, const ValidationUtils& utils) override;
 	void Start(bool runtimeCreated) override;
 	void Stop(bool runtimeRemoved) override;
 
@@ -86,20 +69,17 @@ public:
 	unsigned long GetPendingCheckables();
 
 private:
-	boost::mutex m_Mutex;
-	boost::condition_variable m_CV;
-	bool m_Stopped{false};
-	std::thread m_Thread;
-
-	CheckableSet m_IdleCheckables;
-	CheckableSet m_PendingCheckables;
+	std::vector<std::unique_ptr<CheckerShard> > m_Shards;
 
 	Timer::Ptr m_ResultTimer;
 
-	void CheckThreadProc();
+	CheckerShard& GetShard(const Checkable::Ptr& checkable);
+
+	void CheckThreadProc(CheckerShard *shard);
 	void ResultTimerHandler();
 
 	void ExecuteCheckHelper(const Checkable::Ptr& checkable);
+	void ReleaseCheckSlot();
 
 	void AdjustCheckTimer();
 
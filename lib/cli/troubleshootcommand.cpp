@@ -536,7 +536,7 @@ void TroubleshootCommand::CheckObjectFile(const String& objectfile, InfoLog& log
 		<< "Found the " << countTotal << " objects:\n"
 		<< "  Type" << std::string(typeL-4, ' ') << " : Count\n";
 
-	for (const Dictionary::Pair& kv : type_count) {
+	for (const auto& kv : type_count) {
 		InfoLogLine(log)
 			<< "  " << kv.first << std::string(typeL - kv.first.GetLength(), ' ')
 			<< " : " << kv.second << '\n';
@@ -254,7 +254,7 @@ void DbObject::SendVarsConfigUpdateHeavy()
 			query3.Type = DbQueryInsert;
 			query3.Category = DbCatConfig;
 			query3.Fields = new Dictionary({
-				{ "varname", kv.first },
+				{ "varname", kv.first.GetString() },
 				{ "varvalue", value },
 				{ "is_json", is_json },
 				{ "config_type", 1 },
@@ -302,7 +302,7 @@ void DbObject::SendVarsStatusUpdate()
 			query.Category = DbCatState;
 
 			query.Fields = new Dictionary({
-				{ "varname", kv.first },
+				{ "varname", kv.first.GetString() },
 				{ "varvalue", value },
 				{ "is_json", is_json },
 				{ "status_update_time", DbValue::FromTimestamp(Utility::GetTime()) },
@@ -312,7 +312,7 @@ void DbObject::SendVarsStatusUpdate()
 
 			query.WhereCriteria = new Dictionary({
 				{ "object_id", obj },
-				{ "varname", kv.first }
+				{ "varname", kv.first.GetString() }
 			});
 
 			queries.emplace_back(std::move(query));
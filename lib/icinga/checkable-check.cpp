@@ -40,8 +40,7 @@ boost::signals2::signal<void (const Checkable::Ptr&, const CheckResult::Ptr&, st
 boost::signals2::signal<void (const Checkable::Ptr&, NotificationType, const CheckResult::Ptr&, const String&, const String&, const MessageOrigin::Ptr&)> Checkable::OnNotificationsRequested;
 boost::signals2::signal<void (const Checkable::Ptr&)> Checkable::OnNextCheckUpdated;
 
-boost::mutex Checkable::m_StatsMutex;
-int Checkable::m_PendingChecks = 0;
+std::atomic<int> Checkable::m_PendingChecks(0);
 
 CheckCommand::Ptr Checkable::GetCheckCommand() const
 {
@@ -536,18 +535,33 @@ void Checkable::UpdateStatistics(const CheckResult::Ptr& cr, CheckableType type)
 
 void Checkable::IncreasePendingChecks()
 {
-	boost::mutex::scoped_lock lock(m_StatsMutex);
 	m_PendingChecks++;
 }
 
+/**
+ * Increases the number of pending checks unless it has already reached the limit.
+ *
+ * @param limit The maximum number of pending checks.
+ * @returns true if the number of pending checks was increased.
+ */
+bool Checkable::TryIncreasePendingChecks(int limit)
+{
+	int pending = m_PendingChecks.load();
+
+	do {
+		if (pending >= limit)
+			return false;
+	} while (!m_PendingChecks.compare_exchange_weak(pending, pending + 1));
+
+	return true;
+}
+
 void Checkable::DecreasePendingChecks()
 {
-	boost::mutex::scoped_lock lock(m_StatsMutex);
 	m_PendingChecks--;
 }
 
 int Checkable::GetPendingChecks()
 {
-	boost::mutex::scoped_lock lock(m_StatsMutex);
 	return m_PendingChecks;
 }
@@ -28,6 +28,7 @@
 #include "icinga/downtime.hpp"
 #include "remote/endpoint.hpp"
 #include "remote/messageorigin.hpp"
+#include <atomic>
 
 namespace icinga
 {
@@ -195,6 +196,7 @@ public:
 	void ValidateMaxCheckAttempts(const Lazy<int>& lvalue, const ValidationUtils& value) final;
 
 	static void IncreasePendingChecks();
+	static bool TryIncreasePendingChecks(int limit);
 	static void DecreasePendingChecks();
 	static int GetPendingChecks();
 
@@ -209,8 +211,7 @@ private:
 	bool m_CheckRunning{false};
 	long m_SchedulingOffset;
 
-	static boost::mutex m_StatsMutex;
-	static int m_PendingChecks;
+	static std::atomic<int> m_PendingChecks;
 
 	/* Downtimes */
 	std::set<Downtime::Ptr> m_Downtimes;
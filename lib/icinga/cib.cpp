@@ -25,6 +25,10 @@
 #include "base/perfdatavalue.hpp"
 #include "base/configtype.hpp"
 #include "base/statsfunction.hpp"
+#include "base/process.hpp"
+#include "base/application.hpp"
+#include "base/timer.hpp"
+#include "base/socketevents.hpp"
 
 using namespace icinga;
 
@@ -338,4 +342,9 @@ void CIB::StatsFunc(const Dictionary::Ptr& status, const Array::Ptr& perfdata) {
 	status->Set("num_hosts_flapping", hs.hosts_flapping);
 	status->Set("num_hosts_in_downtime", hs.hosts_in_downtime);
 	status->Set("num_hosts_acknowledged", hs.hosts_acknowledged);
+
+	status->Set("process_spawn", Process::GetSpawnStatistics());
+	status->Set("thread_pool", Application::GetTP().GetStats());
+	status->Set("timers", Timer::GetStats());
+	status->Set("socket_events", SocketEvents::GetStats());
 }
@@ -34,6 +34,7 @@
 #include "base/initialize.hpp"
 #include "base/statsfunction.hpp"
 #include "base/loader.hpp"
+#include "base/fifo.hpp"
 
 using namespace icinga;
 
@@ -78,7 +79,11 @@ void IcingaApplication::StatsFunc(const Dictionary::Ptr& status, const Array::Pt
 			{ "enable_perfdata", icingaapplication->GetEnablePerfdata() },
 			{ "pid", Utility::GetPid() },
 			{ "program_start", Application::GetStartTime() },
-			{ "version", Application::GetAppVersion() }
+			{ "version", Application::GetAppVersion() },
+			{ "state_dump_duration", ConfigObject::GetLastDumpDuration() },
+			{ "state_dump_objects", ConfigObject::GetLastDumpObjectCount() },
+			{ "buffer_memory", FIFO::GetBufferMemory() },
+			{ "buffer_memory_pooled", FIFO::GetPooledMemory() }
 		}));
 	}
 
@@ -1044,7 +1044,7 @@ Value HostsTable::CustomVariableNamesAccessor(const Value& row)
 	if (vars) {
 		ObjectLock olock(vars);
 		for (const Dictionary::Pair& kv : vars) {
-			result.push_back(kv.first);
+			result.push_back(kv.first.GetString());
 		}
 	}
 
@@ -1097,7 +1097,7 @@ Value HostsTable::CustomVariablesAccessor(const Value& row)
 				val = kv.second;
 
 			result.push_back(new Array({
-				kv.first,
+				kv.first.GetString(),
 				val
 			}));
 		}
@@ -1065,7 +1065,7 @@ Value ServicesTable::CustomVariableNamesAccessor(const Value& row)
 	if (vars) {
 		ObjectLock olock(vars);
 		for (const Dictionary::Pair& kv : vars) {
-			result.push_back(kv.first);
+			result.push_back(kv.first.GetString());
 		}
 	}
 
@@ -1118,7 +1118,7 @@ Value ServicesTable::CustomVariablesAccessor(const Value& row)
 				val = kv.second;
 
 			result.push_back(new Array({
-				kv.first,
+				kv.first.GetString(),
 				val
 			}));
 		}
@@ -29,6 +29,7 @@
 #include "base/perfdatavalue.hpp"
 #include "base/function.hpp"
 #include "base/configtype.hpp"
+#include "base/timer.hpp"
 
 using namespace icinga;
 
@@ -118,7 +119,13 @@ void IcingaCheckTask::ScriptFunc(const Checkable::Ptr& checkable, const CheckRes
 	perfdata->Add(new PerfdataValue("num_hosts_in_downtime", hs.hosts_in_downtime));
 	perfdata->Add(new PerfdataValue("num_hosts_acknowledged", hs.hosts_acknowledged));
 
-	std::vector<Endpoint::Ptr> endpoints = ConfigType::GetObjectsByType<Endpoint>();
+	Dictionary::Ptr timerStats = Timer::GetStats();
+
+	perfdata->Add(new PerfdataValue("timer_avg_lateness", timerStats->Get("avg_lateness")));
+	perfdata->Add(new PerfdataValue("timer_max_lateness", timerStats->Get("max_lateness")));
+	perfdata->Add(new PerfdataValue("timer_avg_jitter", timerStats->Get("avg_jitter")));
+
+	auto endpoints = ConfigType::GetObjectsByType<Endpoint>();
 
 	double lastMessageSent = 0;
 	double lastMessageReceived = 0;
@@ -202,7 +202,7 @@ void OpenTsdbWriter::SendPerfdata(const String& metric, const std::map<String, S
 void OpenTsdbWriter::SendMetric(const String& metric, const std::map<String, String>& tags, double value, double ts)
 {
 	String tags_string = "";
-	for (const Dictionary::Pair& tag : tags) {
+	for (const auto& tag : tags) {
 		tags_string += " " + tag.first + "=" + Convert::ToString(tag.second);
 	}
 
@@ -182,7 +182,7 @@ Value ApiListener::ConfigUpdateObjectAPIHandler(const MessageOrigin::Ptr& origin
 			ObjectLock xlock(objOriginalAttributes);
 			for (const Dictionary::Pair& kv : objOriginalAttributes) {
 				/* original attribute was removed, restore it */
-				if (!newOriginalAttributes->Contains(kv.first))
+				if (!newOriginalAttributes->Contains(kv.first.GetString()))
 					restoreAttrs.push_back(kv.first);
 			}
 		}
@@ -320,7 +320,7 @@ void ApiListener::UpdateConfigObject(const ConfigObject::Ptr& object, const Mess
 		ObjectLock olock(original_attributes);
 		for (const Dictionary::Pair& kv : original_attributes) {
 			std::vector<String> tokens;
-			boost::algorithm::split(tokens, kv.first, boost::is_any_of("."));
+			boost::algorithm::split(tokens, kv.first.GetString(), boost::is_any_of("."));
 
 			Value value = object;
 			for (const String& token : tokens) {
@@ -329,7 +329,7 @@ void ApiListener::UpdateConfigObject(const ConfigObject::Ptr& object, const Mess
 
 			modified_attributes->Set(kv.first, value);
 
-			newOriginalAttributes.push_back(kv.first);
+			newOriginalAttributes.push_back(kv.first.GetString());
 		}
 	}
 
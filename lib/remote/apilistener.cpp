@@ -22,6 +22,7 @@
 #include "remote/jsonrpcconnection.hpp"
 #include "remote/endpoint.hpp"
 #include "remote/jsonrpc.hpp"
+#include "remote/binaryrpc.hpp"
 #include "remote/apifunction.hpp"
 #include "base/convert.hpp"
 #include "base/netstring.hpp"
@@ -35,7 +36,9 @@
 #include "base/context.hpp"
 #include "base/statsfunction.hpp"
 #include "base/exception.hpp"
+#include "base/compression.hpp"
 #include <fstream>
+#include <iomanip>
 
 using namespace icinga;
 
@@ -224,6 +227,9 @@ void ApiListener::Start(bool runtimeCreated)
 		OpenLogFile();
 	}
 
+	m_SpoolStopped = false;
+	m_SpoolThread = std::thread(std::bind(&ApiListener::SpoolThreadProc, this));
+
 	/* create the primary JSON-RPC listener */
 	if (!AddListener(GetBindHost(), GetBindPort())) {
 		Log(LogCritical, "ApiListener")
@@ -264,7 +270,17 @@ void ApiListener::Stop(bool runtimeDeleted)
 	Log(LogInformation, "ApiListener")
 		<< "'" << GetName() << "' stopped.";
 
+	{
+		boost::mutex::scoped_lock lock(m_SpoolMutex);
+		m_SpoolStopped = true;
+		m_SpoolCV.notify_all();
+	}
+
+	if (m_SpoolThread.joinable())
+		m_SpoolThread.join();
+
 	boost::mutex::scoped_lock lock(m_LogLock);
+	WriteSpoolBatch();
 	CloseLogFile();
 }
 
@@ -415,6 +431,16 @@ void ApiListener::NewClientHandler(const Socket::Ptr& client, const String& host
 	}
 }
 
+static bool ArrayContains(const Value& value, const String& item)
+{
+	return value.IsObjectType<Array>() && Array::Ptr(value)->Contains(item);
+}
+
+static bool IsCompressionEnabled(const Endpoint::Ptr& endpoint)
+{
+	return endpoint && endpoint->GetCompression() && StreamCompressor::IsSupported();
+}
+
 /**
  * Processes a new client connection.
  *
@@ -503,10 +529,18 @@ void ApiListener::NewClientHandlerInternal(const Socket::Ptr& client, const Stri
 	ClientType ctype;
 
 	if (role == RoleClient) {
+		Dictionary::Ptr params = new Dictionary();
+
+		if (GetBinaryEncoding())
+			params->Set("encodings", new Array({ BinaryRpc::Encoding }));
+
+		if (IsCompressionEnabled(endpoint))
+			params->Set("compression", new Array({ "zlib" }));
+
 		Dictionary::Ptr message = new Dictionary({
 			{ "jsonrpc", "2.0" },
 			{ "method", "icinga::Hello" },
-			{ "params", new Dictionary() }
+			{ "params", params }
 		});
 
 		JsonRpc::SendMessage(tlsStream, message);
@@ -533,6 +567,11 @@ void ApiListener::NewClientHandlerInternal(const Socket::Ptr& client, const Stri
 		Log(LogNotice, "ApiListener", "New JSON-RPC client");
 
 		JsonRpcConnection::Ptr aclient = new JsonRpcConnection(identity, verify_ok, tlsStream, role);
+
+		/* The peer starts compressing once it has answered our icinga::Hello message. */
+		if (role == RoleClient && IsCompressionEnabled(endpoint))
+			aclient->AcceptCompression();
+
 		aclient->Start();
 
 		if (endpoint) {
@@ -656,6 +695,7 @@ void ApiListener::ApiTimerHandler()
 			Log(LogNotice, "ApiListener")
 				<< "Removing old log file: " << path;
 			(void)unlink(path.CStr());
+			(void)unlink((path + ".idx").CStr());
 		}
 	}
 
@@ -801,35 +841,288 @@ void ApiListener::RelayMessage(const MessageOrigin::Ptr& origin,
 	m_RelayQueue.Enqueue(std::bind(&ApiListener::SyncRelayMessage, this, origin, secobj, message, log), PriorityNormal, true);
 }
 
+/**
+ * Header of a record in the cluster replay log. It is followed by the type
+ * and name of the security object and the message itself. The message is
+ * stored netstring-encoded so that ReplayLog() can send it to the peer
+ * as-is without decoding it.
+ *
+ * Log files written by older versions contain netstring-encoded JSON
+ * envelopes instead. Those can be told apart by the first byte which
+ * is always a digit for netstrings.
+ */
+struct LogRecordHeader
+{
+	char Magic[4];
+	uint32_t FrameLength;
+	double Timestamp;
+	uint32_t TypeLength;
+	uint32_t NameLength;
+};
+
+static const char l_LogRecordMagic[] = { '\xff', 'I', '2', 'L' };
+
+/**
+ * A record from the cluster replay log.
+ */
+struct LogRecord
+{
+	double Timestamp{0};
+	String SecobjType;
+	String SecobjName;
+	String Frame;
+};
+
+static String ReadLogBytes(std::istream& fp, size_t count)
+{
+	std::string buffer(count, '\0');
+
+	if (count > 0 && !fp.read(&buffer[0], count))
+		BOOST_THROW_EXCEPTION(std::invalid_argument("Unexpected end-of-file for log record"));
+
+	return buffer;
+}
+
+/**
+ * Reads the next record from a cluster replay log file.
+ *
+ * @param fp The log file.
+ * @param record The record.
+ * @returns false if the end of the file has been reached, true otherwise.
+ */
+static bool ReadLogRecord(std::istream& fp, LogRecord& record)
+{
+	int ch = fp.peek();
+
+	if (ch == std::char_traits<char>::eof())
+		return false;
+
+	if (ch == static_cast<unsigned char>(l_LogRecordMagic[0])) {
+		LogRecordHeader header;
+
+		if (!fp.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+			memcmp(header.Magic, l_LogRecordMagic, sizeof(header.Magic)) != 0)
+			BOOST_THROW_EXCEPTION(std::invalid_argument("Invalid log record header"));
+
+		record.Timestamp = header.Timestamp;
+		record.SecobjType = ReadLogBytes(fp, header.TypeLength);
+		record.SecobjName = ReadLogBytes(fp, header.NameLength);
+		record.Frame = ReadLogBytes(fp, header.FrameLength);
+
+		return true;
+	}
+
+	/* Log record written by an older version: a netstring containing a JSON envelope. */
+	size_t len = 0;
+	int digits = 0;
+
+	for (;;) {
+		ch = fp.get();
+
+		if (ch == ':' && digits > 0)
+			break;
+
+		if (ch == std::char_traits<char>::eof() || !isdigit(ch) || ++digits > 9)
+			BOOST_THROW_EXCEPTION(std::invalid_argument("Invalid NetString in log file"));
+
+		len = len * 10 + (ch - '0');
+	}
+
+	String data = ReadLogBytes(fp, len + 1);
+
+	if (data[len] != ',')
+		BOOST_THROW_EXCEPTION(std::invalid_argument("Invalid NetString (missing ,)"));
+
+	data.GetData().resize(len);
+
+	Dictionary::Ptr pmessage = JsonDecode(data);
+
+	record.Timestamp = pmessage->Get("timestamp");
+
+	Dictionary::Ptr secname = pmessage->Get("secobj");
+
+	if (secname) {
+		record.SecobjType = secname->Get("type");
+		record.SecobjName = secname->Get("name");
+	} else {
+		record.SecobjType = String();
+		record.SecobjName = String();
+	}
+
+	std::ostringstream msgbuf;
+	NetString::WriteStringToStream(msgbuf, pmessage->Get("message"));
+	record.Frame = msgbuf.str();
+
+	return true;
+}
+
 void ApiListener::PersistMessage(const Dictionary::Ptr& message, const ConfigObject::Ptr& secobj)
 {
 	double ts = message->Get("ts");
 
 	ASSERT(ts != 0);
 
-	Dictionary::Ptr pmessage = new Dictionary();
-	pmessage->Set("timestamp", ts);
+	std::ostringstream msgbuf;
+	NetString::WriteStringToStream(msgbuf, JsonEncode(message));
+	std::string frame = msgbuf.str();
 
-	pmessage->Set("message", JsonEncode(message));
+	String type, name;
+
+	/* The zone is stored in the log index so that ReplayLog() can skip
+	 * messages which the peer isn't allowed to see without decoding them. */
+	String zoneName;
 
 	if (secobj) {
-		Dictionary::Ptr secname = new Dictionary();
-		secname->Set("type", secobj->GetReflectionType()->GetName());
-		secname->Set("name", secobj->GetName());
-		pmessage->Set("secobj", secname);
+		type = secobj->GetReflectionType()->GetName();
+		name = secobj->GetName();
+
+		if (secobj->GetReflectionType() == Zone::TypeInstance)
+			zoneName = secobj->GetName();
+		else
+			zoneName = secobj->GetZoneName();
+
+		if (zoneName.IsEmpty()) {
+			Zone::Ptr localZone = Zone::GetLocalZone();
+
+			if (localZone)
+				zoneName = localZone->GetName();
+		}
 	}
 
-	boost::mutex::scoped_lock lock(m_LogLock);
-	if (m_LogFile) {
-		NetString::WriteStringToStream(m_LogFile, JsonEncode(pmessage));
-		m_LogMessageCount++;
-		SetLogMessageTimestamp(ts);
-
-		if (m_LogMessageCount > 50000) {
-			CloseLogFile();
-			RotateLogFile();
-			OpenLogFile();
+	LogRecordHeader header;
+	memcpy(header.Magic, l_LogRecordMagic, sizeof(header.Magic));
+	header.FrameLength = frame.size();
+	header.Timestamp = ts;
+	header.TypeLength = type.GetLength();
+	header.NameLength = name.GetLength();
+
+	std::string record;
+	record.reserve(sizeof(header) + type.GetLength() + name.GetLength() + frame.size());
+	record.append(reinterpret_cast<const char *>(&header), sizeof(header));
+	record.append(type.GetData());
+	record.append(name.GetData());
+	record.append(frame);
+
+	SpoolItem item;
+	item.Record = std::move(record);
+	item.Timestamp = ts;
+	item.Zone = zoneName;
+	item.Enqueued = Utility::GetTime();
+
+	/* The spool thread only needs to be woken up when it might be waiting for the queue to become non-empty. */
+	if (m_SpoolQueue.Push(std::move(item))) {
+		boost::mutex::scoped_lock lock(m_SpoolMutex);
+		m_SpoolCV.notify_one();
+	}
+}
+
+void ApiListener::SpoolThreadProc()
+{
+	Utility::SetThreadName("API Spool");
+
+	for (;;) {
+		{
+			boost::mutex::scoped_lock lock(m_SpoolMutex);
+
+			while (m_SpoolQueue.IsEmpty() && !m_SpoolStopped)
+				m_SpoolCV.wait(lock);
+
+			if (m_SpoolQueue.IsEmpty() && m_SpoolStopped)
+				break;
 		}
+
+		/* Give other messages a chance to be written in the same batch. */
+		double interval = GetLogFlushInterval();
+
+		if (interval > 0)
+			Utility::Sleep(interval);
+
+		boost::mutex::scoped_lock lock(m_LogLock);
+		WriteSpoolBatch();
+	}
+}
+
+/* must hold m_LogLock */
+void ApiListener::WriteSpoolBatch()
+{
+	std::vector<SpoolItem> items;
+	m_SpoolQueue.PopAll(items);
+
+	if (items.empty() || m_LogFD == -1)
+		return;
+
+	double start = Utility::GetTime();
+
+	std::string buffer;
+	std::ostringstream indexbuf;
+	indexbuf << std::fixed << std::setprecision(6);
+
+	for (const SpoolItem& item : items) {
+		if (m_LogIndexFile)
+			indexbuf << item.Timestamp << " " << m_LogOffset + buffer.size() << " " << item.Record.size() << " " << item.Zone << "\n";
+
+		buffer.append(item.Record);
+	}
+
+	size_t written = 0;
+
+	while (written < buffer.size()) {
+		ssize_t rc = write(m_LogFD, buffer.c_str() + written, buffer.size() - written);
+
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+
+			Log(LogWarning, "ApiListener")
+				<< "Could not write to spool file: " << Utility::FormatErrorNumber(errno);
+
+			break;
+		}
+
+		written += rc;
+	}
+
+	if (m_LogIndexFile) {
+		if (written == buffer.size()) {
+			String entries = indexbuf.str();
+			m_LogIndexFile->Write(entries.CStr(), entries.GetLength());
+		} else {
+			/* Stop indexing this file, ReplayLog() scans everything after the last index entry. */
+			m_LogIndexFile->Close();
+			m_LogIndexFile.reset();
+		}
+	}
+
+	if (GetLogSyncPolicy() == "fsync") {
+#ifndef _WIN32
+		(void) fsync(m_LogFD);
+#else /* _WIN32 */
+		(void) _commit(m_LogFD);
+#endif /* _WIN32 */
+	}
+
+	m_LogOffset += written;
+	m_LogMessageCount += items.size();
+	SetLogMessageTimestamp(items.back().Timestamp);
+
+	double now = Utility::GetTime();
+	double latency = now - items.front().Enqueued;
+
+	m_SpoolBatchStats.InsertValue(now, 1);
+	m_SpoolMessageStats.InsertValue(now, items.size());
+	m_SpoolLatencyStats.InsertValue(now, (now - start) * 1000 * 1000);
+
+	{
+		boost::mutex::scoped_lock lock(m_SpoolMutex);
+
+		if (latency > m_SpoolMaxLatency)
+			m_SpoolMaxLatency = latency;
+	}
+
+	if (m_LogMessageCount > 50000) {
+		CloseLogFile();
+		RotateLogFile();
+		OpenLogFile();
 	}
 }
 
@@ -993,27 +1286,65 @@ void ApiListener::OpenLogFile()
 
 	Utility::MkDirP(Utility::DirName(path), 0750);
 
-	auto *fp = new std::fstream(path.CStr(), std::fstream::out | std::ofstream::app);
+	int flags = O_WRONLY | O_CREAT | O_APPEND;
+#ifdef _WIN32
+	flags |= O_BINARY;
+#endif /* _WIN32 */
+
+	m_LogFD = open(path.CStr(), flags, 0640);
 
-	if (!fp->good()) {
+	if (m_LogFD < 0) {
 		Log(LogWarning, "ApiListener")
 			<< "Could not open spool file: " << path;
+		m_LogFD = -1;
 		return;
 	}
 
-	m_LogFile = new StdioStream(fp, true);
+	off_t size = lseek(m_LogFD, 0, SEEK_END);
+	m_LogOffset = (size > 0) ? size : 0;
+
 	m_LogMessageCount = 0;
 	SetLogMessageTimestamp(Utility::GetTime());
+
+	/* Don't write an index for log files which were started without one
+	 * (e.g. by an older version); ReplayLog() falls back to a full scan. */
+	String indexPath = path + ".idx";
+
+	if (m_LogOffset > 0 && !Utility::PathExists(indexPath))
+		return;
+
+	std::ios_base::openmode mode = std::fstream::out | std::fstream::binary;
+
+	if (m_LogOffset > 0)
+		mode |= std::fstream::app;
+	else
+		mode |= std::fstream::trunc;
+
+	auto *ifp = new std::fstream(indexPath.CStr(), mode);
+
+	if (!ifp->good()) {
+		Log(LogWarning, "ApiListener")
+			<< "Could not open spool index file: " << indexPath;
+		delete ifp;
+		return;
+	}
+
+	m_LogIndexFile = new StdioStream(ifp, true);
 }
 
 /* must hold m_LogLock */
 void ApiListener::CloseLogFile()
 {
-	if (!m_LogFile)
+	if (m_LogFD == -1)
 		return;
 
-	m_LogFile->Close();
-	m_LogFile.reset();
+	(void) close(m_LogFD);
+	m_LogFD = -1;
+
+	if (m_LogIndexFile) {
+		m_LogIndexFile->Close();
+		m_LogIndexFile.reset();
+	}
 }
 
 /* must hold m_LogLock */
@@ -1027,6 +1358,7 @@ void ApiListener::RotateLogFile()
 	String oldpath = GetApiDir() + "log/current";
 	String newpath = GetApiDir() + "log/" + Convert::ToString(static_cast<int>(ts)+1);
 	(void) rename(oldpath.CStr(), newpath.CStr());
+	(void) rename((oldpath + ".idx").CStr(), (newpath + ".idx").CStr());
 }
 
 void ApiListener::LogGlobHandler(std::vector<int>& files, const String& file)
@@ -1047,6 +1379,36 @@ void ApiListener::LogGlobHandler(std::vector<int>& files, const String& file)
 	files.push_back(ts);
 }
 
+bool ApiListener::ReadLogIndex(const String& path, std::vector<LogIndexEntry>& index)
+{
+	std::ifstream fp(path.CStr(), std::ifstream::in | std::ifstream::binary);
+
+	if (!fp)
+		return false;
+
+	std::string line;
+	while (std::getline(fp, line)) {
+		/* Ignore a partially written last entry. */
+		if (fp.eof())
+			break;
+
+		std::istringstream entrybuf(line);
+		LogIndexEntry entry;
+
+		if (!(entrybuf >> entry.Timestamp >> entry.Offset >> entry.Length))
+			break;
+
+		std::string zone;
+		entrybuf.get();
+		std::getline(entrybuf, zone);
+		entry.Zone = zone;
+
+		index.push_back(entry);
+	}
+
+	return true;
+}
+
 void ApiListener::ReplayLog(const JsonRpcConnection::Ptr& client)
 {
 	Endpoint::Ptr endpoint = client->GetEndpoint();
@@ -1078,6 +1440,9 @@ void ApiListener::ReplayLog(const JsonRpcConnection::Ptr& client)
 	for (;;) {
 		boost::mutex::scoped_lock lock(m_LogLock);
 
+		/* Make sure that all messages which were persisted so far are replayed. */
+		WriteSpoolBatch();
+
 		CloseLogFile();
 		RotateLogFile();
 
@@ -1094,6 +1459,10 @@ void ApiListener::ReplayLog(const JsonRpcConnection::Ptr& client)
 		Utility::Glob(GetApiDir() + "log/*", std::bind(&ApiListener::LogGlobHandler, std::ref(files), _1), GlobFile);
 		std::sort(files.begin(), files.end());
 
+		/* Caches whether the target zone may access objects in a zone
+		 * which was recorded in the log index. */
+		std::map<String, bool> zoneAccess;
+
 		for (int ts : files) {
 			String path = GetApiDir() + "log/" + Convert::ToString(ts);
 
@@ -1103,50 +1472,25 @@ void ApiListener::ReplayLog(const JsonRpcConnection::Ptr& client)
 			Log(LogNotice, "ApiListener")
 				<< "Replaying log: " << path;
 
-			auto *fp = new std::fstream(path.CStr(), std::fstream::in | std::fstream::binary);
-			StdioStream::Ptr logStream = new StdioStream(fp, true);
+			std::ifstream fp(path.CStr(), std::ifstream::in | std::ifstream::binary);
 
-			String message;
-			StreamReadContext src;
-			while (true) {
-				Dictionary::Ptr pmessage;
+			auto replayRecord = [&](const LogRecord& record) -> bool {
+				if (record.Timestamp <= peer_ts)
+					return true;
 
-				try {
-					StreamReadStatus srs = NetString::ReadStringFromStream(logStream, &message, src);
-
-					if (srs == StatusEof)
-						break;
-
-					if (srs != StatusNewItem)
-						continue;
-
-					pmessage = JsonDecode(message);
-				} catch (const std::exception&) {
-					Log(LogWarning, "ApiListener")
-						<< "Unexpected end-of-file for cluster log: " << path;
-
-					/* Log files may be incomplete or corrupted. This is perfectly OK. */
-					break;
-				}
-
-				if (pmessage->Get("timestamp") <= peer_ts)
-					continue;
-
-				Dictionary::Ptr secname = pmessage->Get("secobj");
-
-				if (secname) {
-					ConfigObject::Ptr secobj = ConfigObject::GetObject(secname->Get("type"), secname->Get("name"));
+				if (!record.SecobjType.IsEmpty()) {
+					ConfigObject::Ptr secobj = ConfigObject::GetObject(record.SecobjType, record.SecobjName);
 
 					if (!secobj)
-						continue;
+						return true;
 
 					if (!target_zone->CanAccessObject(secobj))
-						continue;
+						return true;
 				}
 
 				try  {
-					size_t bytesSent = NetString::WriteStringToStream(client->GetStream(), pmessage->Get("message"));
-					endpoint->AddMessageSent(bytesSent);
+					client->GetStream()->Write(record.Frame.CStr(), record.Frame.GetLength());
+					endpoint->AddMessageSent(record.Frame.GetLength());
 					count++;
 				} catch (const std::exception& ex) {
 					Log(LogWarning, "ApiListener")
@@ -1155,10 +1499,10 @@ void ApiListener::ReplayLog(const JsonRpcConnection::Ptr& client)
 					Log(LogDebug, "ApiListener")
 						<< "Error while replaying log for endpoint '" << endpoint->GetName() << "': " << DiagnosticInformation(ex);
 
-					break;
+					return false;
 				}
 
-				peer_ts = pmessage->Get("timestamp");
+				peer_ts = record.Timestamp;
 
 				if (ts > logpos_ts + 10) {
 					logpos_ts = ts;
@@ -1174,9 +1518,78 @@ void ApiListener::ReplayLog(const JsonRpcConnection::Ptr& client)
 					size_t bytesSent = JsonRpc::SendMessage(client->GetStream(), lmessage);
 					endpoint->AddMessageSent(bytesSent);
 				}
+
+				return true;
+			};
+
+			/* Reads and replays the next record, returns false when replaying
+			 * this file should be stopped. */
+			auto replayNext = [&]() -> bool {
+				LogRecord record;
+
+				try {
+					if (!ReadLogRecord(fp, record))
+						return false;
+				} catch (const std::exception&) {
+					Log(LogWarning, "ApiListener")
+						<< "Unexpected end-of-file for cluster log: " << path;
+
+					/* Log files may be incomplete or corrupted. This is perfectly OK. */
+					return false;
+				}
+
+				return replayRecord(record);
+			};
+
+			std::vector<LogIndexEntry> index;
+			bool ok = true;
+			size_t offset = 0;
+
+			if (ReadLogIndex(path + ".idx", index)) {
+				/* Index timestamps are rounded to microseconds; replayRecord()
+				 * does the exact comparison for the first few messages. */
+				auto it = std::lower_bound(index.begin(), index.end(), peer_ts - 0.000001,
+					[](const LogIndexEntry& entry, double value) { return entry.Timestamp < value; });
+
+				if (!index.empty())
+					offset = index.back().Offset + index.back().Length;
+
+				for (; it != index.end(); it++) {
+					const LogIndexEntry& entry = *it;
+
+					if (!entry.Zone.IsEmpty()) {
+						auto za = zoneAccess.find(entry.Zone);
+
+						if (za == zoneAccess.end()) {
+							Zone::Ptr zone = Zone::GetByName(entry.Zone);
+							bool access = zone && (zone->GetGlobal() || zone->IsChildOf(target_zone));
+							za = zoneAccess.insert(std::make_pair(entry.Zone, access)).first;
+						}
+
+						if (!za->second)
+							continue;
+					}
+
+					fp.clear();
+					fp.seekg(entry.Offset);
+
+					if (!replayNext()) {
+						ok = false;
+						break;
+					}
+				}
 			}
 
-			logStream->Close();
+			/* Messages which were written without an index entry (e.g. log files
+			 * from older versions or a partially written index) are replayed
+			 * by scanning the remainder of the file. */
+			if (ok) {
+				fp.clear();
+				fp.seekg(offset);
+
+				while (replayNext())
+					; /* empty loop */
+			}
 		}
 
 		if (count > 0) {
@@ -1231,6 +1644,7 @@ std::pair<Dictionary::Ptr, Dictionary::Ptr> ApiListener::GetStatus()
 	Zone::Ptr my_zone = Zone::GetLocalZone();
 
 	Dictionary::Ptr connectedZones = new Dictionary();
+	Dictionary::Ptr batchingEndpoints = new Dictionary();
 
 	for (const Zone::Ptr& zone : ConfigType::GetObjectsByType<Zone>()) {
 		/* only check endpoints in a) the same zone b) our parent zone c) immediate child zones */
@@ -1265,6 +1679,14 @@ std::pair<Dictionary::Ptr, Dictionary::Ptr> ApiListener::GetStatus()
 			} else {
 				allConnectedEndpoints->Add(endpoint->GetName());
 				zoneConnected = true;
+
+				if (endpoint->GetBatchDelay() > 0 || endpoint->GetCompression()) {
+					batchingEndpoints->Set(endpoint->GetName(), new Dictionary({
+						{ "compression_ratio", endpoint->GetCompressionRatio() },
+						{ "batch_delay", endpoint->GetAverageBatchDelay() },
+						{ "messages_per_batch", endpoint->GetMessagesPerBatch() }
+					}));
+				}
 			}
 		}
 
@@ -1297,6 +1719,20 @@ std::pair<Dictionary::Ptr, Dictionary::Ptr> ApiListener::GetStatus()
 	double workQueueItemRate = JsonRpcConnection::GetWorkQueueRate();
 	double syncQueueItemRate = m_SyncQueue.GetTaskCount(60) / 60.0;
 	double relayQueueItemRate = m_RelayQueue.GetTaskCount(60) / 60.0;
+	double arenaAllocations = JsonRpcConnection::GetArenaAllocationsPerMessage();
+	double arenaBytes = JsonRpcConnection::GetArenaBytesPerMessage();
+
+	double now = Utility::GetTime();
+	int spoolBatches = m_SpoolBatchStats.UpdateAndGetValues(now, 60);
+	int spoolMessages = m_SpoolMessageStats.UpdateAndGetValues(now, 60);
+	int spoolLatency = m_SpoolLatencyStats.UpdateAndGetValues(now, 60);
+	double spoolWriteLatency = (spoolBatches > 0) ? spoolLatency / 1000.0 / 1000.0 / spoolBatches : 0;
+	double spoolMaxLatency;
+
+	{
+		boost::mutex::scoped_lock lock(m_SpoolMutex);
+		spoolMaxLatency = m_SpoolMaxLatency;
+	}
 
 	Dictionary::Ptr status = new Dictionary({
 		{ "identity", GetIdentity() },
@@ -1307,6 +1743,7 @@ std::pair<Dictionary::Ptr, Dictionary::Ptr> ApiListener::GetStatus()
 		{ "not_conn_endpoints", allNotConnectedEndpoints },
 
 		{ "zones", connectedZones },
+		{ "batching", batchingEndpoints },
 
 		{ "json_rpc", new Dictionary({
 			{ "clients", jsonRpcClients },
@@ -1316,11 +1753,20 @@ std::pair<Dictionary::Ptr, Dictionary::Ptr> ApiListener::GetStatus()
 			{ "relay_queue_items", relayQueueItems },
 			{ "work_queue_item_rate", workQueueItemRate },
 			{ "sync_queue_item_rate", syncQueueItemRate },
-			{ "relay_queue_item_rate", relayQueueItemRate }
+			{ "relay_queue_item_rate", relayQueueItemRate },
+			{ "arena_allocations_per_message", arenaAllocations },
+			{ "arena_bytes_per_message", arenaBytes }
 		}) },
 
 		{ "http", new Dictionary({
 			{ "clients", httpClients }
+		}) },
+
+		{ "spool", new Dictionary({
+			{ "batch_rate", spoolBatches / 60.0 },
+			{ "message_rate", spoolMessages / 60.0 },
+			{ "write_latency", spoolWriteLatency },
+			{ "max_latency", spoolMaxLatency }
 		}) }
 	});
 
@@ -1340,6 +1786,11 @@ std::pair<Dictionary::Ptr, Dictionary::Ptr> ApiListener::GetStatus()
 	perfdata->Set("num_json_rpc_sync_queue_item_rate", syncQueueItemRate);
 	perfdata->Set("num_json_rpc_relay_queue_item_rate", relayQueueItemRate);
 
+	perfdata->Set("spool_batch_rate", spoolBatches / 60.0);
+	perfdata->Set("spool_message_rate", spoolMessages / 60.0);
+	perfdata->Set("spool_write_latency", spoolWriteLatency);
+	perfdata->Set("spool_max_latency", spoolMaxLatency);
+
 	return std::make_pair(status, perfdata);
 }
 
@@ -1390,8 +1841,66 @@ std::set<HttpServerConnection::Ptr> ApiListener::GetHttpClients() const
 	return m_HttpClients;
 }
 
+/**
+ * Negotiates the message encoding and compression. The connecting peer lists
+ * the encodings and compression algorithms it supports and the accepting peer
+ * answers with the ones it has chosen. Peers which don't know about these
+ * parameters ignore them and keep sending uncompressed JSON.
+ */
 Value ApiListener::HelloAPIHandler(const MessageOrigin::Ptr& origin, const Dictionary::Ptr& params)
 {
+	JsonRpcConnection::Ptr client = origin->FromClient;
+	ApiListener::Ptr listener = ApiListener::GetInstance();
+
+	if (!client || !params || !listener)
+		return Empty;
+
+	bool binary, compression;
+
+	if (client->GetRole() == RoleServer) {
+		binary = listener->GetBinaryEncoding() && ArrayContains(params->Get("encodings"), BinaryRpc::Encoding);
+		compression = IsCompressionEnabled(client->GetEndpoint()) && ArrayContains(params->Get("compression"), "zlib");
+
+		if (!binary && !compression)
+			return Empty;
+
+		Dictionary::Ptr answer = new Dictionary();
+
+		if (binary)
+			answer->Set("encoding", BinaryRpc::Encoding);
+
+		if (compression) {
+			answer->Set("compression", "zlib");
+			client->AcceptCompression();
+		}
+
+		Dictionary::Ptr message = new Dictionary({
+			{ "jsonrpc", "2.0" },
+			{ "method", "icinga::Hello" },
+			{ "params", answer }
+		});
+
+		/* The answer itself is neither binary nor compressed. */
+		client->SendMessage(message);
+	} else {
+		binary = listener->GetBinaryEncoding() && params->Get("encoding") == BinaryRpc::Encoding;
+		compression = IsCompressionEnabled(client->GetEndpoint()) && params->Get("compression") == "zlib";
+	}
+
+	if (binary) {
+		client->SetEncoding(JsonRpcEncodingBinary);
+
+		Log(LogInformation, "ApiListener")
+			<< "Using binary message encoding for identity '" << client->GetIdentity() << "'.";
+	}
+
+	if (compression) {
+		client->EnableCompression();
+
+		Log(LogInformation, "ApiListener")
+			<< "Using compression for identity '" << client->GetIdentity() << "'.";
+	}
+
 	return Empty;
 }
 
@@ -1419,6 +1928,22 @@ void ApiListener::ValidateTlsProtocolmin(const Lazy<String>& lvalue, const Valid
 	}
 }
 
+void ApiListener::ValidateLogSyncPolicy(const Lazy<String>& lvalue, const ValidationUtils& utils)
+{
+	ObjectImpl<ApiListener>::ValidateLogSyncPolicy(lvalue, utils);
+
+	if (lvalue() != "none" && lvalue() != "fsync")
+		BOOST_THROW_EXCEPTION(ValidationError(this, { "log_sync_policy" }, "Invalid sync policy. Must be one of 'none' or 'fsync'."));
+}
+
+void ApiListener::ValidateLogFlushInterval(const Lazy<double>& lvalue, const ValidationUtils& utils)
+{
+	ObjectImpl<ApiListener>::ValidateLogFlushInterval(lvalue, utils);
+
+	if (lvalue() < 0 || lvalue() > 10)
+		BOOST_THROW_EXCEPTION(ValidationError(this, { "log_flush_interval" }, "Flush interval must be between 0 and 10 seconds."));
+}
+
 bool ApiListener::IsHACluster()
 {
 	Zone::Ptr zone = Zone::GetLocalZone();
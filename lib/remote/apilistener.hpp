@@ -30,7 +30,11 @@
 #include "base/workqueue.hpp"
 #include "base/tcpsocket.hpp"
 #include "base/tlsstream.hpp"
+#include "base/mpscqueue.hpp"
+#include "base/ringbuffer.hpp"
+#include <boost/thread/condition_variable.hpp>
 #include <set>
+#include <thread>
 
 namespace icinga
 {
@@ -46,6 +50,33 @@ struct ConfigDirInformation
 	Dictionary::Ptr UpdateV2;
 };
 
+/**
+ * An entry in the index file which is written alongside each cluster
+ * replay log file.
+ *
+ * @ingroup remote
+ */
+struct LogIndexEntry
+{
+	double Timestamp;
+	size_t Offset;
+	size_t Length;
+	String Zone;
+};
+
+/**
+ * A message which is waiting to be written to the cluster replay log.
+ *
+ * @ingroup remote
+ */
+struct SpoolItem
+{
+	std::string Record;
+	double Timestamp;
+	String Zone;
+	double Enqueued;
+};
+
 /**
 * @ingroup remote
 */
@@ -115,6 +146,8 @@ protected:
 	void Stop(bool runtimeDeleted) override;
 
 	void ValidateTlsProtocolmin(const Lazy<String>& lvalue, const ValidationUtils& utils) override;
+	void ValidateLogSyncPolicy(const Lazy<String>& lvalue, const ValidationUtils& utils) override;
+	void ValidateLogFlushInterval(const Lazy<double>& lvalue, const ValidationUtils& utils) override;
 
 private:
 	std::shared_ptr<SSL_CTX> m_SSLContext;
@@ -148,17 +181,33 @@ private:
 	WorkQueue m_SyncQueue{0, 4};
 
 	boost::mutex m_LogLock;
-	Stream::Ptr m_LogFile;
+	int m_LogFD{-1};
+	Stream::Ptr m_LogIndexFile;
 	size_t m_LogMessageCount{0};
+	size_t m_LogOffset{0};
+
+	MpscQueue<SpoolItem> m_SpoolQueue;
+	boost::mutex m_SpoolMutex;
+	boost::condition_variable m_SpoolCV;
+	bool m_SpoolStopped{false};
+	std::thread m_SpoolThread;
+
+	RingBuffer m_SpoolBatchStats{15 * 60};
+	RingBuffer m_SpoolMessageStats{15 * 60};
+	RingBuffer m_SpoolLatencyStats{15 * 60};
+	double m_SpoolMaxLatency{0};
 
 	bool RelayMessageOne(const Zone::Ptr& zone, const MessageOrigin::Ptr& origin, const Dictionary::Ptr& message, const Endpoint::Ptr& currentMaster);
 	void SyncRelayMessage(const MessageOrigin::Ptr& origin, const ConfigObject::Ptr& secobj, const Dictionary::Ptr& message, bool log);
 	void PersistMessage(const Dictionary::Ptr& message, const ConfigObject::Ptr& secobj);
+	void SpoolThreadProc();
+	void WriteSpoolBatch();
 
 	void OpenLogFile();
 	void RotateLogFile();
 	void CloseLogFile();
 	static void LogGlobHandler(std::vector<int>& files, const String& file);
+	static bool ReadLogIndex(const String& path, std::vector<LogIndexEntry>& index);
 	void ReplayLog(const JsonRpcConnection::Ptr& client);
 
 	static void CopyCertificateFile(const String& oldCertPath, const String& newCertPath);
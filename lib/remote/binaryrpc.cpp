@@ -0,0 +1,527 @@
+/******************************************************************************
+ * Icinga 2                                                                   *
+ * Copyright (C) 2012-2018 Icinga Development Team (https://www.icinga.com/)  *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or              *
+ * modify it under the terms of the GNU General Public License                *
+ * as published by the Free Software Foundation; either version 2             *
+ * of the License, or (at your option) any later version.                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software Foundation     *
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
+ ******************************************************************************/
+
+#include "remote/binaryrpc.hpp"
+#include "base/array.hpp"
+#include "base/objectlock.hpp"
+#include "base/exception.hpp"
+#include "base/arena.hpp"
+#include <unordered_map>
+#include <cmath>
+#include <cstring>
+
+using namespace icinga;
+
+const char * const BinaryRpc::Encoding = "binary-v1";
+
+/* The first byte of a binary message. JSON messages can't start with it. */
+static const unsigned char l_BinaryMagic = 0xb1;
+
+enum BinaryTag
+{
+	TagNull = 0x01,
+	TagFalse = 0x02,
+	TagTrue = 0x03,
+	TagInteger = 0x04,
+	TagDouble = 0x05,
+	TagString = 0x06,
+	TagStringRef = 0x07,
+	TagArray = 0x08,
+	TagDictionary = 0x09,
+	TagSmallInteger = 0x80 /* 0x80 - 0xff: integers 0 - 127 */
+};
+
+/* Keys and values which are shared by both peers. Changing this table
+ * requires a new encoding name.
+ */
+static const char * const l_StaticStrings[] = {
+	"jsonrpc", "2.0", "method", "params", "ts", "originZone", "id", "result", "error",
+	"host", "service", "type", "name", "author", "text", "timestamp", "expiry",
+	"cr", "CheckResult", "active", "check_source", "command", "execution_end",
+	"execution_start", "exit_status", "output", "performance_data", "schedule_end",
+	"schedule_start", "state", "vars_after", "vars_before", "attempt", "reachable",
+	"state_type", "next_check", "forced", "notification", "next_notification",
+	"notification_number", "last_notification", "last_problem_notification",
+	"no_more_notifications", "acktype", "notify", "persistent", "comment", "downtime",
+	"users", "user", "modified_attributes", "original_attributes", "version",
+	"config", "package", "stage", "log_position",
+	"event::CheckResult", "event::SetNextCheck", "event::SetForceNextCheck",
+	"event::SetForceNextNotification", "event::SetSuppressedNotifications",
+	"event::SetAcknowledgement", "event::ClearAcknowledgement",
+	"event::SendNotifications", "event::NotificationSentUser",
+	"event::NotificationSentToAllUsers", "event::SetNextNotification",
+	"event::Heartbeat", "event::ExecuteCommand", "log::SetLogPosition",
+	"config::Update", "config::UpdateObject", "config::DeleteObject", "icinga::Hello"
+};
+
+static const size_t l_StaticStringCount = sizeof(l_StaticStrings) / sizeof(l_StaticStrings[0]);
+
+/* Strings longer than this are never looked up in the string table. */
+static const size_t l_MaxStringRefLength = 48;
+
+/* Keys which aren't in the static table are added to a per-message table. */
+static const size_t l_MaxMessageKeys = 256;
+
+static const int l_MaxDepth = 512;
+
+static const std::unordered_map<std::string, size_t>& GetStaticStringIndex()
+{
+	static const std::unordered_map<std::string, size_t> index = []() {
+		std::unordered_map<std::string, size_t> result;
+
+		for (size_t i = 0; i < l_StaticStringCount; i++)
+			result[l_StaticStrings[i]] = i;
+
+		return result;
+	}();
+
+	return index;
+}
+
+/* The static table's keys are kept in the string table for good. */
+static const std::vector<InternedString>& GetStaticKeys()
+{
+	static const std::vector<InternedString> keys = []() {
+		std::vector<InternedString> result;
+
+		for (size_t i = 0; i < l_StaticStringCount; i++)
+			result.emplace_back(l_StaticStrings[i], true);
+
+		return result;
+	}();
+
+	return keys;
+}
+
+static inline size_t FindStaticString(const String& str)
+{
+	if (str.GetLength() > l_MaxStringRefLength)
+		return l_StaticStringCount;
+
+	const std::unordered_map<std::string, size_t>& index = GetStaticStringIndex();
+	auto it = index.find(str.GetData());
+
+	if (it == index.end())
+		return l_StaticStringCount;
+
+	return it->second;
+}
+
+namespace {
+
+struct InternedStringHash
+{
+	inline size_t operator()(const InternedString& str) const
+	{
+		return str.GetHash();
+	}
+};
+
+class BinaryEncoder
+{
+public:
+	explicit BinaryEncoder(std::string& buffer)
+		: m_Buffer(buffer)
+	{ }
+
+	void EncodeValue(const Value& value)
+	{
+		switch (value.GetType()) {
+			case ValueNumber:
+				EncodeNumber(value.Get<double>());
+				break;
+			case ValueBoolean:
+				m_Buffer += static_cast<char>(value.ToBool() ? TagTrue : TagFalse);
+				break;
+			case ValueString:
+				EncodeString(value.Get<String>());
+				break;
+			case ValueObject:
+				{
+					const Object::Ptr& obj = value.Get<Object::Ptr>();
+					Dictionary::Ptr dict = dynamic_pointer_cast<Dictionary>(obj);
+
+					if (dict) {
+						EncodeDictionary(dict);
+						break;
+					}
+
+					Array::Ptr arr = dynamic_pointer_cast<Array>(obj);
+
+					if (arr) {
+						EncodeArray(arr);
+						break;
+					}
+				}
+
+				m_Buffer += static_cast<char>(TagNull);
+				break;
+			case ValueEmpty:
+				m_Buffer += static_cast<char>(TagNull);
+				break;
+			default:
+				VERIFY(!"Invalid variant type.");
+		}
+	}
+
+	void EncodeDictionary(const Dictionary::Ptr& dict)
+	{
+		ObjectLock olock(dict);
+
+		m_Buffer += static_cast<char>(TagDictionary);
+		EncodeVarint(dict->GetLength());
+
+		for (const Dictionary::Pair& kv : dict) {
+			EncodeKey(kv.first);
+			EncodeValue(kv.second);
+		}
+	}
+
+private:
+	std::string& m_Buffer;
+	std::unordered_map<InternedString, size_t, InternedStringHash> m_Keys;
+
+	void EncodeVarint(uint64_t value)
+	{
+		while (value >= 0x80) {
+			m_Buffer += static_cast<char>((value & 0x7f) | 0x80);
+			value >>= 7;
+		}
+
+		m_Buffer += static_cast<char>(value);
+	}
+
+	void EncodeNumber(double value)
+	{
+		/* Integers are stored as zig-zag encoded varints, everything else as an IEEE 754 double. */
+		if (value >= -9007199254740992.0 && value <= 9007199254740992.0 && std::floor(value) == value) {
+			int64_t ivalue = static_cast<int64_t>(value);
+
+			if (ivalue >= 0 && ivalue < 0x80) {
+				m_Buffer += static_cast<char>(TagSmallInteger | ivalue);
+				return;
+			}
+
+			m_Buffer += static_cast<char>(TagInteger);
+			EncodeVarint((static_cast<uint64_t>(ivalue) << 1) ^ static_cast<uint64_t>(ivalue >> 63));
+			return;
+		}
+
+		uint64_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+
+		m_Buffer += static_cast<char>(TagDouble);
+
+		for (int i = 0; i < 8; i++)
+			m_Buffer += static_cast<char>(bits >> (i * 8));
+	}
+
+	void EncodeString(const String& value)
+	{
+		size_t index = FindStaticString(value);
+
+		if (index != l_StaticStringCount) {
+			m_Buffer += static_cast<char>(TagStringRef);
+			EncodeVarint(index);
+			return;
+		}
+
+		m_Buffer += static_cast<char>(TagString);
+		EncodeVarint(value.GetLength());
+		m_Buffer.append(value.CStr(), value.GetLength());
+	}
+
+	void EncodeKey(const InternedString& key)
+	{
+		/* 0 is followed by a literal key, n refers to entry n - 1 of the static table
+		 * and the per-message table, in that order. */
+		size_t index = FindStaticString(key);
+
+		if (index != l_StaticStringCount) {
+			EncodeVarint(index + 1);
+			return;
+		}
+
+		auto it = m_Keys.find(key);
+
+		if (it != m_Keys.end()) {
+			EncodeVarint(l_StaticStringCount + it->second + 1);
+			return;
+		}
+
+		if (m_Keys.size() < l_MaxMessageKeys)
+			m_Keys.emplace(key, m_Keys.size());
+
+		EncodeVarint(0);
+		EncodeVarint(key.GetLength());
+		m_Buffer.append(key.CStr(), key.GetLength());
+	}
+
+	void EncodeArray(const Array::Ptr& arr)
+	{
+		ObjectLock olock(arr);
+
+		m_Buffer += static_cast<char>(TagArray);
+		EncodeVarint(arr->GetLength());
+
+		for (const Value& value : arr)
+			EncodeValue(value);
+	}
+};
+
+class BinaryDecoder
+{
+public:
+	BinaryDecoder(const char *data, size_t length)
+		: m_Pos(reinterpret_cast<const unsigned char *>(data)),
+		m_End(reinterpret_cast<const unsigned char *>(data) + length)
+	{ }
+
+	Value DecodeValue()
+	{
+		unsigned char tag = ReadByte();
+
+		if (tag >= TagSmallInteger)
+			return tag & 0x7f;
+
+		switch (tag) {
+			case TagNull:
+				return Empty;
+			case TagFalse:
+				return false;
+			case TagTrue:
+				return true;
+			case TagInteger:
+				{
+					uint64_t value = ReadVarint();
+					return static_cast<double>(static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1)));
+				}
+			case TagDouble:
+				{
+					if (m_End - m_Pos < 8)
+						Fail();
+
+					uint64_t bits = 0;
+
+					for (int i = 0; i < 8; i++)
+						bits |= static_cast<uint64_t>(m_Pos[i]) << (i * 8);
+
+					m_Pos += 8;
+
+					double value;
+					memcpy(&value, &bits, sizeof(value));
+					return value;
+				}
+			case TagString:
+				return ReadString();
+			case TagStringRef:
+				{
+					uint64_t index = ReadVarint();
+
+					if (index >= l_StaticStringCount)
+						Fail();
+
+					return l_StaticStrings[index];
+				}
+			case TagArray:
+				return DecodeArray();
+			case TagDictionary:
+				return DecodeDictionary();
+			default:
+				Fail();
+		}
+	}
+
+	bool AtEnd() const
+	{
+		return m_Pos == m_End;
+	}
+
+private:
+	const unsigned char *m_Pos;
+	const unsigned char *m_End;
+	std::vector<InternedString> m_Keys;
+	int m_Depth{0};
+
+	[[noreturn]] static void Fail()
+	{
+		BOOST_THROW_EXCEPTION(std::invalid_argument("Invalid binary JSON-RPC message."));
+	}
+
+	unsigned char ReadByte()
+	{
+		if (m_Pos == m_End)
+			Fail();
+
+		return *m_Pos++;
+	}
+
+	uint64_t ReadVarint()
+	{
+		uint64_t value = 0;
+
+		for (int shift = 0; shift < 64; shift += 7) {
+			unsigned char byte = ReadByte();
+
+			value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+
+			if (!(byte & 0x80))
+				return value;
+		}
+
+		Fail();
+	}
+
+	/* Every element needs at least one byte, so larger counts can't be valid. */
+	size_t ReadCount()
+	{
+		uint64_t count = ReadVarint();
+
+		if (count > static_cast<uint64_t>(m_End - m_Pos))
+			Fail();
+
+		return count;
+	}
+
+	String ReadString()
+	{
+		uint64_t length = ReadVarint();
+
+		if (length > static_cast<uint64_t>(m_End - m_Pos))
+			Fail();
+
+		String result(m_Pos, m_Pos + length);
+		m_Pos += length;
+		return result;
+	}
+
+	InternedString ReadKey()
+	{
+		uint64_t index = ReadVarint();
+
+		if (index == 0) {
+			InternedString key(ReadString());
+
+			if (m_Keys.size() < l_MaxMessageKeys)
+				m_Keys.push_back(key);
+
+			return key;
+		}
+
+		index--;
+
+		if (index < l_StaticStringCount)
+			return GetStaticKeys()[index];
+
+		index -= l_StaticStringCount;
+
+		if (index >= m_Keys.size())
+			Fail();
+
+		return m_Keys[index];
+	}
+
+	Value DecodeArray()
+	{
+		if (++m_Depth > l_MaxDepth)
+			Fail();
+
+		size_t count = ReadCount();
+
+		ArrayData items;
+		items.reserve(count);
+
+		for (size_t i = 0; i < count; i++)
+			items.emplace_back(DecodeValue());
+
+		m_Depth--;
+
+		return ArenaNew<Array>(std::move(items));
+	}
+
+	Value DecodeDictionary()
+	{
+		if (++m_Depth > l_MaxDepth)
+			Fail();
+
+		size_t count = ReadCount();
+
+		Dictionary::Ptr dict = ArenaNew<Dictionary>();
+
+		for (size_t i = 0; i < count; i++) {
+			InternedString key = ReadKey();
+			dict->Set(key, DecodeValue());
+		}
+
+		m_Depth--;
+
+		return dict;
+	}
+};
+
+}
+
+/**
+ * Encodes a message using the binary encoding.
+ *
+ * @param message The message.
+ * @returns The encoded message.
+ */
+String BinaryRpc::EncodeMessage(const Dictionary::Ptr& message)
+{
+	std::string buffer;
+	buffer.reserve(256);
+	buffer += static_cast<char>(l_BinaryMagic);
+
+	BinaryEncoder encoder(buffer);
+	encoder.EncodeDictionary(message);
+
+	return String(std::move(buffer));
+}
+
+/**
+ * Decodes a message which was encoded with EncodeMessage().
+ *
+ * @param message The encoded message.
+ * @returns The message.
+ */
+Dictionary::Ptr BinaryRpc::DecodeMessage(const String& message)
+{
+	if (!IsBinaryMessage(message))
+		BOOST_THROW_EXCEPTION(std::invalid_argument("Invalid binary JSON-RPC message."));
+
+	BinaryDecoder decoder(message.CStr() + 1, message.GetLength() - 1);
+	Value value = decoder.DecodeValue();
+
+	if (!decoder.AtEnd() || !value.IsObjectType<Dictionary>())
+		BOOST_THROW_EXCEPTION(std::invalid_argument("Invalid binary JSON-RPC message."));
+
+	return value;
+}
+
+/**
+ * Checks whether a message uses the binary encoding.
+ *
+ * @param message The message.
+ * @returns true if the message is a binary message, false if it is a JSON message.
+ */
+bool BinaryRpc::IsBinaryMessage(const String& message)
+{
+	return !message.IsEmpty() && static_cast<unsigned char>(message[0]) == l_BinaryMagic;
+}
@@ -0,0 +1,55 @@
+/******************************************************************************
+ * Icinga 2                                                                   *
+ * Copyright (C) 2012-2018 Icinga Development Team (https://www.icinga.com/)  *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or              *
+ * modify it under the terms of the GNU General Public License                *
+ * as published by the Free Software Foundation; either version 2             *
+ * of the License, or (at your option) any later version.                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software Foundation     *
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
+ ******************************************************************************/
+
+#ifndef BINARYRPC_H
+#define BINARYRPC_H
+
+#include "base/dictionary.hpp"
+#include "remote/i2-remote.hpp"
+
+namespace icinga
+{
+
+/**
+ * A compact binary encoding for cluster messages.
+ *
+ * Peers agree on this encoding using the icinga::Hello message. The binary
+ * format has the same data model as JSON, but numbers are stored as varints
+ * or raw doubles and well-known keys and values are replaced with indices
+ * into a string table which both sides know in advance.
+ *
+ * @ingroup remote
+ */
+class BinaryRpc
+{
+public:
+	static const char * const Encoding;
+
+	static String EncodeMessage(const Dictionary::Ptr& message);
+	static Dictionary::Ptr DecodeMessage(const String& message);
+
+	static bool IsBinaryMessage(const String& message);
+
+private:
+	BinaryRpc();
+};
+
+}
+
+#endif /* BINARYRPC_H */
@@ -72,7 +72,7 @@ String ConfigObjectUtility::CreateObjectConfig(const Type::Ptr& type, const Stri
 
 		ObjectLock olock(attrs);
 		for (const Dictionary::Pair& kv : attrs) {
-			int fid = type->GetFieldId(kv.first.SubStr(0, kv.first.FindFirstOf(".")));
+			int fid = type->GetFieldId(kv.first.GetString().SubStr(0, kv.first.GetString().FindFirstOf(".")));
 
 			if (fid < 0)
 				BOOST_THROW_EXCEPTION(ScriptError("Invalid attribute specified: " + kv.first));
@@ -153,3 +153,54 @@ double Endpoint::GetBytesReceivedPerSecond() const
 {
 	return m_BytesReceived.CalculateRate(Utility::GetTime(), 60);
 }
+
+/**
+ * Records a batch of messages which has been sent to this endpoint.
+ *
+ * @param messages The number of messages in the batch.
+ * @param bytes The size of the messages.
+ * @param wireBytes The size of the batch after compression.
+ * @param delay How long the first message had to wait for the batch to be sent.
+ */
+void Endpoint::AddBatchSent(int messages, int bytes, int wireBytes, double delay)
+{
+	double time = Utility::GetTime();
+	m_BatchesSent.InsertValue(time, 1);
+	m_BatchMessagesSent.InsertValue(time, messages);
+	m_BatchBytesSent.InsertValue(time, bytes);
+	m_BatchWireBytesSent.InsertValue(time, wireBytes);
+	m_BatchDelay.InsertValue(time, static_cast<int>(delay * 1000 * 1000));
+}
+
+double Endpoint::GetCompressionRatio() const
+{
+	double time = Utility::GetTime();
+	int wireBytes = m_BatchWireBytesSent.UpdateAndGetValues(time, 60);
+
+	if (wireBytes == 0)
+		return 1;
+
+	return static_cast<double>(m_BatchBytesSent.UpdateAndGetValues(time, 60)) / wireBytes;
+}
+
+double Endpoint::GetAverageBatchDelay() const
+{
+	double time = Utility::GetTime();
+	int batches = m_BatchesSent.UpdateAndGetValues(time, 60);
+
+	if (batches == 0)
+		return 0;
+
+	return m_BatchDelay.UpdateAndGetValues(time, 60) / 1000.0 / 1000.0 / batches;
+}
+
+double Endpoint::GetMessagesPerBatch() const
+{
+	double time = Utility::GetTime();
+	int batches = m_BatchesSent.UpdateAndGetValues(time, 60);
+
+	if (batches == 0)
+		return 0;
+
+	return static_cast<double>(m_BatchMessagesSent.UpdateAndGetValues(time, 60)) / batches;
+}
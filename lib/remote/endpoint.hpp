@@ -66,6 +66,12 @@ public:
 	double GetBytesSentPerSecond() const override;
 	double GetBytesReceivedPerSecond() const override;
 
+	void AddBatchSent(int messages, int bytes, int wireBytes, double delay);
+
+	double GetCompressionRatio() const;
+	double GetAverageBatchDelay() const;
+	double GetMessagesPerBatch() const;
+
 protected:
 	void OnAllConfigLoaded() override;
 
@@ -78,6 +84,12 @@ private:
 	mutable RingBuffer m_MessagesReceived{60};
 	mutable RingBuffer m_BytesSent{60};
 	mutable RingBuffer m_BytesReceived{60};
+
+	mutable RingBuffer m_BatchesSent{60};
+	mutable RingBuffer m_BatchMessagesSent{60};
+	mutable RingBuffer m_BatchBytesSent{60};
+	mutable RingBuffer m_BatchWireBytesSent{60};
+	mutable RingBuffer m_BatchDelay{60}; /* in microseconds */
 };
 
 }
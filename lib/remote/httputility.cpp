@@ -62,9 +62,8 @@ void HttpUtility::SendJsonBody(HttpResponse& response, const Dictionary::Ptr& pa
 	if (params)
 		prettyPrint = GetLastParameter(params, "pretty");
 
-	String body = JsonEncode(val, prettyPrint);
-
-	response.WriteBody(body.CStr(), body.GetLength());
+	/* Stream the body in chunks rather than building the whole document in memory. */
+	JsonEncode(val, [&response](const char *data, size_t count) { response.WriteBody(data, count); }, prettyPrint);
 }
 
 Value HttpUtility::GetLastParameter(const Dictionary::Ptr& params, const String& key)
@@ -18,6 +18,7 @@
  ******************************************************************************/
 
 #include "remote/jsonrpc.hpp"
+#include "remote/binaryrpc.hpp"
 #include "base/netstring.hpp"
 #include "base/json.hpp"
 #include "base/console.hpp"
@@ -57,11 +58,15 @@ static bool GetDebugJsonRpcCached()
  * Sends a message to the connected peer and returns the bytes sent.
  *
  * @param message The message.
+ * @param encoding The encoding which was negotiated with the peer.
  *
  * @return The amount of bytes sent.
  */
-size_t JsonRpc::SendMessage(const Stream::Ptr& stream, const Dictionary::Ptr& message)
+size_t JsonRpc::SendMessage(const Stream::Ptr& stream, const Dictionary::Ptr& message, JsonRpcEncoding encoding)
 {
+	if (encoding == JsonRpcEncodingBinary)
+		return NetString::WriteStringToStream(stream, BinaryRpc::EncodeMessage(message));
+
 	String json = JsonEncode(message);
 
 #ifdef I2_DEBUG
@@ -69,7 +74,7 @@ size_t JsonRpc::SendMessage(const Stream::Ptr& stream, const Dictionary::Ptr& me
 		std::cerr << ConsoleColorTag(Console_ForegroundBlue) << ">> " << json << ConsoleColorTag(Console_Normal) << "\n";
 #endif /* I2_DEBUG */
 
-	return NetString::WriteStringToStream(stream, json);
+	return NetString::WriteStringToStream(stream, std::move(json));
 }
 
 StreamReadStatus JsonRpc::ReadMessage(const Stream::Ptr& stream, String *message, StreamReadContext& src, bool may_wait)
@@ -80,18 +85,29 @@ StreamReadStatus JsonRpc::ReadMessage(const Stream::Ptr& stream, String *message
 	if (srs != StatusNewItem)
 		return srs;
 
-	*message = jsonString;
-
 #ifdef I2_DEBUG
-	if (GetDebugJsonRpcCached())
-		std::cerr << ConsoleColorTag(Console_ForegroundBlue) << "<< " << jsonString << ConsoleColorTag(Console_Normal) << "\n";
+	if (GetDebugJsonRpcCached()) {
+		std::cerr << ConsoleColorTag(Console_ForegroundBlue) << "<< ";
+
+		if (BinaryRpc::IsBinaryMessage(jsonString))
+			std::cerr << JsonEncode(BinaryRpc::DecodeMessage(jsonString));
+		else
+			std::cerr << jsonString;
+
+		std::cerr << ConsoleColorTag(Console_Normal) << "\n";
+	}
 #endif /* I2_DEBUG */
 
+	*message = std::move(jsonString);
+
 	return StatusNewItem;
 }
 
 Dictionary::Ptr JsonRpc::DecodeMessage(const String& message)
 {
+	if (BinaryRpc::IsBinaryMessage(message))
+		return BinaryRpc::DecodeMessage(message);
+
 	Value value = JsonDecode(message);
 
 	if (!value.IsObjectType<Dictionary>()) {
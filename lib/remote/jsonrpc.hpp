@@ -27,6 +27,17 @@
 namespace icinga
 {
 
+/**
+ * The encoding used for outgoing JSON-RPC messages.
+ *
+ * @ingroup remote
+ */
+enum JsonRpcEncoding
+{
+	JsonRpcEncodingJson,
+	JsonRpcEncodingBinary
+};
+
 /**
  * A JSON-RPC connection.
  *
@@ -35,7 +46,7 @@ namespace icinga
 class JsonRpc
 {
 public:
-	static size_t SendMessage(const Stream::Ptr& stream, const Dictionary::Ptr& message);
+	static size_t SendMessage(const Stream::Ptr& stream, const Dictionary::Ptr& message, JsonRpcEncoding encoding = JsonRpcEncodingJson);
 	static StreamReadStatus ReadMessage(const Stream::Ptr& stream, String *message, StreamReadContext& src, bool may_wait = false);
 	static Dictionary::Ptr DecodeMessage(const String& message);
 
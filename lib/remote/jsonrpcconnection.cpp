@@ -27,7 +27,13 @@
 #include "base/logger.hpp"
 #include "base/exception.hpp"
 #include "base/convert.hpp"
+#include "base/netstring.hpp"
+#include "base/arena.hpp"
+#include "base/ringbuffer.hpp"
 #include <boost/thread/once.hpp>
+#include <algorithm>
+#include <functional>
+#include <iterator>
 
 using namespace icinga;
 
@@ -38,9 +44,24 @@ static boost::once_flag l_JsonRpcConnectionOnceFlag = BOOST_ONCE_INIT;
 static Timer::Ptr l_JsonRpcConnectionTimeoutTimer;
 static WorkQueue *l_JsonRpcConnectionWorkQueues;
 static size_t l_JsonRpcConnectionWorkQueueCount;
+static WorkQueue *l_JsonRpcConnectionDecodeQueue;
 static int l_JsonRpcConnectionNextID;
 static Timer::Ptr l_HeartbeatTimer;
 
+/* Messages which were decoded into an arena during the last 15 minutes and their allocations. */
+static RingBuffer l_ArenaMessageStats(15 * 60);
+static RingBuffer l_ArenaAllocationStats(15 * 60);
+static RingBuffer l_ArenaByteStats(15 * 60);
+
+/* Batches are sent as soon as they reach this size. */
+static const size_t l_SendBatchSize = 64 * 1024;
+
+/* The first byte of a netstring which contains a compressed batch of netstrings. */
+static const unsigned char l_CompressedFrameMagic = 0xb2;
+
+/* We stop reading from a connection while this many of its messages wait to be decoded or handed to a work queue. */
+static const size_t l_MaxPendingMessages = 1024;
+
 JsonRpcConnection::JsonRpcConnection(const String& identity, bool authenticated,
 	TlsStream::Ptr stream, ConnectionRole role)
 	: m_ID(l_JsonRpcConnectionNextID++), m_Identity(identity), m_Authenticated(authenticated), m_Stream(std::move(stream)),
@@ -50,6 +71,11 @@ JsonRpcConnection::JsonRpcConnection(const String& identity, bool authenticated,
 
 	if (authenticated)
 		m_Endpoint = Endpoint::GetByName(identity);
+
+	if (m_Endpoint && m_Endpoint->GetBatchDelay() > 0) {
+		m_SendBatch = new FIFO();
+		m_SendBatchDelay = m_Endpoint->GetBatchDelay();
+	}
 }
 
 void JsonRpcConnection::StaticInitialize()
@@ -66,6 +92,9 @@ void JsonRpcConnection::StaticInitialize()
 		l_JsonRpcConnectionWorkQueues[i].SetName("JsonRpcConnection, #" + Convert::ToString(i));
 	}
 
+	l_JsonRpcConnectionDecodeQueue = new WorkQueue(0, Application::GetConcurrency());
+	l_JsonRpcConnectionDecodeQueue->SetName("JsonRpcConnection, decoder");
+
 	l_HeartbeatTimer = new Timer();
 	l_HeartbeatTimer->OnTimerExpired.connect(std::bind(&JsonRpcConnection::HeartbeatTimerHandler));
 	l_HeartbeatTimer->SetInterval(10);
@@ -74,6 +103,13 @@ void JsonRpcConnection::StaticInitialize()
 
 void JsonRpcConnection::Start()
 {
+	if (m_SendBatchDelay > 0) {
+		m_SendBatchTimer = new Timer();
+		m_SendBatchTimer->OnTimerExpired.connect(std::bind(&JsonRpcConnection::SendBatchTimerHandler, JsonRpcConnection::Ptr(this)));
+		m_SendBatchTimer->SetInterval(m_SendBatchDelay);
+		m_SendBatchTimer->Start();
+	}
+
 	/* the stream holds an owning reference to this object through the callback we're registering here */
 	m_Stream->RegisterDataHandler(std::bind(&JsonRpcConnection::DataAvailableHandler, JsonRpcConnection::Ptr(this)));
 	if (m_Stream->IsDataAvailable())
@@ -110,13 +146,65 @@ ConnectionRole JsonRpcConnection::GetRole() const
 	return m_Role;
 }
 
+/**
+ * Sets the encoding for messages which are sent to the peer.
+ *
+ * @param encoding The encoding.
+ */
+void JsonRpcConnection::SetEncoding(JsonRpcEncoding encoding)
+{
+	ObjectLock olock(m_Stream);
+	m_Encoding = encoding;
+}
+
+/**
+ * Compresses all messages which are sent to the peer from now on. The peer
+ * must have agreed to this in the icinga::Hello handshake.
+ */
+void JsonRpcConnection::EnableCompression()
+{
+	ObjectLock olock(m_Stream);
+
+	if (m_Compressor)
+		return;
+
+	if (m_SendBatch)
+		FlushSendBatch();
+	else
+		m_SendBatch = new FIFO();
+
+	m_Compressor.reset(new StreamCompressor());
+}
+
+/**
+ * Allows the peer to send compressed messages.
+ */
+void JsonRpcConnection::AcceptCompression()
+{
+	m_AcceptCompression = true;
+}
+
 void JsonRpcConnection::SendMessage(const Dictionary::Ptr& message)
 {
 	try {
 		ObjectLock olock(m_Stream);
 		if (m_Stream->IsEof())
 			return;
-		size_t bytesSent = JsonRpc::SendMessage(m_Stream, message);
+
+		size_t bytesSent;
+
+		if (m_SendBatch) {
+			if (m_SendBatchMessages == 0)
+				m_SendBatchStart = Utility::GetTime();
+
+			bytesSent = JsonRpc::SendMessage(m_SendBatch, message, m_Encoding);
+			m_SendBatchMessages++;
+
+			if (!m_SendBatchTimer || m_SendBatch->GetAvailableBytes() >= l_SendBatchSize)
+				FlushSendBatch();
+		} else
+			bytesSent = JsonRpc::SendMessage(m_Stream, message, m_Encoding);
+
 		m_Endpoint->AddMessageSent(bytesSent);
 	} catch (const std::exception& ex) {
 		std::ostringstream info;
@@ -128,58 +216,104 @@ void JsonRpcConnection::SendMessage(const Dictionary::Ptr& message)
 	}
 }
 
-void JsonRpcConnection::Disconnect()
+/**
+ * Writes the current batch to the stream. The caller must hold the stream's
+ * object lock.
+ */
+void JsonRpcConnection::FlushSendBatch()
 {
-	Log(LogWarning, "JsonRpcConnection")
-		<< "API client disconnected for identity '" << m_Identity << "'";
+	size_t count = m_SendBatch->GetAvailableBytes();
 
-	m_Stream->Close();
+	if (count == 0)
+		return;
 
-	if (m_Endpoint)
-		m_Endpoint->RemoveClient(this);
-	else {
-		ApiListener::Ptr listener = ApiListener::GetInstance();
-		listener->RemoveAnonymousClient(this);
+	std::string data(count, '\0');
+	m_SendBatch->Read(&data[0], count, true);
+
+	size_t wireBytes;
+
+	if (m_Compressor) {
+		std::string frame(1, static_cast<char>(l_CompressedFrameMagic));
+		m_Compressor->Compress(data.c_str(), data.size(), frame);
+		wireBytes = NetString::WriteStringToStream(m_Stream, String(std::move(frame)));
+	} else {
+		m_Stream->Write(data.c_str(), data.size());
+		wireBytes = count;
 	}
+
+	if (m_Endpoint)
+		m_Endpoint->AddBatchSent(m_SendBatchMessages, count, wireBytes, Utility::GetTime() - m_SendBatchStart);
+
+	m_SendBatchMessages = 0;
 }
 
-void JsonRpcConnection::MessageHandlerWrapper(const String& jsonString)
+void JsonRpcConnection::SendBatchTimerHandler()
 {
-	if (m_Stream->IsEof())
-		return;
-
 	try {
-		MessageHandler(jsonString);
+		ObjectLock olock(m_Stream);
+
+		if (m_Stream->IsEof())
+			return;
+
+		FlushSendBatch();
 	} catch (const std::exception& ex) {
 		Log(LogWarning, "JsonRpcConnection")
-			<< "Error while reading JSON-RPC message for identity '" << m_Identity
-			<< "': " << DiagnosticInformation(ex);
+			<< "Error while sending JSON-RPC messages for identity '" << m_Identity << "'\n" << DiagnosticInformation(ex);
 
 		Disconnect();
-
-		return;
 	}
 }
 
-void JsonRpcConnection::MessageHandler(const String& jsonString)
+void JsonRpcConnection::Disconnect()
 {
-	Dictionary::Ptr message = JsonRpc::DecodeMessage(jsonString);
+	Log(LogWarning, "JsonRpcConnection")
+		<< "API client disconnected for identity '" << m_Identity << "'";
 
-	m_Seen = Utility::GetTime();
+	if (m_SendBatchTimer) {
+		m_SendBatchTimer->Stop();
 
-	if (m_HeartbeatTimeout != 0)
-		m_NextHeartbeat = Utility::GetTime() + m_HeartbeatTimeout;
+		/* The timer's handler holds a reference to this connection. */
+		m_SendBatchTimer->OnTimerExpired.disconnect_all_slots();
+	}
 
-	if (m_Endpoint && message->Contains("ts")) {
-		double ts = message->Get("ts");
+	m_Stream->Close();
 
-		/* ignore old messages */
-		if (ts < m_Endpoint->GetRemoteLogPosition())
-			return;
+	if (m_Endpoint)
+		m_Endpoint->RemoveClient(this);
+	else {
+		ApiListener::Ptr listener = ApiListener::GetInstance();
+		listener->RemoveAnonymousClient(this);
+	}
+}
 
-		m_Endpoint->SetRemoteLogPosition(ts);
+void JsonRpcConnection::MessageHandlerWrapper(const Dictionary::Ptr& message, bool ordered)
+{
+	if (!m_Stream->IsEof()) {
+		try {
+			MessageHandler(message);
+		} catch (const std::exception& ex) {
+			Log(LogWarning, "JsonRpcConnection")
+				<< "Error while reading JSON-RPC message for identity '" << m_Identity
+				<< "': " << DiagnosticInformation(ex);
+
+			Disconnect();
+		}
+	}
+
+	{
+		boost::mutex::scoped_lock lock(m_PendingMutex);
+
+		m_MessagesInFlight--;
+
+		if (ordered)
+			m_OrderedMessageInFlight = false;
 	}
 
+	PumpMessages();
+}
+
+void JsonRpcConnection::MessageHandler(const Dictionary::Ptr& message)
+{
 	MessageOrigin::Ptr origin = new MessageOrigin();
 	origin->FromClient = this;
 
@@ -188,8 +322,6 @@ void JsonRpcConnection::MessageHandler(const String& jsonString)
 			origin->FromZone = m_Endpoint->GetZone();
 		else
 			origin->FromZone = Zone::GetByName(message->Get("originZone"));
-
-		m_Endpoint->AddMessageReceived(jsonString.GetLength());
 	}
 
 	Value vmethod;
@@ -237,8 +369,273 @@ void JsonRpcConnection::MessageHandler(const String& jsonString)
 	}
 }
 
+/**
+ * Decodes a message on one of the decoder threads. Messages are passed on
+ * to DispatchMessage() in the order in which they were read from the stream,
+ * even if a later message finishes decoding first.
+ *
+ * If the ApiListener's message_arena attribute is set the message's
+ * dictionaries and arrays are allocated from an arena. Objects which are
+ * kept after the message has been handled keep their part of the arena
+ * alive.
+ *
+ * @param sequence The message's sequence number.
+ * @param jsonString The JSON-encoded message.
+ */
+void JsonRpcConnection::DecodeMessage(uint64_t sequence, const String& jsonString)
+{
+	Dictionary::Ptr message;
+	boost::exception_ptr error;
+
+	ApiListener::Ptr listener = ApiListener::GetInstance();
+
+	try {
+		if (listener && listener->GetMessageArena()) {
+			Arena arena;
+
+			{
+				ArenaScope scope(arena);
+				message = JsonRpc::DecodeMessage(jsonString);
+			}
+
+			double now = Utility::GetTime();
+			l_ArenaMessageStats.InsertValue(now, 1);
+			l_ArenaAllocationStats.InsertValue(now, arena.GetAllocations());
+			l_ArenaByteStats.InsertValue(now, arena.GetBytes());
+		} else
+			message = JsonRpc::DecodeMessage(jsonString);
+	} catch (const std::exception&) {
+		error = boost::current_exception();
+	}
+
+	{
+		boost::mutex::scoped_lock lock(m_PendingMutex);
+
+		PendingMessage& pmessage = m_PendingMessages[sequence - m_PendingSequence];
+		pmessage.Message = std::move(message);
+		pmessage.Error = std::move(error);
+		pmessage.Size = jsonString.GetLength();
+		pmessage.Decoded = true;
+
+		/* Another thread is already dispatching messages and will pick this one up. */
+		if (m_Dispatching)
+			return;
+
+		m_Dispatching = true;
+	}
+
+	for (;;) {
+		std::vector<PendingMessage> ready;
+
+		{
+			boost::mutex::scoped_lock lock(m_PendingMutex);
+
+			while (!m_PendingMessages.empty() && m_PendingMessages.front().Decoded) {
+				ready.push_back(std::move(m_PendingMessages.front()));
+				m_PendingMessages.pop_front();
+				m_PendingSequence++;
+			}
+
+			if (ready.empty()) {
+				m_Dispatching = false;
+				return;
+			}
+		}
+
+		for (const PendingMessage& pmessage : ready)
+			DispatchMessage(pmessage);
+
+		PumpMessages();
+	}
+}
+
+/**
+ * Checks a decoded message and queues it for PumpMessages().
+ *
+ * @param pmessage The message.
+ */
+void JsonRpcConnection::DispatchMessage(const PendingMessage& pmessage)
+{
+	if (m_Stream->IsEof())
+		return;
+
+	if (pmessage.Error) {
+		try {
+			boost::rethrow_exception(pmessage.Error);
+		} catch (const std::exception& ex) {
+			Log(LogWarning, "JsonRpcConnection")
+				<< "Error while reading JSON-RPC message for identity '" << m_Identity
+				<< "': " << DiagnosticInformation(ex);
+		}
+
+		Disconnect();
+
+		return;
+	}
+
+	const Dictionary::Ptr& message = pmessage.Message;
+
+	m_Seen = Utility::GetTime();
+
+	if (m_HeartbeatTimeout != 0)
+		m_NextHeartbeat = Utility::GetTime() + m_HeartbeatTimeout;
+
+	if (m_Endpoint && message->Contains("ts")) {
+		double ts = message->Get("ts");
+
+		/* ignore old messages */
+		if (ts < m_Endpoint->GetRemoteLogPosition())
+			return;
+
+		m_Endpoint->SetRemoteLogPosition(ts);
+	}
+
+	if (m_Endpoint)
+		m_Endpoint->AddMessageReceived(pmessage.Size);
+
+	boost::mutex::scoped_lock lock(m_PendingMutex);
+	m_ReadyMessages.push_back(message);
+}
+
+/**
+ * Hands decoded messages to the work queues. Messages which only affect a
+ * single checkable are distributed by checkable and stay in order with the
+ * other messages for that checkable. All other messages (e.g. config
+ * updates) are handled on the connection's queue after all earlier messages
+ * have been handled and before any later message is.
+ */
+void JsonRpcConnection::PumpMessages()
+{
+	struct QueuedMessage
+	{
+		Dictionary::Ptr Message;
+		size_t Queue;
+		bool Ordered;
+	};
+
+	{
+		boost::mutex::scoped_lock lock(m_PendingMutex);
+
+		/* The other thread picks up our messages once it's done with its current batch. */
+		if (m_Pumping)
+			return;
+
+		m_Pumping = true;
+	}
+
+	for (;;) {
+		std::vector<QueuedMessage> batch;
+		bool resume = false;
+
+		{
+			boost::mutex::scoped_lock lock(m_PendingMutex);
+
+			while (!m_ReadyMessages.empty() && !m_OrderedMessageInFlight) {
+				QueuedMessage qmessage;
+				qmessage.Message = m_ReadyMessages.front();
+				qmessage.Queue = GetMessageQueue(qmessage.Message, &qmessage.Ordered);
+
+				if (qmessage.Ordered) {
+					/* Wait for earlier messages. */
+					if (m_MessagesInFlight > 0)
+						break;
+
+					m_OrderedMessageInFlight = true;
+				}
+
+				m_MessagesInFlight++;
+				m_ReadyMessages.pop_front();
+				batch.emplace_back(std::move(qmessage));
+			}
+
+			if (m_ReadingPaused && m_PendingMessages.size() + m_ReadyMessages.size() < l_MaxPendingMessages / 2) {
+				m_ReadingPaused = false;
+				resume = true;
+			}
+
+			if (batch.empty())
+				m_Pumping = false;
+		}
+
+		for (QueuedMessage& qmessage : batch) {
+			l_JsonRpcConnectionWorkQueues[qmessage.Queue].Enqueue(std::bind(&JsonRpcConnection::MessageHandlerWrapper,
+				JsonRpcConnection::Ptr(this), std::move(qmessage.Message), qmessage.Ordered));
+		}
+
+		/* Read the messages which are still buffered in the stream. */
+		if (resume)
+			DataAvailableHandler();
+
+		if (batch.empty())
+			return;
+	}
+}
+
+/* Messages which only affect the checkable in their "host" and "service" parameters. */
+static const char * const l_CheckableMessages[] = {
+	"event::CheckResult",
+	"event::SetNextCheck",
+	"event::SetForceNextCheck",
+	"event::SetForceNextNotification",
+	"event::SetAcknowledgement",
+	"event::ClearAcknowledgement",
+	"event::SendNotifications",
+	"event::NotificationSentUser",
+	"event::NotificationSentToAllUsers"
+};
+
+/**
+ * Returns the index of the work queue for a message. Messages which only
+ * affect a single host or service are distributed by checkable, all other
+ * messages use the connection's queue and have to be handled in order.
+ *
+ * @param message The message.
+ * @param ordered Whether the message has to be handled in order with all other messages.
+ * @returns The work queue index.
+ */
+size_t JsonRpcConnection::GetMessageQueue(const Dictionary::Ptr& message, bool *ordered) const
+{
+	*ordered = true;
+
+	String method = message->Get("method");
+
+	if (std::find(std::begin(l_CheckableMessages), std::end(l_CheckableMessages), method) == std::end(l_CheckableMessages))
+		return m_ID % l_JsonRpcConnectionWorkQueueCount;
+
+	Value vparams = message->Get("params");
+
+	if (vparams.IsObjectType<Dictionary>()) {
+		Dictionary::Ptr params = vparams;
+		Value vhost = params->Get("host");
+
+		if (vhost.IsString()) {
+			String key = vhost;
+			Value vservice = params->Get("service");
+
+			if (vservice.IsString())
+				key += "!" + static_cast<String>(vservice);
+
+			*ordered = false;
+
+			return std::hash<std::string>()(key.GetData()) % l_JsonRpcConnectionWorkQueueCount;
+		}
+	}
+
+	return m_ID % l_JsonRpcConnectionWorkQueueCount;
+}
+
 bool JsonRpcConnection::ProcessMessage()
 {
+	{
+		boost::mutex::scoped_lock lock(m_PendingMutex);
+
+		/* PumpMessages() resumes reading once the decoder has caught up. */
+		if (m_PendingMessages.size() + m_ReadyMessages.size() >= l_MaxPendingMessages) {
+			m_ReadingPaused = true;
+			return false;
+		}
+	}
+
 	String message;
 
 	StreamReadStatus srs = JsonRpc::ReadMessage(m_Stream, &message, m_Context, false);
@@ -246,11 +643,48 @@ bool JsonRpcConnection::ProcessMessage()
 	if (srs != StatusNewItem)
 		return false;
 
-	l_JsonRpcConnectionWorkQueues[m_ID % l_JsonRpcConnectionWorkQueueCount].Enqueue(std::bind(&JsonRpcConnection::MessageHandlerWrapper, JsonRpcConnection::Ptr(this), message));
+	if (message.IsEmpty() || static_cast<unsigned char>(message[0]) != l_CompressedFrameMagic) {
+		EnqueueMessage(std::move(message));
+		return true;
+	}
+
+	if (!m_AcceptCompression)
+		BOOST_THROW_EXCEPTION(std::invalid_argument("Received a compressed message although compression wasn't negotiated."));
+
+	if (!m_Decompressor) {
+		m_Decompressor.reset(new StreamDecompressor());
+		m_Decompressed = new FIFO();
+	}
+
+	std::string data;
+	m_Decompressor->Decompress(message.CStr() + 1, message.GetLength() - 1, data);
+	m_Decompressed->Write(data.c_str(), data.size());
+
+	String innerMessage;
+
+	while (NetString::ReadStringFromStream(m_Decompressed, &innerMessage, m_DecompressedContext) == StatusNewItem) {
+		if (!innerMessage.IsEmpty() && static_cast<unsigned char>(innerMessage[0]) == l_CompressedFrameMagic)
+			BOOST_THROW_EXCEPTION(std::invalid_argument("Compressed messages must not be nested."));
+
+		EnqueueMessage(std::move(innerMessage));
+	}
 
 	return true;
 }
 
+void JsonRpcConnection::EnqueueMessage(String&& jsonString)
+{
+	uint64_t sequence;
+
+	{
+		boost::mutex::scoped_lock lock(m_PendingMutex);
+		sequence = m_PendingSequence + m_PendingMessages.size();
+		m_PendingMessages.emplace_back();
+	}
+
+	l_JsonRpcConnectionDecodeQueue->Enqueue(std::bind(&JsonRpcConnection::DecodeMessage, JsonRpcConnection::Ptr(this), sequence, std::move(jsonString)));
+}
+
 void JsonRpcConnection::DataAvailableHandler()
 {
 	bool close = false;
@@ -333,6 +767,9 @@ size_t JsonRpcConnection::GetWorkQueueLength()
 	for (size_t i = 0; i < GetWorkQueueCount(); i++)
 		itemCount += l_JsonRpcConnectionWorkQueues[i].GetLength();
 
+	if (l_JsonRpcConnectionDecodeQueue)
+		itemCount += l_JsonRpcConnectionDecodeQueue->GetLength();
+
 	return itemCount;
 }
 
@@ -351,3 +788,33 @@ double JsonRpcConnection::GetWorkQueueRate()
 	return rate / count;
 }
 
+/**
+ * Returns the average number of arena allocations for the messages which
+ * were decoded during the last minute.
+ */
+double JsonRpcConnection::GetArenaAllocationsPerMessage()
+{
+	double now = Utility::GetTime();
+	int messages = l_ArenaMessageStats.UpdateAndGetValues(now, 60);
+
+	if (messages == 0)
+		return 0;
+
+	return static_cast<double>(l_ArenaAllocationStats.UpdateAndGetValues(now, 60)) / messages;
+}
+
+/**
+ * Returns the average number of bytes allocated from arenas for the
+ * messages which were decoded during the last minute.
+ */
+double JsonRpcConnection::GetArenaBytesPerMessage()
+{
+	double now = Utility::GetTime();
+	int messages = l_ArenaMessageStats.UpdateAndGetValues(now, 60);
+
+	if (messages == 0)
+		return 0;
+
+	return static_cast<double>(l_ArenaByteStats.UpdateAndGetValues(now, 60)) / messages;
+}
+
@@ -21,10 +21,16 @@
 #define JSONRPCCONNECTION_H
 
 #include "remote/endpoint.hpp"
+#include "remote/jsonrpc.hpp"
 #include "base/tlsstream.hpp"
 #include "base/timer.hpp"
 #include "base/workqueue.hpp"
+#include "base/fifo.hpp"
+#include "base/compression.hpp"
 #include "remote/i2-remote.hpp"
+#include <deque>
+#include <memory>
+#include <atomic>
 
 namespace icinga
 {
@@ -64,6 +70,10 @@ public:
 	TlsStream::Ptr GetStream() const;
 	ConnectionRole GetRole() const;
 
+	void SetEncoding(JsonRpcEncoding encoding);
+	void EnableCompression();
+	void AcceptCompression();
+
 	void Disconnect();
 
 	void SendMessage(const Dictionary::Ptr& request);
@@ -74,6 +84,8 @@ public:
 	static size_t GetWorkQueueCount();
 	static size_t GetWorkQueueLength();
 	static double GetWorkQueueRate();
+	static double GetArenaAllocationsPerMessage();
+	static double GetArenaBytesPerMessage();
 
 	static void SendCertificateRequest(const JsonRpcConnection::Ptr& aclient, const intrusive_ptr<MessageOrigin>& origin, const String& path);
 
@@ -88,13 +100,59 @@ private:
 	double m_Seen;
 	double m_NextHeartbeat;
 	double m_HeartbeatTimeout;
+	JsonRpcEncoding m_Encoding{JsonRpcEncodingJson};
+
+	/* Outgoing batches, protected by the stream's object lock. */
+	FIFO::Ptr m_SendBatch;
+	int m_SendBatchMessages{0};
+	double m_SendBatchStart{0};
+	double m_SendBatchDelay{0};
+	Timer::Ptr m_SendBatchTimer;
+	std::unique_ptr<StreamCompressor> m_Compressor;
+
+	/* Compressed frames are only unpacked by the thread which reads from the stream. */
+	std::atomic<bool> m_AcceptCompression{false};
+	std::unique_ptr<StreamDecompressor> m_Decompressor;
+	FIFO::Ptr m_Decompressed;
+	StreamReadContext m_DecompressedContext;
 	boost::mutex m_DataHandlerMutex;
 
 	StreamReadContext m_Context;
 
+	/**
+	 * A message which has been read from the stream and is waiting for
+	 * (or has finished) being decoded.
+	 */
+	struct PendingMessage
+	{
+		Dictionary::Ptr Message;
+		boost::exception_ptr Error;
+		size_t Size{0};
+		bool Decoded{false};
+	};
+
+	boost::mutex m_PendingMutex;
+	std::deque<PendingMessage> m_PendingMessages;
+	uint64_t m_PendingSequence{0}; /* sequence number of m_PendingMessages.front() */
+	bool m_Dispatching{false};
+
+	/* Decoded messages which haven't been handed to a work queue yet, see PumpMessages(). */
+	std::deque<Dictionary::Ptr> m_ReadyMessages;
+	size_t m_MessagesInFlight{0};
+	bool m_OrderedMessageInFlight{false};
+	bool m_Pumping{false};
+	bool m_ReadingPaused{false};
+
 	bool ProcessMessage();
-	void MessageHandlerWrapper(const String& jsonString);
-	void MessageHandler(const String& jsonString);
+	void EnqueueMessage(String&& jsonString);
+	void FlushSendBatch();
+	void SendBatchTimerHandler();
+	void DecodeMessage(uint64_t sequence, const String& jsonString);
+	void DispatchMessage(const PendingMessage& pmessage);
+	void PumpMessages();
+	size_t GetMessageQueue(const Dictionary::Ptr& message, bool *ordered) const;
+	void MessageHandlerWrapper(const Dictionary::Ptr& message, bool ordered);
+	void MessageHandler(const Dictionary::Ptr& message);
 	void DataAvailableHandler();
 
 	static void StaticInitialize();
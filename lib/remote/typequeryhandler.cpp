@@ -117,7 +117,7 @@ bool TypeQueryHandler::HandleRequest(const ApiUser::Ptr& user, HttpRequest& requ
 		if (prototype) {
 			ObjectLock olock(prototype);
 			for (const Dictionary::Pair& kv : prototype) {
-				prototypeKeys->Add(kv.first);
+				prototypeKeys->Add(kv.first.GetString());
 			}
 		}
 
@@ -0,0 +1,175 @@
+/******************************************************************************
+ * Icinga 2                                                                   *
+ * Copyright (C) 2012-2018 Icinga Development Team (https://www.icinga.com/)  *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or              *
+ * modify it under the terms of the GNU General Public License                *
+ * as published by the Free Software Foundation; either version 2             *
+ * of the License, or (at your option) any later version.                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software Foundation     *
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
+ ******************************************************************************/
+
+#include "base/arena.hpp"
+#include "base/dictionary.hpp"
+#include "base/array.hpp"
+#include "base/json.hpp"
+#include "base/convert.hpp"
+#include "base/utility.hpp"
+#include <BoostTestTargetConfig.h>
+#include <iostream>
+
+using namespace icinga;
+
+BOOST_AUTO_TEST_SUITE(base_arena)
+
+BOOST_AUTO_TEST_CASE(allocate)
+{
+	BOOST_CHECK(!Arena::GetCurrent());
+
+	Arena arena;
+
+	{
+		ArenaScope scope(arena);
+		BOOST_CHECK(Arena::GetCurrent() == &arena);
+
+		Arena inner;
+
+		{
+			ArenaScope innerScope(inner);
+			BOOST_CHECK(Arena::GetCurrent() == &inner);
+		}
+
+		BOOST_CHECK(Arena::GetCurrent() == &arena);
+
+		Dictionary::Ptr dict = ArenaNew<Dictionary>(DictionaryData{ { "a", 1 } });
+		Array::Ptr arr = ArenaNew<Array>(ArrayData{ "x", dict });
+
+		BOOST_CHECK(arr->Get(1) == dict);
+		BOOST_CHECK(Dictionary::Ptr(arr->Get(1))->Get("a") == 1);
+		BOOST_CHECK(Value(arr).IsObjectType<Array>());
+
+		/* Plain operator new doesn't use the arena. */
+		Dictionary::Ptr heap = new Dictionary();
+	}
+
+	BOOST_CHECK(!Arena::GetCurrent());
+	BOOST_CHECK(arena.GetAllocations() == 2);
+	BOOST_CHECK(arena.GetChunks() == 1);
+
+	/* Without an active scope ArenaNew() allocates from the heap. */
+	Dictionary::Ptr dict = ArenaNew<Dictionary>();
+	BOOST_CHECK(arena.GetAllocations() == 2);
+
+	/* Objects which are too large for a chunk end up on the heap. */
+	void *large = arena.Allocate(Arena::ChunkSize);
+	BOOST_CHECK(arena.GetChunks() == 1);
+	Arena::FreeObject(large);
+}
+
+BOOST_AUTO_TEST_CASE(escape)
+{
+	Dictionary::Ptr escaped;
+
+	{
+		Arena arena;
+		ArenaScope scope(arena);
+
+		for (int i = 0; i < 1000; i++) {
+			Dictionary::Ptr dict = ArenaNew<Dictionary>(DictionaryData{ { "id", i }, { "name", "object" + Convert::ToString(i) } });
+
+			if (i == 500)
+				escaped = dict;
+		}
+
+		BOOST_CHECK(arena.GetChunks() > 1);
+	}
+
+	/* The arena is gone but the object's chunk is still alive. */
+	BOOST_CHECK(escaped->Get("id") == 500);
+	BOOST_CHECK(escaped->Get("name") == "object500");
+
+	escaped->Set("tags", new Array({ "a", "b" }));
+	BOOST_CHECK(Array::Ptr(escaped->Get("tags"))->GetLength() == 2);
+
+	escaped.reset();
+}
+
+BOOST_AUTO_TEST_CASE(json)
+{
+	String message = "{\"method\":\"event::CheckResult\",\"params\":{\"cr\":{\"command\":[\"check_disk\",\"-w\",\"20%\"],"
+		"\"output\":\"DISK OK\",\"state\":0.0},\"host\":\"example.com\"}}";
+
+	Dictionary::Ptr expected = JsonDecode(message);
+	Dictionary::Ptr params;
+
+	{
+		Arena arena;
+
+		{
+			ArenaScope scope(arena);
+
+			Dictionary::Ptr result = JsonDecode(message);
+			BOOST_CHECK(JsonEncode(result) == JsonEncode(expected));
+
+			params = result->Get("params");
+		}
+
+		/* 3 dictionaries and 1 array, strings are allocated on the heap */
+		BOOST_CHECK(arena.GetAllocations() == 4);
+	}
+
+	BOOST_CHECK(JsonEncode(params) == JsonEncode(expected->Get("params")));
+}
+
+/* Not run by ctest - use '--run_test=base_arena/benchmark' to run it. */
+BOOST_AUTO_TEST_CASE(benchmark)
+{
+	String message = "{\"jsonrpc\":\"2.0\",\"method\":\"event::CheckResult\",\"params\":{\"cr\":{\"active\":true,"
+		"\"check_source\":\"satellite1.example.com\",\"command\":[\"/usr/lib/nagios/plugins/check_disk\",\"-c\","
+		"\"10%\",\"-w\",\"20%\",\"-X\",\"none\",\"-X\",\"tmpfs\",\"-X\",\"sysfs\",\"-X\",\"proc\",\"-m\"],"
+		"\"execution_end\":1517410342.3412840366,\"execution_start\":1517410342.3207230568,\"exit_status\":0.0,"
+		"\"output\":\"DISK OK - free space: / 33466 MB (74% inode=92%); /boot 382 MB (78% inode=99%);\","
+		"\"performance_data\":[\"/=11519MB;37717;42432;0;47147\",\"/boot=106MB;410;461;0;513\"],"
+		"\"state\":0.0,\"type\":\"CheckResult\",\"vars_after\":{\"attempt\":1.0,\"reachable\":true,\"state\":0.0},"
+		"\"vars_before\":{\"attempt\":1.0,\"reachable\":true,\"state\":0.0}},"
+		"\"host\":\"web-frontend-042.example.com\",\"service\":\"disk\"},\"ts\":1517410342.3425290585}";
+
+	const int count = 200000;
+
+	for (int pass = 0; pass < 2; pass++) {
+		bool useArena = (pass == 1);
+		size_t allocations = 0;
+
+		double start = Utility::GetTime();
+
+		for (int i = 0; i < count; i++) {
+			Arena arena;
+			Dictionary::Ptr result;
+
+			if (useArena) {
+				ArenaScope scope(arena);
+				result = JsonDecode(message);
+			} else
+				result = JsonDecode(message);
+
+			BOOST_REQUIRE(result);
+			allocations += arena.GetAllocations();
+		}
+
+		double duration = Utility::GetTime() - start;
+
+		std::cout << "Decoded " << count << " messages " << (useArena ? "with" : "without") << " an arena in "
+			<< duration << " seconds (" << count / duration << " messages/s, "
+			<< allocations / count << " arena allocations per message)" << std::endl;
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,81 @@
+/******************************************************************************
+ * Icinga 2                                                                   *
+ * Copyright (C) 2012-2018 Icinga Development Team (https://www.icinga.com/)  *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or              *
+ * modify it under the terms of the GNU General Public License                *
+ * as published by the Free Software Foundation; either version 2             *
+ * of the License, or (at your option) any later version.                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software Foundation     *
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
+ ******************************************************************************/
+
+
+#include "base/bufferchain.hpp"
+#include <BoostTestTargetConfig.h>
+
+using namespace icinga;
+
+BOOST_AUTO_TEST_SUITE(base_bufferchain)
+
+BOOST_AUTO_TEST_CASE(append)
+{
+	BufferChain chain;
+	BOOST_CHECK(chain.IsEmpty());
+
+	chain.Append("12:", 3);
+
+	String body(BufferChain::MinBufferSize, 'x');
+	const char *bodyData = body.CStr();
+	chain.Append(std::move(body));
+
+	chain.Append(",", 1);
+	chain.Append(String("5:"));
+	chain.Append("hello,", 6);
+
+	BOOST_CHECK(chain.GetAvailableBytes() == 3 + BufferChain::MinBufferSize + 9);
+
+	/* Small writes are coalesced, large buffers are referenced. */
+	BufferSegment segments[4];
+	BOOST_REQUIRE(chain.GetSegments(segments, 4) == 3);
+	BOOST_CHECK(segments[0].Size == 3 && memcmp(segments[0].Data, "12:", 3) == 0);
+	BOOST_CHECK(segments[1].Data == bodyData);
+	BOOST_CHECK(segments[2].Size == 9 && memcmp(segments[2].Data, ",5:hello,", 9) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(drop)
+{
+	BufferChain chain;
+
+	chain.Append("abc", 3);
+	chain.Append(String(BufferChain::MinBufferSize, 'x'));
+	chain.Append("def", 3);
+
+	char buffer[8];
+	BOOST_CHECK(chain.Peek(buffer, 5) == 5);
+	BOOST_CHECK(memcmp(buffer, "abcxx", 5) == 0);
+
+	chain.Drop(2);
+
+	BufferSegment segment;
+	BOOST_REQUIRE(chain.GetSegments(&segment, 1) == 1);
+	BOOST_CHECK(segment.Size == 1 && segment.Data[0] == 'c');
+
+	chain.Drop(1 + BufferChain::MinBufferSize + 1);
+	BOOST_CHECK(chain.GetAvailableBytes() == 2);
+	BOOST_CHECK(chain.Peek(buffer, sizeof(buffer)) == 2);
+	BOOST_CHECK(memcmp(buffer, "ef", 2) == 0);
+
+	chain.Drop(2);
+	BOOST_CHECK(chain.IsEmpty());
+	BOOST_CHECK(chain.GetSegments(&segment, 1) == 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,75 @@
+/******************************************************************************
+ * Icinga 2                                                                   *
+ * Copyright (C) 2012-2018 Icinga Development Team (https://www.icinga.com/)  *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or              *
+ * modify it under the terms of the GNU General Public License                *
+ * as published by the Free Software Foundation; either version 2             *
+ * of the License, or (at your option) any later version.                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software Foundation     *
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
+ ******************************************************************************/
+
+#include "base/compression.hpp"
+#include <BoostTestTargetConfig.h>
+
+using namespace icinga;
+
+BOOST_AUTO_TEST_SUITE(base_compression)
+
+BOOST_AUTO_TEST_CASE(roundtrip)
+{
+	if (!StreamCompressor::IsSupported())
+		return;
+
+	StreamCompressor compressor;
+	StreamDecompressor decompressor;
+
+	std::string message = "{\"jsonrpc\":\"2.0\",\"method\":\"event::CheckResult\",\"params\":{\"host\":\"example.com\"}}";
+	std::string chunk, result;
+
+	compressor.Compress(message.c_str(), message.size(), chunk);
+	size_t firstSize = chunk.size();
+	decompressor.Decompress(chunk.c_str(), chunk.size(), result);
+	BOOST_CHECK(result == message);
+
+	/* The compression state is kept between chunks. */
+	chunk.clear();
+	result.clear();
+	compressor.Compress(message.c_str(), message.size(), chunk);
+	BOOST_CHECK(chunk.size() < firstSize);
+	decompressor.Decompress(chunk.c_str(), chunk.size(), result);
+	BOOST_CHECK(result == message);
+
+	/* Chunks which are larger than the output buffer */
+	std::string data;
+
+	for (int i = 0; i < 1024 * 1024; i++)
+		data += static_cast<char>(i * 7 % 251);
+
+	chunk.clear();
+	result.clear();
+	compressor.Compress(data.c_str(), data.size(), chunk);
+	decompressor.Decompress(chunk.c_str(), chunk.size(), result);
+	BOOST_CHECK(result == data);
+}
+
+BOOST_AUTO_TEST_CASE(invalid)
+{
+	if (!StreamCompressor::IsSupported())
+		return;
+
+	StreamDecompressor decompressor;
+	std::string result;
+
+	BOOST_CHECK_THROW(decompressor.Decompress("not compressed", 14, result), std::exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
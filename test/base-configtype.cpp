@@ -0,0 +1,66 @@
+/******************************************************************************
+ * Icinga 2                                                                   *
+ * Copyright (C) 2012-2018 Icinga Development Team (https://www.icinga.com/)  *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or              *
+ * modify it under the terms of the GNU General Public License                *
+ * as published by the Free Software Foundation; either version 2             *
+ * of the License, or (at your option) any later version.                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software Foundation     *
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
+ ******************************************************************************/
+
+#include "base/configtype.hpp"
+#include "base/filelogger.hpp"
+#include <BoostTestTargetConfig.h>
+#include <algorithm>
+
+using namespace icinga;
+
+BOOST_AUTO_TEST_SUITE(base_configtype)
+
+BOOST_AUTO_TEST_CASE(snapshot)
+{
+	FileLogger::Ptr logger1 = new FileLogger();
+	logger1->SetName("configtype-test1", true);
+
+	FileLogger::Ptr logger2 = new FileLogger();
+	logger2->SetName("configtype-test2", true);
+
+	ConfigType *ctype = ConfigType::Get<FileLogger>();
+
+	auto before = ConfigType::GetObjectsByType<FileLogger>();
+	size_t count = before.size();
+
+	ctype->RegisterObject(logger1);
+
+	auto after = ConfigType::GetObjectsByType<FileLogger>();
+	BOOST_CHECK(before.size() == count);
+	BOOST_CHECK(after.size() == count + 1);
+	BOOST_CHECK(std::find(after.begin(), after.end(), logger1) != after.end());
+
+	/* Snapshots are shared until the objects change. */
+	BOOST_CHECK(ConfigType::GetObjectsByType<FileLogger>().begin() == after.begin());
+
+	ctype->RegisterObject(logger2);
+	ctype->UnregisterObject(logger1);
+
+	auto last = ConfigType::GetObjectsByType<FileLogger>();
+	BOOST_CHECK(last.size() == count + 1);
+	BOOST_CHECK(std::find(last.begin(), last.end(), logger1) == last.end());
+	BOOST_CHECK(std::find(last.begin(), last.end(), logger2) != last.end());
+
+	/* Older snapshots still see the objects they were created with. */
+	BOOST_CHECK(std::find(after.begin(), after.end(), logger1) != after.end());
+
+	ctype->UnregisterObject(logger2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -20,7 +20,10 @@
 #include "base/dictionary.hpp"
 #include "base/objectlock.hpp"
 #include "base/json.hpp"
+#include "base/convert.hpp"
+#include "base/utility.hpp"
 #include <BoostTestTargetConfig.h>
+#include <iostream>
 
 using namespace icinga;
 
@@ -178,4 +181,97 @@ BOOST_AUTO_TEST_CASE(json)
 	BOOST_CHECK(deserialized->Get("test2") == "hello world");
 }
 
+BOOST_AUTO_TEST_CASE(large)
+{
+	Dictionary::Ptr dictionary = new Dictionary();
+
+	/* Large dictionaries use a hash table and are sorted lazily. */
+	for (int i = 0; i < 1000; i++)
+		dictionary->Set("key" + Convert::ToString((i * 7919) % 1000), i);
+
+	BOOST_CHECK(dictionary->GetLength() == 1000);
+
+	for (int i = 0; i < 1000; i++)
+		BOOST_CHECK(dictionary->Get("key" + Convert::ToString((i * 7919) % 1000)) == i);
+
+	for (int i = 0; i < 1000; i += 2)
+		dictionary->Remove("key" + Convert::ToString(i));
+
+	BOOST_CHECK(dictionary->GetLength() == 500);
+	BOOST_CHECK(!dictionary->Contains("key0"));
+	BOOST_CHECK(dictionary->Contains("key1"));
+
+	dictionary->Set("key1", "updated");
+	BOOST_CHECK(dictionary->Get("key1") == "updated");
+	BOOST_CHECK(dictionary->GetLength() == 500);
+
+	{
+		ObjectLock olock(dictionary);
+
+		String last;
+		int count = 0;
+
+		for (const Dictionary::Pair& kv : dictionary) {
+			BOOST_CHECK(count == 0 || last < kv.first.GetString());
+			last = kv.first;
+			count++;
+		}
+
+		BOOST_CHECK(count == 500);
+	}
+
+	/* The encoded JSON doesn't depend on the order in which keys were added. */
+	Dictionary::Ptr other = new Dictionary();
+
+	for (int i = 999; i >= 0; i--) {
+		if (i % 2)
+			other->Set("key" + Convert::ToString(i), dictionary->Get("key" + Convert::ToString(i)));
+	}
+
+	BOOST_CHECK(JsonEncode(other) == JsonEncode(dictionary));
+	BOOST_CHECK(JsonEncode(dictionary->ShallowClone()) == JsonEncode(dictionary));
+	BOOST_CHECK(JsonEncode(JsonDecode(JsonEncode(dictionary))) == JsonEncode(dictionary));
+}
+
+/* Not run by ctest - use '--run_test=base_dictionary/benchmark' to run it. */
+BOOST_AUTO_TEST_CASE(benchmark)
+{
+	const int count = 1000000;
+	double start = Utility::GetTime();
+
+	/* The vars_before dictionary from a check result. */
+	for (int i = 0; i < count; i++) {
+		Dictionary::Ptr vars = new Dictionary();
+		vars->Set("attempt", 1);
+		vars->Set("reachable", true);
+		vars->Set("state", 0);
+		vars->Set("state_type", 1);
+
+		BOOST_CHECK(vars->Get("state_type") == 1);
+	}
+
+	double duration = Utility::GetTime() - start;
+
+	std::cout << "Created " << count << " small dictionaries in " << duration << " seconds ("
+		<< count / duration << " dictionaries/s)" << std::endl;
+
+	std::vector<String> keys;
+	Dictionary::Ptr large = new Dictionary();
+
+	for (int i = 0; i < 10000; i++) {
+		keys.push_back("host" + Convert::ToString(i) + ".example.com");
+		large->Set(keys.back(), i);
+	}
+
+	start = Utility::GetTime();
+
+	for (int i = 0; i < count; i++)
+		large->Get(keys[i % keys.size()]);
+
+	duration = Utility::GetTime() - start;
+
+	std::cout << "Performed " << count << " lookups in a dictionary with " << keys.size() << " items in "
+		<< duration << " seconds (" << count / duration << " lookups/s)" << std::endl;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
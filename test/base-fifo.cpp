@@ -19,7 +19,9 @@
 
 #include "base/fifo.hpp"
 #include "base/objectlock.hpp"
+#include "base/utility.hpp"
 #include <BoostTestTargetConfig.h>
+#include <iostream>
 
 using namespace icinga;
 
@@ -57,4 +59,67 @@ BOOST_AUTO_TEST_CASE(io)
 	fifo->Close();
 }
 
+BOOST_AUTO_TEST_CASE(blocks)
+{
+	FIFO::Ptr fifo = new FIFO();
+
+	std::string data;
+
+	for (size_t i = 0; i < 3 * FIFO::BlockSize + 100; i++)
+		data += 'a' + i % 26;
+
+	fifo->Write(data.c_str(), data.size());
+	BOOST_CHECK(fifo->GetAvailableBytes() == data.size());
+	BOOST_CHECK(FIFO::GetBufferMemory() >= 4 * FIFO::BlockSize);
+
+	std::string peeked(data.size(), '\0');
+	BOOST_CHECK(fifo->Peek(&peeked[0], peeked.size(), true) == data.size());
+	BOOST_CHECK(peeked == data);
+
+	/* Reads which cross block boundaries */
+	std::string result;
+	char buffer[5000];
+	size_t rc;
+
+	while ((rc = fifo->Read(buffer, sizeof(buffer), true)) > 0)
+		result.append(buffer, rc);
+
+	BOOST_CHECK(result == data);
+	BOOST_CHECK(fifo->GetAvailableBytes() == 0);
+
+	fifo->Write("hello", 5);
+	BOOST_CHECK(fifo->Read(buffer, sizeof(buffer), true) == 5);
+	BOOST_CHECK(memcmp(buffer, "hello", 5) == 0);
+
+	fifo->Close();
+}
+
+/* Not run by ctest - use '--run_test=base_fifo/io_benchmark' to run it. */
+BOOST_AUTO_TEST_CASE(io_benchmark)
+{
+	FIFO::Ptr fifo = new FIFO();
+
+	const size_t total = 4ULL * 1024 * 1024 * 1024;
+	const size_t backlog = 1024 * 1024;
+	char chunk[64 * 1024] = {};
+	char message[1500];
+
+	double start = Utility::GetTime();
+
+	/* 64 KiB writes, like TlsStream::OnEvent(), and message-sized reads. */
+	for (size_t written = 0; written < total; written += sizeof(chunk)) {
+		fifo->Write(chunk, sizeof(chunk));
+
+		while (fifo->GetAvailableBytes() > backlog)
+			fifo->Read(message, sizeof(message), true);
+	}
+
+	double duration = Utility::GetTime() - start;
+
+	std::cout << "Moved " << total / 1024 / 1024 << " MiB through a FIFO in " << duration
+		<< " seconds (" << total / duration / 1024 / 1024 << " MiB/s)" << std::endl;
+
+	fifo->Close();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
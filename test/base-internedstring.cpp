@@ -0,0 +1,199 @@
+/******************************************************************************
+ * Icinga 2                                                                   *
+ * Copyright (C) 2012-2018 Icinga Development Team (https://www.icinga.com/)  *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or              *
+ * modify it under the terms of the GNU General Public License                *
+ * as published by the Free Software Foundation; either version 2             *
+ * of the License, or (at your option) any later version.                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software Foundation     *
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
+ ******************************************************************************/
+
+
+#include "base/internedstring.hpp"
+#include "base/dictionary.hpp"
+#include "base/array.hpp"
+#include "base/objectlock.hpp"
+#include "base/filelogger.hpp"
+#include "base/convert.hpp"
+#include "base/utility.hpp"
+#include <BoostTestTargetConfig.h>
+#include <iostream>
+
+using namespace icinga;
+
+BOOST_AUTO_TEST_SUITE(base_internedstring)
+
+BOOST_AUTO_TEST_CASE(intern)
+{
+	InternedString empty;
+	BOOST_CHECK(empty.IsEmpty());
+	BOOST_CHECK(empty == InternedString(""));
+
+	InternedString a1("check_command");
+	InternedString a2(String("check_") + "command");
+	InternedString b("check_interval");
+
+	BOOST_CHECK(a1 == a2);
+	BOOST_CHECK(a1 != b);
+	BOOST_CHECK(a1.CStr() == a2.CStr());
+	BOOST_CHECK(a1.GetHash() == a2.GetHash());
+	BOOST_CHECK(a1.GetString() == "check_command");
+	BOOST_CHECK(a1 < b);
+
+	InternedString a3 = a1;
+	InternedString a4 = std::move(a3);
+	BOOST_CHECK(a4 == a1);
+	BOOST_CHECK(a3.IsEmpty());
+}
+
+BOOST_AUTO_TEST_CASE(sweep)
+{
+	size_t count = InternedString::GetCount();
+
+	for (int round = 0; round < 4; round++) {
+		std::vector<InternedString> strings;
+
+		for (int i = 0; i < 20000; i++)
+			strings.emplace_back("sweep-" + Convert::ToString(round) + "-" + Convert::ToString(i));
+
+		/* Strings which are still in use must not be removed. */
+		for (const InternedString& str : strings)
+			BOOST_CHECK(InternedString(str.GetString()).CStr() == str.CStr());
+	}
+
+	/* Unused strings are removed when the table grows. */
+	BOOST_CHECK(InternedString::GetCount() < count + 60000);
+
+	InternedString permanent("sweep-permanent", true);
+	BOOST_CHECK(InternedString("sweep-permanent").CStr() == permanent.CStr());
+}
+
+BOOST_AUTO_TEST_CASE(dictionary)
+{
+	Dictionary::Ptr dict1 = new Dictionary({
+		{ "address", "192.0.2.1" },
+		{ "vars", new Dictionary({ { "os", "Linux" } }) }
+	});
+
+	Dictionary::Ptr dict2 = new Dictionary();
+	dict2->Set("address", "192.0.2.2");
+
+	BOOST_CHECK(dict1->Get("address") == "192.0.2.1");
+	BOOST_CHECK(dict2->Get("address") == "192.0.2.2");
+	BOOST_CHECK(!dict2->Contains("vars"));
+
+	ObjectLock olock1(dict1);
+	ObjectLock olock2(dict2);
+
+	/* Both dictionaries share the same key. */
+	BOOST_CHECK(dict1->Begin()->first.CStr() == dict2->Begin()->first.CStr());
+}
+
+BOOST_AUTO_TEST_CASE(fieldid)
+{
+	Type::Ptr type = FileLogger::TypeInstance;
+
+	for (int i = 0; i < type->GetFieldCount(); i++) {
+		String name = type->GetFieldInfo(i).Name;
+		BOOST_CHECK(type->GetFieldId(InternedString(name)) == type->GetFieldId(name));
+	}
+
+	BOOST_CHECK(type->GetFieldId(InternedString("no_such_field")) == -1);
+}
+
+/* Not run by ctest - use '--run_test=base_internedstring/benchmark' to run it. */
+BOOST_AUTO_TEST_CASE(benchmark)
+{
+	const int hosts = 50000;
+	const int services = 10;
+
+	/* Custom vars as they'd be found in a config with 50k hosts and 500k services. */
+	size_t keyCount = InternedString::GetCount();
+	size_t keyMemory = InternedString::GetMemoryUsage();
+	size_t keys = 0, stringKeyMemory = 0;
+
+	double start = Utility::GetTime();
+
+	std::vector<Dictionary::Ptr> objects;
+	objects.reserve(hosts * (services + 1));
+
+	for (int i = 0; i < hosts; i++) {
+		String name = "web-frontend-" + Convert::ToString(i) + ".example.com";
+
+		Dictionary::Ptr disks = new Dictionary({
+			{ "disk /", new Dictionary({ { "disk_partitions", "/" } }) },
+			{ "disk /var/lib/docker", new Dictionary({ { "disk_partitions", "/var/lib/docker" } }) }
+		});
+
+		objects.push_back(new Dictionary({
+			{ "os", "Linux" },
+			{ "address", "192.0.2." + Convert::ToString(i % 256) },
+			{ "disks", disks },
+			{ "notification", new Dictionary({
+				{ "mail", new Dictionary({ { "groups", new Array({ "icingaadmins" }) } }) }
+			}) },
+			{ "monitoring_parent_zone", "master" },
+			{ "host_display_name", name }
+		}));
+
+		for (int k = 0; k < services; k++) {
+			objects.push_back(new Dictionary({
+				{ "http_vhost", name },
+				{ "http_uri", "/service" + Convert::ToString(k) },
+				{ "check_period_override", "24x7" },
+				{ "notification_interval_override", 1800 }
+			}));
+		}
+	}
+
+	double duration = Utility::GetTime() - start;
+
+	for (const Dictionary::Ptr& dict : objects) {
+		ObjectLock olock(dict);
+
+		for (const Dictionary::Pair& kv : dict) {
+			keys++;
+
+			/* A std::string only stores short strings inline. */
+			stringKeyMemory += sizeof(String);
+
+			if (kv.first.GetLength() >= sizeof(std::string))
+				stringKeyMemory += kv.first.GetLength() + 1;
+		}
+	}
+
+	std::cout << "Created " << objects.size() << " dictionaries with " << keys << " keys in "
+		<< duration << " seconds" << std::endl
+		<< "Keys use " << (keys * sizeof(InternedString) + InternedString::GetMemoryUsage() - keyMemory) / 1024
+		<< " KiB with " << InternedString::GetCount() - keyCount << " new strings in the string table, plain strings would use "
+		<< stringKeyMemory / 1024 << " KiB" << std::endl;
+
+	const int lookups = 5000000;
+	String key = "notification_interval_override";
+	size_t found = 0;
+
+	start = Utility::GetTime();
+
+	for (int i = 0; i < lookups; i++) {
+		if (objects[i % objects.size()]->Contains(key))
+			found++;
+	}
+
+	duration = Utility::GetTime() - start;
+
+	BOOST_CHECK(found > 0);
+
+	std::cout << "Performed " << lookups << " lookups in " << duration << " seconds ("
+		<< lookups / duration << " lookups/s)" << std::endl;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -20,7 +20,12 @@
 #include "base/dictionary.hpp"
 #include "base/objectlock.hpp"
 #include "base/json.hpp"
+#include "base/fifo.hpp"
+#include "base/array.hpp"
+#include "base/convert.hpp"
+#include "base/utility.hpp"
 #include <BoostTestTargetConfig.h>
+#include <iostream>
 
 using namespace icinga;
 
@@ -33,4 +38,125 @@ BOOST_AUTO_TEST_CASE(invalid1)
 	BOOST_CHECK_THROW(JsonDecode("{\"test\": \"test\""), std::exception);
 }
 
+BOOST_AUTO_TEST_CASE(leading_zeros)
+{
+	BOOST_CHECK_THROW(JsonDecode("0123"), std::exception);
+	BOOST_CHECK_THROW(JsonDecode("[-007]"), std::exception);
+	BOOST_CHECK_THROW(JsonDecode("{\"a\": 00}"), std::exception);
+
+	BOOST_CHECK(JsonDecode("0") == 0);
+	BOOST_CHECK(JsonDecode("-0.5") == -0.5);
+	BOOST_CHECK(JsonDecode("0e1") == 0);
+}
+
+BOOST_AUTO_TEST_CASE(decode)
+{
+	Dictionary::Ptr dict = JsonDecode("{ \"a\": [1, 2.5, -0.5e2, -0, 12345678901234567890, true, false, null], "
+		"\"b\": \"x\\u00e4\\n\\\"\", \"c\": {}, \"d\": [], \"b\": \"last\" }");
+	BOOST_REQUIRE(dict);
+
+	Array::Ptr arr = dict->Get("a");
+	BOOST_REQUIRE(arr && arr->GetLength() == 8);
+	BOOST_CHECK(arr->Get(0) == 1);
+	BOOST_CHECK(arr->Get(1) == 2.5);
+	BOOST_CHECK(arr->Get(2) == -50);
+	BOOST_CHECK(arr->Get(3) == 0);
+	BOOST_CHECK(arr->Get(4) == 12345678901234567890.0);
+	BOOST_CHECK(arr->Get(5).IsBoolean() && arr->Get(5).ToBool());
+	BOOST_CHECK(arr->Get(6).IsBoolean() && !arr->Get(6).ToBool());
+	BOOST_CHECK(arr->Get(7).IsEmpty());
+
+	BOOST_CHECK(dict->Get("b") == "last");
+	BOOST_CHECK(Dictionary::Ptr(dict->Get("c"))->GetLength() == 0);
+	BOOST_CHECK(Array::Ptr(dict->Get("d"))->GetLength() == 0);
+
+	BOOST_CHECK(JsonDecode("\"x\\u00e4\\n\\\"\"") == "x\xc3\xa4\n\"");
+	BOOST_CHECK(JsonDecode("\"\\ud83d\\ude00\"") == "\xf0\x9f\x98\x80");
+	BOOST_CHECK(JsonDecode(" 42 ") == 42);
+
+	/* comments are handled by the yajl parser */
+	Array::Ptr commented = JsonDecode("/* comment */ [ 1, // comment\n 2 ]");
+	BOOST_REQUIRE(commented && commented->GetLength() == 2);
+	BOOST_CHECK(commented->Get(1) == 2);
+
+	BOOST_CHECK_THROW(JsonDecode("[1, 2,]"), std::exception);
+	BOOST_CHECK_THROW(JsonDecode("[1] [2]"), std::exception);
+	BOOST_CHECK_THROW(JsonDecode("\"a\tb\""), std::exception);
+}
+
+BOOST_AUTO_TEST_CASE(encode_stream)
+{
+	Dictionary::Ptr dict = new Dictionary({
+		{ "string", "test" },
+		{ "number", 7 },
+		{ "array", new Array({ 1, "two", Empty }) }
+	});
+
+	FIFO::Ptr fifo = new FIFO();
+	JsonEncode(dict, fifo);
+
+	String expected = JsonEncode(dict);
+
+	BOOST_CHECK(fifo->GetAvailableBytes() == expected.GetLength());
+
+	std::string result(fifo->GetAvailableBytes(), '\0');
+	fifo->Read(&result[0], result.size(), true);
+
+	BOOST_CHECK(result == expected.GetData());
+}
+
+BOOST_AUTO_TEST_CASE(encode_chunked)
+{
+	Array::Ptr arr = new Array();
+
+	for (int i = 0; i < 100000; i++)
+		arr->Add("item" + Convert::ToString(i));
+
+	std::string result;
+	int chunks = 0;
+
+	JsonEncode(arr, [&result, &chunks](const char *data, size_t count) {
+		BOOST_CHECK(count > 0 && count <= 64 * 1024);
+		result.append(data, count);
+		chunks++;
+	});
+
+	BOOST_CHECK(chunks > 1);
+	BOOST_CHECK(result == JsonEncode(arr).GetData());
+}
+
+/* A recorded event::CheckResult cluster message. */
+static const char *l_CheckResultMessage =
+	"{\"jsonrpc\":\"2.0\",\"method\":\"event::CheckResult\",\"params\":{\"cr\":{\"active\":true,"
+	"\"check_source\":\"satellite1.example.com\",\"command\":[\"/usr/lib/nagios/plugins/check_disk\",\"-c\","
+	"\"10%\",\"-w\",\"20%\",\"-X\",\"none\",\"-X\",\"tmpfs\",\"-X\",\"sysfs\",\"-X\",\"proc\",\"-m\"],"
+	"\"execution_end\":1517410342.3412840366,\"execution_start\":1517410342.3207230568,\"exit_status\":0.0,"
+	"\"output\":\"DISK OK - free space: / 33466 MB (74% inode=92%); /boot 382 MB (78% inode=99%);\","
+	"\"performance_data\":[\"/=11519MB;37717;42432;0;47147\",\"/boot=106MB;410;461;0;513\","
+	"\"/var/lib/docker=11519MB;37717;42432;0;47147\"],\"schedule_end\":1517410342.3413319588,"
+	"\"schedule_start\":1517410342.3200001717,\"state\":0.0,\"type\":\"CheckResult\","
+	"\"vars_after\":{\"attempt\":1.0,\"reachable\":true,\"state\":0.0,\"state_type\":1.0},"
+	"\"vars_before\":{\"attempt\":1.0,\"reachable\":true,\"state\":0.0,\"state_type\":1.0}},"
+	"\"host\":\"web-frontend-042.example.com\",\"service\":\"disk\"},\"ts\":1517410342.3425290585}";
+
+/* Not run by ctest - use '--run_test=base_json/decode_benchmark' to run it. */
+BOOST_AUTO_TEST_CASE(decode_benchmark)
+{
+	String message = l_CheckResultMessage;
+	const int count = 200000;
+
+	double start = Utility::GetTime();
+
+	for (int i = 0; i < count; i++) {
+		Dictionary::Ptr result = JsonDecode(message);
+		BOOST_REQUIRE(result);
+	}
+
+	double duration = Utility::GetTime() - start;
+
+	std::cout << "Decoded " << count << " event::CheckResult messages in " << duration
+		<< " seconds (" << count / duration << " messages/s, "
+		<< message.GetLength() * count / duration / 1024 / 1024 << " MiB/s)" << std::endl;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,85 @@
+/******************************************************************************
+ * Icinga 2                                                                   *
+ * Copyright (C) 2012-2018 Icinga Development Team (https://www.icinga.com/)  *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or              *
+ * modify it under the terms of the GNU General Public License                *
+ * as published by the Free Software Foundation; either version 2             *
+ * of the License, or (at your option) any later version.                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software Foundation     *
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
+ ******************************************************************************/
+
+#include "base/mpscqueue.hpp"
+#include <BoostTestTargetConfig.h>
+#include <thread>
+
+using namespace icinga;
+
+BOOST_AUTO_TEST_SUITE(base_mpscqueue)
+
+BOOST_AUTO_TEST_CASE(order)
+{
+	MpscQueue<int> queue;
+
+	BOOST_CHECK(queue.IsEmpty());
+	BOOST_CHECK(queue.Push(1));
+	BOOST_CHECK(!queue.Push(2));
+	BOOST_CHECK(!queue.Push(3));
+	BOOST_CHECK(!queue.IsEmpty());
+
+	std::vector<int> items;
+	queue.PopAll(items);
+
+	BOOST_CHECK(queue.IsEmpty());
+	BOOST_CHECK(items.size() == 3);
+	BOOST_CHECK(items[0] == 1);
+	BOOST_CHECK(items[1] == 2);
+	BOOST_CHECK(items[2] == 3);
+
+	BOOST_CHECK(queue.Push(4));
+	queue.PopAll(items);
+
+	BOOST_CHECK(items.size() == 4);
+	BOOST_CHECK(items[3] == 4);
+}
+
+BOOST_AUTO_TEST_CASE(producers)
+{
+	MpscQueue<std::pair<int, int> > queue;
+	std::vector<std::thread> threads;
+
+	for (int i = 0; i < 4; i++) {
+		threads.emplace_back([&queue, i]() {
+			for (int k = 0; k < 10000; k++)
+				queue.Push(std::make_pair(i, k));
+		});
+	}
+
+	std::vector<std::pair<int, int> > items;
+
+	while (items.size() < 40000)
+		queue.PopAll(items);
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	/* Items from the same producer must stay in order. */
+	int next[4] = { 0, 0, 0, 0 };
+
+	for (const auto& item : items) {
+		BOOST_CHECK(item.second == next[item.first]);
+		next[item.first] = item.second + 1;
+	}
+
+	BOOST_CHECK(queue.IsEmpty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
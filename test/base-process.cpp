@@ -0,0 +1,150 @@
+/******************************************************************************
+ * Icinga 2                                                                   *
+ * Copyright (C) 2012-2018 Icinga Development Team (https://www.icinga.com/)  *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or              *
+ * modify it under the terms of the GNU General Public License                *
+ * as published by the Free Software Foundation; either version 2             *
+ * of the License, or (at your option) any later version.                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software Foundation     *
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
+ ******************************************************************************/
+
+
+#include "base/process.hpp"
+#include "base/utility.hpp"
+#include <boost/thread/condition_variable.hpp>
+#include <BoostTestTargetConfig.h>
+#include <iostream>
+
+using namespace icinga;
+
+#ifndef _WIN32
+struct ProcessWaiter
+{
+	boost::mutex Mutex;
+	boost::condition_variable CV;
+	std::vector<ProcessResult> Results;
+	int Running{0};
+
+	void Run(const Process::Arguments& arguments, const Dictionary::Ptr& extraEnvironment = nullptr)
+	{
+		Process::Ptr process = new Process(arguments, extraEnvironment);
+
+		{
+			boost::mutex::scoped_lock lock(Mutex);
+			Running++;
+		}
+
+		process->Run(std::bind(&ProcessWaiter::Callback, this, _1));
+	}
+
+	void Callback(const ProcessResult& pr)
+	{
+		boost::mutex::scoped_lock lock(Mutex);
+		Results.push_back(pr);
+		Running--;
+		CV.notify_all();
+	}
+
+	void Wait(int maxRunning = 0)
+	{
+		boost::mutex::scoped_lock lock(Mutex);
+
+		while (Running > maxRunning)
+			CV.wait(lock);
+	}
+};
+#endif /* _WIN32 */
+
+BOOST_AUTO_TEST_SUITE(base_process)
+
+#ifndef _WIN32
+BOOST_AUTO_TEST_CASE(run)
+{
+	ProcessWaiter waiter;
+	waiter.Run({ "echo", "hello", "world" });
+	waiter.Wait();
+
+	BOOST_REQUIRE(waiter.Results.size() == 1);
+	BOOST_CHECK(waiter.Results[0].ExitStatus == 0);
+	BOOST_CHECK(waiter.Results[0].Output == "hello world\n");
+}
+
+BOOST_AUTO_TEST_CASE(environment)
+{
+	ProcessWaiter waiter;
+	waiter.Run({ "sh", "-c", "echo $ICINGA_TEST_VAR $LC_NUMERIC; exit 3" }, new Dictionary({
+		{ "ICINGA_TEST_VAR", "foo" }
+	}));
+	waiter.Wait();
+
+	BOOST_REQUIRE(waiter.Results.size() == 1);
+	BOOST_CHECK(waiter.Results[0].ExitStatus == 3);
+	BOOST_CHECK(waiter.Results[0].Output == "foo C\n");
+}
+
+BOOST_AUTO_TEST_CASE(embedded_nul)
+{
+	/* Strings are truncated at the first NUL rather than split into two. */
+	std::string argument("a\0ICINGA_INJECTED_VAR=bar", 25);
+
+	ProcessWaiter waiter;
+	waiter.Run({ "sh", "-c", "echo \"$1\" \"$ICINGA_INJECTED_VAR\" $ICINGA_TEST_VAR", "sh", argument }, new Dictionary({
+		{ "ICINGA_TEST_VAR", "foo" }
+	}));
+	waiter.Wait();
+
+	BOOST_REQUIRE(waiter.Results.size() == 1);
+	BOOST_CHECK(waiter.Results[0].ExitStatus == 0);
+	BOOST_CHECK(waiter.Results[0].Output == "a  foo\n");
+}
+
+BOOST_AUTO_TEST_CASE(parallel)
+{
+	ProcessWaiter waiter;
+
+	for (int i = 0; i < 32; i++)
+		waiter.Run({ "true" });
+
+	waiter.Wait();
+
+	BOOST_CHECK(waiter.Results.size() == 32);
+
+	for (const ProcessResult& pr : waiter.Results)
+		BOOST_CHECK(pr.ExitStatus == 0);
+}
+
+/* Not run by ctest - use '--run_test=base_process/spawn_benchmark' to
+ * compare the spawn throughput of different builds. */
+BOOST_AUTO_TEST_CASE(spawn_benchmark)
+{
+	const int count = 100000;
+
+	ProcessWaiter waiter;
+	double start = Utility::GetTime();
+
+	for (int i = 0; i < count; i++) {
+		waiter.Wait(64);
+		waiter.Run({ "/bin/true" });
+	}
+
+	waiter.Wait();
+
+	double duration = Utility::GetTime() - start;
+
+	std::cout << "Spawned " << count << " processes in " << duration << " seconds ("
+		<< count / duration << " processes/s)" << std::endl;
+
+	BOOST_CHECK(waiter.Results.size() == count);
+}
+#endif /* _WIN32 */
+
+BOOST_AUTO_TEST_SUITE_END()
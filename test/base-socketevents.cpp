@@ -0,0 +1,130 @@
+/******************************************************************************
+ * Icinga 2                                                                   *
+ * Copyright (C) 2012-2018 Icinga Development Team (https://www.icinga.com/)  *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or              *
+ * modify it under the terms of the GNU General Public License                *
+ * as published by the Free Software Foundation; either version 2             *
+ * of the License, or (at your option) any later version.                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software Foundation     *
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
+ ******************************************************************************/
+
+#include "base/socketevents.hpp"
+#include "base/scriptglobal.hpp"
+#include "base/convert.hpp"
+#include "base/utility.hpp"
+#include <BoostTestTargetConfig.h>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <vector>
+
+using namespace icinga;
+
+/**
+ * Reads everything from a socket and remembers that it did so.
+ */
+class TestSocketEvents final : public SocketEvents
+{
+public:
+	TestSocketEvents(const Socket::Ptr& socket)
+		: SocketEvents(socket, socket.get()), m_Socket(socket)
+	{ }
+
+	void OnEvent(int revents) override
+	{
+		if (!(revents & POLLIN))
+			return;
+
+		char buffer[512];
+
+		while (recv(m_Socket->GetFD(), buffer, sizeof(buffer), 0) > 0)
+			; /* empty loop body */
+
+		boost::mutex::scoped_lock lock(m_Mutex);
+		m_Readable = true;
+		m_CV.notify_all();
+	}
+
+	bool WaitReadable(double timeout)
+	{
+		boost::mutex::scoped_lock lock(m_Mutex);
+		boost::system_time const deadline = boost::get_system_time() + boost::posix_time::milliseconds(timeout * 1000);
+
+		while (!m_Readable) {
+			if (!m_CV.timed_wait(lock, deadline))
+				return m_Readable;
+		}
+
+		return true;
+	}
+
+private:
+	Socket::Ptr m_Socket;
+	boost::mutex m_Mutex;
+	boost::condition_variable m_CV;
+	bool m_Readable{false};
+};
+
+struct SocketEventsPair
+{
+	Socket::Ptr Peer;
+	std::unique_ptr<TestSocketEvents> Events;
+};
+
+static SocketEventsPair MakeSocketEventsPair()
+{
+	SOCKET fds[2];
+	Socket::SocketPair(fds);
+
+	Utility::SetNonBlockingSocket(fds[0]);
+
+	SocketEventsPair pair;
+	pair.Peer = new Socket(fds[1]);
+	pair.Events.reset(new TestSocketEvents(new Socket(fds[0])));
+	pair.Events->ChangeEvents(POLLIN);
+
+	return pair;
+}
+
+BOOST_AUTO_TEST_SUITE(base_socketevents)
+
+BOOST_AUTO_TEST_CASE(unregister)
+{
+	/* Make sure the engine is running so that we know its number of threads. */
+	SocketEvents::GetStats();
+
+	int threadCount = Convert::ToLong(ScriptGlobal::Get("EventEngineThreads"));
+
+	for (int round = 0; round < 100; round++) {
+		/* Sockets are spread over all threads, so the reader shares its thread
+		 * with one of the sockets which are closed. */
+		std::vector<SocketEventsPair> closed;
+
+		for (int i = 0; i < threadCount; i++)
+			closed.push_back(MakeSocketEventsPair());
+
+		SocketEventsPair reader = MakeSocketEventsPair();
+
+		/* The data arrives while the other sockets are removed. */
+		reader.Peer->Write("x", 1);
+
+		for (SocketEventsPair& pair : closed)
+			pair.Events->Unregister();
+
+		bool readable = reader.Events->WaitReadable(5);
+
+		reader.Events->Unregister();
+
+		BOOST_REQUIRE_MESSAGE(readable, "The reader missed its event in round " << round);
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
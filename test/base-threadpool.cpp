@@ -0,0 +1,121 @@
+/******************************************************************************
+ * Icinga 2                                                                   *
+ * Copyright (C) 2012-2018 Icinga Development Team (https://www.icinga.com/)  *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or              *
+ * modify it under the terms of the GNU General Public License                *
+ * as published by the Free Software Foundation; either version 2             *
+ * of the License, or (at your option) any later version.                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software Foundation     *
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
+ ******************************************************************************/
+
+#include "base/threadpool.hpp"
+#include "base/utility.hpp"
+#include <BoostTestTargetConfig.h>
+#include <atomic>
+#include <iostream>
+
+using namespace icinga;
+
+static void WaitForCount(const std::atomic<int>& counter, int count)
+{
+	for (int i = 0; i < 1000 && counter < count; i++)
+		Utility::Sleep(0.01);
+}
+
+BOOST_AUTO_TEST_SUITE(base_threadpool)
+
+BOOST_AUTO_TEST_CASE(post)
+{
+	ThreadPool tp;
+	std::atomic<int> counter(0);
+
+	for (int i = 0; i < 10000; i++)
+		BOOST_CHECK(tp.Post([&counter]() { counter++; }));
+
+	WaitForCount(counter, 10000);
+	BOOST_CHECK(counter == 10000);
+
+	tp.Stop();
+}
+
+BOOST_AUTO_TEST_CASE(nested)
+{
+	ThreadPool tp;
+	std::atomic<int> counter(0);
+
+	for (int i = 0; i < 100; i++) {
+		tp.Post([&tp, &counter]() {
+			for (int k = 0; k < 100; k++)
+				tp.Post([&counter]() { counter++; });
+		});
+	}
+
+	WaitForCount(counter, 10000);
+	BOOST_CHECK(counter == 10000);
+
+	tp.Stop();
+}
+
+BOOST_AUTO_TEST_CASE(stop)
+{
+	ThreadPool tp;
+	std::atomic<int> counter(0);
+
+	for (int i = 0; i < 1000; i++)
+		tp.Post([&counter]() { counter++; });
+
+	/* Stop() processes all remaining work items. */
+	tp.Stop();
+	BOOST_CHECK(counter == 1000);
+
+	tp.Start();
+	BOOST_CHECK(tp.Post([&counter]() { counter++; }));
+	WaitForCount(counter, 1001);
+	BOOST_CHECK(counter == 1001);
+
+	tp.Stop();
+}
+
+/* Not run by ctest - use '--run_test=base_threadpool/post_benchmark' to run it. */
+BOOST_AUTO_TEST_CASE(post_benchmark)
+{
+	ThreadPool tp;
+	std::atomic<int> counter(0);
+	const int producers = 4;
+	const int count = 250000;
+
+	double start = Utility::GetTime();
+
+	std::vector<std::thread> threads;
+
+	for (int i = 0; i < producers; i++) {
+		threads.emplace_back([&tp, &counter]() {
+			for (int k = 0; k < count; k++)
+				tp.Post([&counter]() { counter++; });
+		});
+	}
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	while (counter < producers * count)
+		Utility::Sleep(0.001);
+
+	double duration = Utility::GetTime() - start;
+
+	std::cout << "Processed " << producers * count << " work items in " << duration
+		<< " seconds (" << producers * count / duration << " items/s)" << std::endl;
+
+	tp.Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
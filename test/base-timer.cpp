@@ -75,4 +75,34 @@ BOOST_AUTO_TEST_CASE(scope)
 	BOOST_CHECK(counter >= 4 && counter <= 6);
 }
 
+BOOST_AUTO_TEST_CASE(resolution)
+{
+	std::vector<Timer::Ptr> timers;
+	int counters[50];
+
+	for (int i = 0; i < 50; i++) {
+		counters[i] = 0;
+
+		Timer::Ptr timer = new Timer();
+		timer->OnTimerExpired.connect(std::bind(&Callback, &counters[i]));
+		timer->SetInterval(0.01);
+		timer->Start();
+		timers.push_back(timer);
+	}
+
+	Utility::Sleep(1);
+
+	for (const Timer::Ptr& timer : timers)
+		timer->Stop(true);
+
+	/* Each timer should have been called roughly 100 times. */
+	for (int counter : counters)
+		BOOST_CHECK(counter >= 50 && counter <= 101);
+
+	Dictionary::Ptr stats = Timer::GetStats();
+	BOOST_CHECK(stats->Get("calls") >= 2500);
+	BOOST_CHECK(stats->Get("avg_lateness") >= 0);
+	BOOST_CHECK(stats->Get("max_lateness") >= stats->Get("avg_lateness"));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
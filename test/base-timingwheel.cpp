@@ -0,0 +1,227 @@
+/******************************************************************************
+ * Icinga 2                                                                   *
+ * Copyright (C) 2012-2018 Icinga Development Team (https://www.icinga.com/)  *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or              *
+ * modify it under the terms of the GNU General Public License                *
+ * as published by the Free Software Foundation; either version 2             *
+ * of the License, or (at your option) any later version.                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software Foundation     *
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
+ ******************************************************************************/
+
+
+#include "base/timingwheel.hpp"
+#include "base/utility.hpp"
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <BoostTestTargetConfig.h>
+#include <iostream>
+
+using namespace icinga;
+
+BOOST_AUTO_TEST_SUITE(base_timingwheel)
+
+BOOST_AUTO_TEST_CASE(order)
+{
+	TimingWheel<int> wheel(1000, 0.1, 16);
+
+	wheel.Insert(1, 1000.75);
+	wheel.Insert(2, 1000.2);
+	wheel.Insert(3, 1000.51);
+
+	BOOST_CHECK(wheel.GetSize() == 3);
+
+	int item;
+	double deadline;
+
+	BOOST_CHECK(wheel.GetNext(1000, &item, &deadline));
+	BOOST_CHECK(item == 2);
+	BOOST_CHECK(deadline == 1000.2);
+	BOOST_CHECK(wheel.Erase(2));
+	BOOST_CHECK(!wheel.Erase(2));
+
+	BOOST_CHECK(wheel.GetNext(1000, &item, &deadline));
+	BOOST_CHECK(item == 3);
+	wheel.Erase(3);
+
+	BOOST_CHECK(wheel.GetNext(1000, &item, &deadline));
+	BOOST_CHECK(item == 1);
+	wheel.Erase(1);
+
+	BOOST_CHECK(!wheel.GetNext(1000, &item, &deadline));
+	BOOST_CHECK(wheel.GetSize() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(reschedule)
+{
+	TimingWheel<int> wheel(1000, 0.1, 16);
+
+	wheel.Insert(1, 1000.3);
+	wheel.Insert(2, 1000.5);
+	wheel.Insert(1, 1000.7);
+
+	BOOST_CHECK(wheel.GetSize() == 2);
+	BOOST_CHECK(wheel.Contains(1));
+
+	int item;
+	double deadline;
+
+	BOOST_CHECK(wheel.GetNext(1000, &item, &deadline));
+	BOOST_CHECK(item == 2);
+
+	/* items which are already due are returned first */
+	wheel.Insert(1, 900);
+
+	BOOST_CHECK(wheel.GetNext(1000, &item, &deadline));
+	BOOST_CHECK(item == 1);
+	BOOST_CHECK(deadline == 900);
+}
+
+BOOST_AUTO_TEST_CASE(overflow)
+{
+	/* the horizon for this wheel is 1.6 seconds */
+	TimingWheel<int> wheel(1000, 0.1, 16);
+
+	wheel.Insert(1, 1010);
+	wheel.Insert(2, 1005);
+	wheel.Insert(3, 1001);
+
+	int item;
+	double deadline;
+
+	BOOST_CHECK(wheel.GetNext(1000, &item, &deadline));
+	BOOST_CHECK(item == 3);
+	wheel.Erase(3);
+
+	BOOST_CHECK(wheel.GetNext(1001, &item, &deadline));
+	BOOST_CHECK(item == 2);
+
+	/* advance the wheel; item 2 is moved into the wheel once it is within the horizon */
+	BOOST_CHECK(wheel.GetNext(1004, &item, &deadline));
+	BOOST_CHECK(item == 2);
+
+	wheel.Insert(4, 1004.5);
+
+	BOOST_CHECK(wheel.GetNext(1004, &item, &deadline));
+	BOOST_CHECK(item == 4);
+	wheel.Erase(4);
+
+	BOOST_CHECK(wheel.GetNext(1006, &item, &deadline));
+	BOOST_CHECK(item == 2);
+	wheel.Erase(2);
+
+	BOOST_CHECK(wheel.GetNext(1006, &item, &deadline));
+	BOOST_CHECK(item == 1);
+}
+
+BOOST_AUTO_TEST_CASE(sparse)
+{
+	/* same layout as the timer shards: the horizon is 4.096 seconds */
+	TimingWheel<int> wheel(1000, 0.001, 4096);
+
+	wheel.Insert(1, 1003.9);
+	wheel.Insert(2, 1000.07);
+
+	int item;
+	double deadline;
+
+	BOOST_CHECK(wheel.GetNext(1000, &item, &deadline));
+	BOOST_CHECK(item == 2);
+	wheel.Erase(2);
+
+	BOOST_CHECK(wheel.GetNext(1003.5, &item, &deadline));
+	BOOST_CHECK(item == 1);
+
+	/* this item's slot is before the cursor's slot */
+	wheel.Insert(3, 1005);
+
+	BOOST_CHECK(wheel.GetNext(1003.5, &item, &deadline));
+	BOOST_CHECK(item == 1);
+	wheel.Erase(1);
+
+	BOOST_CHECK(wheel.GetNext(1003.5, &item, &deadline));
+	BOOST_CHECK(item == 3);
+	BOOST_CHECK(deadline == 1005);
+	wheel.Erase(3);
+
+	BOOST_CHECK(!wheel.GetNext(1003.5, &item, &deadline));
+}
+
+struct ScheduleInfo
+{
+	int Item;
+	double Deadline;
+};
+
+typedef boost::multi_index_container<
+	ScheduleInfo,
+	boost::multi_index::indexed_by<
+		boost::multi_index::ordered_unique<boost::multi_index::member<ScheduleInfo, int, &ScheduleInfo::Item> >,
+		boost::multi_index::ordered_non_unique<boost::multi_index::member<ScheduleInfo, double, &ScheduleInfo::Deadline> >
+	>
+> ScheduleSet;
+
+/* Not run by ctest - use '--run_test=base_timingwheel/schedule_benchmark' to
+ * compare the timing wheel with the ordered set used by the checker. */
+BOOST_AUTO_TEST_CASE(schedule_benchmark)
+{
+	const int count = 1000000;
+	const int rounds = 3000000;
+
+	std::vector<double> intervals;
+
+	for (int i = 0; i < count; i++)
+		intervals.push_back(10 + Utility::Random() % 600);
+
+	double start = Utility::GetTime();
+
+	{
+		ScheduleSet set;
+
+		for (int i = 0; i < count; i++)
+			set.insert({ i, intervals[i] * (Utility::Random() % 1000) / 1000.0 });
+
+		auto& idx = boost::get<1>(set);
+
+		for (int i = 0; i < rounds; i++) {
+			ScheduleInfo si = *idx.begin();
+			set.erase(si.Item);
+			set.insert({ si.Item, si.Deadline + intervals[si.Item] });
+		}
+	}
+
+	double orderedDuration = Utility::GetTime() - start;
+
+	start = Utility::GetTime();
+
+	{
+		TimingWheel<int> wheel(0);
+
+		for (int i = 0; i < count; i++)
+			wheel.Insert(i, intervals[i] * (Utility::Random() % 1000) / 1000.0);
+
+		double now = 0;
+
+		for (int i = 0; i < rounds; i++) {
+			int item;
+			wheel.GetNext(now, &item, &now);
+			wheel.Insert(item, now + intervals[item]);
+		}
+	}
+
+	double wheelDuration = Utility::GetTime() - start;
+
+	std::cout << "Rescheduled " << count << " items " << rounds << " times: ordered set "
+		<< orderedDuration << " seconds, timing wheel " << wheelDuration << " seconds" << std::endl;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,292 @@
+/******************************************************************************
+ * Icinga 2                                                                   *
+ * Copyright (C) 2012-2018 Icinga Development Team (https://www.icinga.com/)  *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or              *
+ * modify it under the terms of the GNU General Public License                *
+ * as published by the Free Software Foundation; either version 2             *
+ * of the License, or (at your option) any later version.                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software Foundation     *
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
+ ******************************************************************************/
+
+
+#include "base/tlsstream.hpp"
+#include "base/netstring.hpp"
+#include "base/scriptglobal.hpp"
+#include "base/fifo.hpp"
+#include "base/tlsutility.hpp"
+#include "base/socket.hpp"
+#include "base/utility.hpp"
+#include <BoostTestTargetConfig.h>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+using namespace icinga;
+
+struct TlsStreamPair
+{
+	TlsStream::Ptr Client;
+	TlsStream::Ptr Server;
+};
+
+static std::shared_ptr<SSL_CTX> GetSSLContext()
+{
+	static std::shared_ptr<SSL_CTX> context;
+
+	if (!context) {
+		std::fstream fp;
+		String path = Utility::CreateTempFile("icinga2-tlsstream-XXXXXX", 0600, fp);
+		fp.close();
+
+		String keyfile = path + ".key";
+		String certfile = path + ".crt";
+
+		MakeX509CSR("localhost", keyfile, String(), certfile);
+		context = MakeSSLContext(certfile, keyfile);
+
+		(void) unlink(keyfile.CStr());
+		(void) unlink(certfile.CStr());
+		(void) unlink(path.CStr());
+	}
+
+	return context;
+}
+
+/* The I/O thread keeps signalling new data until the receive queue is empty,
+ * i.e. readers have to consume all available data. */
+static void ReadAll(const TlsStream::Ptr& stream, std::string& data, size_t count)
+{
+	char buffer[64 * 1024];
+
+	while (data.size() < count) {
+		stream->WaitForData();
+		data.append(buffer, stream->Read(buffer, std::min(sizeof(buffer), count - data.size()), true));
+	}
+}
+
+static TlsStreamPair MakeTlsStreamPair()
+{
+	SOCKET fds[2];
+	Socket::SocketPair(fds);
+
+	TlsStreamPair pair;
+	pair.Server = new TlsStream(new Socket(fds[0]), String(), RoleServer, GetSSLContext());
+	pair.Client = new TlsStream(new Socket(fds[1]), "localhost", RoleClient, GetSSLContext());
+
+	TlsStream::Ptr server = pair.Server;
+	std::thread handshake([server]() { server->Handshake(); });
+	pair.Client->Handshake();
+	handshake.join();
+
+	/* Let the client finish reading the post-handshake messages. */
+	std::string ping;
+	pair.Server->Write("P", 1);
+	ReadAll(pair.Client, ping, 1);
+
+	return pair;
+}
+
+BOOST_AUTO_TEST_SUITE(base_tlsstream)
+
+BOOST_AUTO_TEST_CASE(loopback)
+{
+	TlsStreamPair pair = MakeTlsStreamPair();
+
+	std::thread writer([&pair]() {
+		for (int i = 0; i < 1000; i++) {
+			char message[100];
+			memset(message, 'a' + i % 26, sizeof(message));
+			pair.Client->Write(message, sizeof(message));
+		}
+	});
+
+	std::string data;
+	ReadAll(pair.Server, data, 1000 * 100);
+
+	writer.join();
+
+	BOOST_REQUIRE(data.size() == 1000 * 100);
+
+	for (int i = 0; i < 1000; i++)
+		BOOST_CHECK(data[i * 100] == 'a' + i % 26 && data[i * 100 + 99] == 'a' + i % 26);
+
+	pair.Client->Close();
+	pair.Server->Close();
+}
+
+BOOST_AUTO_TEST_CASE(buffer_limit)
+{
+	ScriptGlobal::Set("MaxConnectionBufferSize", 64 * 1024);
+	TlsStreamPair pair = MakeTlsStreamPair();
+	ScriptGlobal::Set("MaxConnectionBufferSize", Empty);
+
+	std::string message;
+
+	for (int i = 0; i < 4 * 1024 * 1024; i++)
+		message += 'a' + i % 26;
+
+	/* A single write is accepted even if it exceeds the limit. */
+	pair.Client->Write(message.c_str(), message.size());
+
+	/* The server stops reading from the socket while nobody consumes its receive queue. */
+	Utility::Sleep(0.5);
+	BOOST_CHECK(FIFO::GetBufferMemory() < 1024 * 1024);
+
+	std::string data;
+	ReadAll(pair.Server, data, message.size());
+	BOOST_CHECK(data == message);
+
+	pair.Client->Close();
+	pair.Server->Close();
+}
+
+BOOST_AUTO_TEST_CASE(send_queue_limit)
+{
+	ScriptGlobal::Set("MaxConnectionBufferSize", 64 * 1024);
+	TlsStreamPair pair = MakeTlsStreamPair();
+	ScriptGlobal::Set("MaxConnectionBufferSize", Empty);
+
+	const int count = 1000;
+	const size_t size = 4 * 1024;
+
+	std::atomic<bool> done(false);
+
+	std::thread writer([&pair, &done]() {
+		for (int i = 0; i < count; i++) {
+			char message[size];
+			memset(message, 'a' + i % 26, sizeof(message));
+			pair.Client->Write(message, sizeof(message));
+		}
+
+		done = true;
+	});
+
+	/* The writer waits for the server to read the data. */
+	Utility::Sleep(0.5);
+	BOOST_CHECK(!done);
+
+	std::string data;
+	ReadAll(pair.Server, data, count * size);
+
+	writer.join();
+
+	BOOST_REQUIRE(data.size() == count * size);
+
+	for (int i = 0; i < count; i++)
+		BOOST_CHECK(data[i * size] == 'a' + i % 26 && data[i * size + size - 1] == 'a' + i % 26);
+
+	pair.Client->Close();
+	pair.Server->Close();
+}
+
+/* Not run by ctest - use '--run_test=base_tlsstream/loopback_benchmark' to run it. */
+BOOST_AUTO_TEST_CASE(loopback_benchmark)
+{
+	const int pairCount = 16;
+	const int messageCount = 20000;
+	const size_t messageSize = 512;
+
+	std::vector<TlsStreamPair> pairs;
+
+	for (int i = 0; i < pairCount; i++)
+		pairs.push_back(MakeTlsStreamPair());
+
+	double start = Utility::GetTime();
+
+	std::vector<std::thread> threads;
+
+	for (const TlsStreamPair& pair : pairs) {
+		TlsStream::Ptr client = pair.Client;
+		TlsStream::Ptr server = pair.Server;
+
+		threads.emplace_back([client]() {
+			char message[messageSize] = {};
+
+			for (int i = 0; i < messageCount; i++)
+				client->Write(message, sizeof(message));
+		});
+
+		threads.emplace_back([server]() {
+			std::string data;
+			ReadAll(server, data, messageCount * messageSize);
+		});
+	}
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	double duration = Utility::GetTime() - start;
+
+	std::cout << "Sent " << pairCount * messageCount << " messages through " << pairCount
+		<< " TLS stream pairs in " << duration << " seconds ("
+		<< pairCount * messageCount / duration << " messages/s)" << std::endl;
+
+	for (const TlsStreamPair& pair : pairs) {
+		pair.Client->Close();
+		pair.Server->Close();
+	}
+}
+
+/* Not run by ctest - use '--run_test=base_tlsstream/netstring_benchmark' to run it. */
+BOOST_AUTO_TEST_CASE(netstring_benchmark)
+{
+	const int pairCount = 4;
+	const int messageCount = 20000;
+
+	for (size_t messageSize : { 1024, 8192 }) {
+		std::vector<TlsStreamPair> pairs;
+
+		for (int i = 0; i < pairCount; i++)
+			pairs.push_back(MakeTlsStreamPair());
+
+		double start = Utility::GetTime();
+
+		std::vector<std::thread> threads;
+
+		for (const TlsStreamPair& pair : pairs) {
+			TlsStream::Ptr client = pair.Client;
+			TlsStream::Ptr server = pair.Server;
+
+			threads.emplace_back([client, messageSize]() {
+				for (int i = 0; i < messageCount; i++)
+					NetString::WriteStringToStream(client, String(messageSize, 'x'));
+			});
+
+			threads.emplace_back([server, messageSize]() {
+				size_t remaining = messageCount * (std::to_string(messageSize).size() + 1 + messageSize + 1);
+				char buffer[64 * 1024];
+
+				while (remaining > 0) {
+					server->WaitForData();
+					remaining -= server->Read(buffer, std::min(sizeof(buffer), remaining), true);
+				}
+			});
+		}
+
+		for (std::thread& thread : threads)
+			thread.join();
+
+		double duration = Utility::GetTime() - start;
+
+		std::cout << "Sent " << pairCount * messageCount << " " << messageSize << " byte netstrings through "
+			<< pairCount << " TLS stream pairs in " << duration << " seconds ("
+			<< pairCount * messageCount / duration << " messages/s)" << std::endl;
+
+		for (const TlsStreamPair& pair : pairs) {
+			pair.Client->Close();
+			pair.Server->Close();
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -18,7 +18,12 @@
  ******************************************************************************/
 
 #include "base/value.hpp"
+#include "base/array.hpp"
+#include "base/dictionary.hpp"
+#include "base/json.hpp"
+#include "base/utility.hpp"
 #include <BoostTestTargetConfig.h>
+#include <iostream>
 
 using namespace icinga;
 
@@ -66,4 +71,109 @@ BOOST_AUTO_TEST_CASE(format)
 	BOOST_CHECK(v != 3);
 }
 
+BOOST_AUTO_TEST_CASE(copy)
+{
+	BOOST_CHECK(sizeof(Value) <= 16);
+
+	Value str = "a string which doesn't fit into a std::string";
+	Value copy = str;
+
+	/* Copies share the string. */
+	BOOST_CHECK(copy.Get<String>().CStr() == str.Get<String>().CStr());
+
+	str = 7;
+	BOOST_CHECK(str == 7);
+	BOOST_CHECK(copy == "a string which doesn't fit into a std::string");
+
+	Value moved = std::move(copy);
+	BOOST_CHECK(moved.IsString());
+	BOOST_CHECK(copy.IsEmpty());
+
+	Value obj = new Array({ 1, 2 });
+	Value other = true;
+	obj.Swap(other);
+
+	BOOST_CHECK(obj.IsBoolean() && obj.ToBool());
+	BOOST_CHECK(other.IsObjectType<Array>());
+
+	BOOST_CHECK_THROW(other.Get<String>(), std::bad_cast);
+}
+
+/* Not run by ctest - use '--run_test=base_value/benchmark_operators' to run it. */
+BOOST_AUTO_TEST_CASE(benchmark_operators)
+{
+	const int count = 5000000;
+
+	std::vector<Value> values = { 1, 2.5, true, "42", "web-frontend-042.example.com", Empty };
+	Value result = 0;
+
+	double start = Utility::GetTime();
+
+	for (int i = 0; i < count; i++) {
+		const Value& lhs = values[i % 2];
+		const Value& rhs = values[(i + 1) % 2];
+
+		result = result + lhs * rhs - (lhs < rhs ? 1 : 0);
+	}
+
+	double duration = Utility::GetTime() - start;
+
+	BOOST_CHECK(result.IsNumber());
+
+	std::cout << "Performed " << count << " arithmetic operations in " << duration << " seconds ("
+		<< count / duration << " operations/s)" << std::endl;
+
+	size_t equal = 0;
+
+	start = Utility::GetTime();
+
+	for (int i = 0; i < count; i++) {
+		Value copy = values[i % values.size()];
+
+		if (copy == values[(i + 4) % values.size()])
+			equal++;
+	}
+
+	duration = Utility::GetTime() - start;
+
+	BOOST_CHECK(equal > 0);
+
+	std::cout << "Performed " << count << " copies and comparisons in " << duration << " seconds ("
+		<< count / duration << " operations/s), sizeof(Value) is " << sizeof(Value) << std::endl;
+}
+
+/* Not run by ctest - use '--run_test=base_value/benchmark_json' to run it. */
+BOOST_AUTO_TEST_CASE(benchmark_json)
+{
+	const int count = 200000;
+
+	Dictionary::Ptr cr = new Dictionary({
+		{ "active", true },
+		{ "check_source", "satellite1.example.com" },
+		{ "command", new Array({ "/usr/lib/nagios/plugins/check_disk", "-c", "10%", "-w", "20%", "-X", "none" }) },
+		{ "execution_end", 1517410342.3412840366 },
+		{ "execution_start", 1517410342.3207230568 },
+		{ "exit_status", 0 },
+		{ "output", "DISK OK - free space: / 33466 MB (74% inode=92%); /boot 382 MB (78% inode=99%);" },
+		{ "performance_data", new Array({ "/=11519MB;37717;42432;0;47147", "/boot=106MB;410;461;0;513" }) },
+		{ "state", 0 },
+		{ "vars_after", new Dictionary({ { "attempt", 1 }, { "reachable", true }, { "state", 0 }, { "state_type", 1 } }) },
+		{ "vars_before", new Dictionary({ { "attempt", 1 }, { "reachable", true }, { "state", 0 }, { "state_type", 1 } }) }
+	});
+
+	String json = JsonEncode(cr);
+
+	double start = Utility::GetTime();
+
+	for (int i = 0; i < count; i++) {
+		Dictionary::Ptr result = JsonDecode(JsonEncode(JsonDecode(json)));
+		BOOST_CHECK(result->GetLength() == cr->GetLength());
+	}
+
+	double duration = Utility::GetTime() - start;
+
+	std::cout << "Performed " << count << " JSON round-trips in " << duration << " seconds ("
+		<< count / duration << " round-trips/s)" << std::endl;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
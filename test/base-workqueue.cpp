@@ -0,0 +1,163 @@
+/******************************************************************************
+ * Icinga 2                                                                   *
+ * Copyright (C) 2012-2018 Icinga Development Team (https://www.icinga.com/)  *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or              *
+ * modify it under the terms of the GNU General Public License                *
+ * as published by the Free Software Foundation; either version 2             *
+ * of the License, or (at your option) any later version.                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software Foundation     *
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
+ ******************************************************************************/
+
+
+#include "base/workqueue.hpp"
+#include "base/utility.hpp"
+#include "base/exception.hpp"
+#include <BoostTestTargetConfig.h>
+#include <iostream>
+
+using namespace icinga;
+
+BOOST_AUTO_TEST_SUITE(base_workqueue)
+
+BOOST_AUTO_TEST_CASE(order)
+{
+	WorkQueue wq;
+	wq.SetName("order");
+
+	std::vector<int> results;
+
+	/* More tasks than the ring buffer can hold. */
+	for (int i = 0; i < 5000; i++)
+		wq.Enqueue([&results, i]() { results.push_back(i); });
+
+	wq.Join();
+
+	BOOST_REQUIRE(results.size() == 5000);
+
+	for (int i = 0; i < 5000; i++)
+		BOOST_CHECK(results[i] == i);
+
+	BOOST_CHECK(wq.GetLength() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(priority)
+{
+	WorkQueue wq;
+	wq.SetName("priority");
+
+	boost::mutex mutex;
+	boost::mutex::scoped_lock lock(mutex);
+
+	std::vector<int> results;
+
+	/* Block the worker thread until all tasks have been enqueued. */
+	wq.Enqueue([&mutex]() { boost::mutex::scoped_lock lock(mutex); });
+
+	wq.Enqueue([&results]() { results.push_back(PriorityLow); }, PriorityLow);
+	wq.Enqueue([&results]() { results.push_back(PriorityNormal); }, PriorityNormal);
+	wq.Enqueue([&results]() { results.push_back(PriorityHigh); }, PriorityHigh);
+	wq.Enqueue([&results]() { results.push_back(PriorityNormal); }, PriorityNormal);
+
+	BOOST_CHECK(wq.GetLength() >= 4);
+
+	lock.unlock();
+	wq.Join();
+
+	BOOST_REQUIRE(results.size() == 4);
+	BOOST_CHECK(results[0] == PriorityHigh);
+	BOOST_CHECK(results[1] == PriorityNormal);
+	BOOST_CHECK(results[2] == PriorityNormal);
+	BOOST_CHECK(results[3] == PriorityLow);
+
+	BOOST_CHECK(wq.GetLength() == 0);
+	BOOST_CHECK(wq.GetTaskCount(60) == 5);
+}
+
+BOOST_AUTO_TEST_CASE(max_items)
+{
+	WorkQueue wq(10, 2);
+	wq.SetName("max_items");
+
+	std::atomic<int> counter(0);
+	std::atomic<size_t> maxLength(0);
+
+	for (int i = 0; i < 1000; i++) {
+		wq.Enqueue([&counter]() { counter++; });
+
+		size_t length = wq.GetLength();
+
+		if (length > maxLength)
+			maxLength = length;
+	}
+
+	wq.Join();
+
+	BOOST_CHECK(counter == 1000);
+	BOOST_CHECK(maxLength <= 10);
+}
+
+BOOST_AUTO_TEST_CASE(exceptions)
+{
+	WorkQueue wq;
+	wq.SetName("exceptions");
+
+	wq.Enqueue([]() { BOOST_THROW_EXCEPTION(std::runtime_error("test")); });
+	wq.Join();
+
+	BOOST_CHECK(wq.HasExceptions());
+	BOOST_CHECK(wq.GetExceptions().size() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_for)
+{
+	WorkQueue wq(0, 4);
+	wq.SetName("parallel_for");
+
+	std::vector<int> items;
+
+	for (int i = 0; i < 1000; i++)
+		items.push_back(i);
+
+	std::atomic<int> sum(0);
+
+	wq.ParallelFor(items, [&sum](int item) { sum += item; });
+	wq.Join();
+
+	BOOST_CHECK(sum == 999 * 1000 / 2);
+}
+
+/* Not run by ctest - use '--run_test=base_workqueue/enqueue_benchmark' to run it. */
+BOOST_AUTO_TEST_CASE(enqueue_benchmark)
+{
+	WorkQueue wq;
+	wq.SetName("enqueue_benchmark");
+
+	const int count = 2000000;
+	int counter = 0;
+	String value = "test";
+
+	double start = Utility::GetTime();
+
+	for (int i = 0; i < count; i++)
+		wq.Enqueue([&counter, value, i]() { counter += i & 1; });
+
+	wq.Join();
+
+	double duration = Utility::GetTime() - start;
+
+	BOOST_CHECK(counter == count / 2);
+
+	std::cout << "Processed " << count << " tasks in " << duration
+		<< " seconds (" << count / duration << " tasks/s)" << std::endl;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,123 @@
+/******************************************************************************
+ * Icinga 2                                                                   *
+ * Copyright (C) 2012-2018 Icinga Development Team (https://www.icinga.com/)  *
+ *                                                                            *
+ * This program is free software; you can redistribute it and/or              *
+ * modify it under the terms of the GNU General Public License                *
+ * as published by the Free Software Foundation; either version 2             *
+ * of the License, or (at your option) any later version.                     *
+ *                                                                            *
+ * This program is distributed in the hope that it will be useful,            *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU General Public License for more details.                               *
+ *                                                                            *
+ * You should have received a copy of the GNU General Public License          *
+ * along with this program; if not, write to the Free Software Foundation     *
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.             *
+ ******************************************************************************/
+
+#include "remote/binaryrpc.hpp"
+#include "remote/jsonrpc.hpp"
+#include "base/array.hpp"
+#include "base/json.hpp"
+#include "base/utility.hpp"
+#include <BoostTestTargetConfig.h>
+#include <iostream>
+
+using namespace icinga;
+
+BOOST_AUTO_TEST_SUITE(remote_binaryrpc)
+
+BOOST_AUTO_TEST_CASE(roundtrip)
+{
+	Dictionary::Ptr message = new Dictionary({
+		{ "jsonrpc", "2.0" },
+		{ "method", "event::CheckResult" },
+		{ "params", new Dictionary({
+			{ "host", "example.com" },
+			{ "small", 7 },
+			{ "negative", -123456789 },
+			{ "large", 9007199254740993.0 },
+			{ "fraction", 1517410342.3412840366 },
+			{ "bools", new Array({ true, false, Empty }) },
+			{ "unknown_key", new Array({
+				new Dictionary({ { "unknown_key", 1 }, { "other_key", "" } }),
+				new Dictionary({ { "unknown_key", 2 }, { "other_key", String(1000, 'x') } })
+			}) }
+		}) }
+	});
+
+	String encoded = BinaryRpc::EncodeMessage(message);
+
+	BOOST_CHECK(BinaryRpc::IsBinaryMessage(encoded));
+	BOOST_CHECK(!BinaryRpc::IsBinaryMessage(JsonEncode(message)));
+	BOOST_CHECK(encoded.GetLength() < JsonEncode(message).GetLength());
+
+	Dictionary::Ptr decoded = BinaryRpc::DecodeMessage(encoded);
+	BOOST_CHECK(JsonEncode(decoded) == JsonEncode(message));
+
+	/* JsonRpc::DecodeMessage() accepts both encodings. */
+	BOOST_CHECK(JsonEncode(JsonRpc::DecodeMessage(encoded)) == JsonEncode(message));
+	BOOST_CHECK(JsonEncode(JsonRpc::DecodeMessage(JsonEncode(message))) == JsonEncode(message));
+}
+
+BOOST_AUTO_TEST_CASE(invalid)
+{
+	String encoded = BinaryRpc::EncodeMessage(new Dictionary({
+		{ "method", "event::Heartbeat" },
+		{ "params", new Dictionary({ { "timeout", 120 } }) }
+	}));
+
+	for (size_t i = 0; i < encoded.GetLength(); i++)
+		BOOST_CHECK_THROW(BinaryRpc::DecodeMessage(encoded.SubStr(0, i)), std::invalid_argument);
+
+	BOOST_CHECK_THROW(BinaryRpc::DecodeMessage(encoded + "x"), std::invalid_argument);
+	BOOST_CHECK_THROW(BinaryRpc::DecodeMessage("\xb1\x7f"), std::invalid_argument);
+	BOOST_CHECK_THROW(BinaryRpc::DecodeMessage("\xb1\x81"), std::invalid_argument);
+}
+
+/* A recorded event::CheckResult cluster message. */
+static const char *l_CheckResultMessage =
+	"{\"jsonrpc\":\"2.0\",\"method\":\"event::CheckResult\",\"params\":{\"cr\":{\"active\":true,"
+	"\"check_source\":\"satellite1.example.com\",\"command\":[\"/usr/lib/nagios/plugins/check_disk\",\"-c\","
+	"\"10%\",\"-w\",\"20%\",\"-X\",\"none\",\"-X\",\"tmpfs\",\"-X\",\"sysfs\",\"-X\",\"proc\",\"-m\"],"
+	"\"execution_end\":1517410342.3412840366,\"execution_start\":1517410342.3207230568,\"exit_status\":0.0,"
+	"\"output\":\"DISK OK - free space: / 33466 MB (74% inode=92%); /boot 382 MB (78% inode=99%);\","
+	"\"performance_data\":[\"/=11519MB;37717;42432;0;47147\",\"/boot=106MB;410;461;0;513\","
+	"\"/var/lib/docker=11519MB;37717;42432;0;47147\"],\"schedule_end\":1517410342.3413319588,"
+	"\"schedule_start\":1517410342.3200001717,\"state\":0.0,\"type\":\"CheckResult\","
+	"\"vars_after\":{\"attempt\":1.0,\"reachable\":true,\"state\":0.0,\"state_type\":1.0},"
+	"\"vars_before\":{\"attempt\":1.0,\"reachable\":true,\"state\":0.0,\"state_type\":1.0}},"
+	"\"host\":\"web-frontend-042.example.com\",\"service\":\"disk\"},\"ts\":1517410342.3425290585}";
+
+/* Not run by ctest - use '--run_test=remote_binaryrpc/benchmark' to run it. */
+BOOST_AUTO_TEST_CASE(benchmark)
+{
+	Dictionary::Ptr message = JsonDecode(l_CheckResultMessage);
+	String json = JsonEncode(message);
+	String binary = BinaryRpc::EncodeMessage(message);
+	const int count = 200000;
+
+	std::cout << "event::CheckResult message: " << json.GetLength() << " bytes as JSON, "
+		<< binary.GetLength() << " bytes in binary" << std::endl;
+
+	double start = Utility::GetTime();
+
+	for (int i = 0; i < count; i++)
+		JsonDecode(JsonEncode(message));
+
+	double jsonDuration = Utility::GetTime() - start;
+
+	start = Utility::GetTime();
+
+	for (int i = 0; i < count; i++)
+		BinaryRpc::DecodeMessage(BinaryRpc::EncodeMessage(message));
+
+	double binaryDuration = Utility::GetTime() - start;
+
+	std::cout << "Encoded and decoded " << count << " messages: JSON " << count / jsonDuration
+		<< " messages/s, binary " << count / binaryDuration << " messages/s" << std::endl;
+}
+
+BOOST_AUTO_TEST_SUITE_END()